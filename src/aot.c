@@ -0,0 +1,702 @@
+/* aot.c - robots compiled ahead of time to shared objects
+ *
+ * Copyright (C) 2026 The CROW authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * 'crobots -C robot.r -o robot.so' writes a robot as C and builds it with
+ * the system C compiler.  The code is one C function, each robot function
+ * straight-line code with a label per instruction: branches and calls go
+ * to their labels, returns through a switch on the return address.  It
+ * is entered at any instruction with a budget of cycles, which every
+ * instruction takes one of and superinstructions the cycles they owe, and
+ * returns when it runs out, so a loaded robot interleaves with the others
+ * exactly like an interpreted one.
+ *
+ * The shared object also carries the robot's instructions as the compiler
+ * left them.  The loader rebuilds the robot from those and links, fuses
+ * and threads them as for a robot compiled from source, so the debugger,
+ * listing and interpreter fallback all work.  Native code covers all but
+ * intrinsic calls and instructions that could fail, which it returns to
+ * aot_burst() to be executed by the interpreter.
+ */
+
+#include "config.h"
+
+#include <err.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_DLFCN_H
+#include <dlfcn.h>
+#endif
+
+#include "crobots.h"
+#include "compiler.h"
+#include "cpu.h"
+#include "jit.h"
+#include "aot.h"
+#include "program.h"
+#include "symtab.h"
+
+#define ABI_LEN 14
+
+
+/* abi - the layout generated code depends on */
+static void abi(long *a)
+{
+  a[0]  = AOT_ABI;
+  a[1]  = sizeof(s_robot);
+  a[2]  = sizeof(s_instr);
+  a[3]  = offsetof(s_robot, ip);
+  a[4]  = offsetof(s_robot, prog);
+  a[5]  = offsetof(s_robot, stackptr);
+  a[6]  = offsetof(s_robot, retptr);
+  a[7]  = offsetof(s_robot, stackbase);
+  a[8]  = offsetof(s_robot, local);
+  a[9]  = offsetof(s_robot, external);
+  a[10] = offsetof(s_robot, stall);
+  a[11] = sizeof(long);
+  a[12] = offsetof(s_program, code);
+  a[13] = offsetof(s_robot, stackend);
+}
+
+
+/* fingerprint - of the instruction types, after fuse_code() */
+static unsigned long fingerprint(s_instr *code)
+{
+  unsigned long sum = AOT_ABI;
+
+  for (; code->ins_type != NOP; code++)
+    sum = sum * 31 + (unsigned char) code->ins_type;
+  return (sum);
+}
+
+
+/* funcindex - offset of a name in the function table */
+static long funcindex(s_program *p, char *name)
+{
+  return (sym_find(p->funcs, name));
+}
+
+
+/* source - an instruction as the compiler left it, undoing link_code() */
+/*          and fuse_code(); returns the instruction type */
+static int source(s_program *p, s_instr *c, long *arg)
+{
+  *arg = 0;
+
+  switch (c->ins_type) {
+    case FETCH:
+    case FCOP:
+    case FFOP:
+      *arg = I_VAR(c);
+      return (FETCH);
+
+    case CONST:
+    case JUMP:
+      *arg = I_K(p, c);
+      return (CONST);
+
+    case OPBR:
+      return (BINOP_OP + I_OP(c));
+
+    case STORE_OP ... STORE_OP + NOPS - 1:
+      *arg = I_VAR(c);
+      return (c->ins_type);
+
+    case ICALL:
+      *arg = funcindex(p, intrinsics[c->arg].n);
+      return (FCALL);
+
+    case UCALL:			/* keeps the name offset */
+    case FCALL:
+      *arg = I_VAR(c);
+      return (FCALL);
+
+    case BRANCH:
+      *arg = c->arg ? I_BR(c) - p->code : -1;
+      return (BRANCH);
+
+    case ENTER:
+    case LEAVE:
+      *arg = c->arg;
+      return (c->ins_type);
+
+    default:
+      return (c->ins_type);
+  }
+}
+
+
+/* constant - a long as a C literal */
+static void constant(FILE *fp, long k)
+{
+  if (k == LONG_MIN)
+    fprintf(fp, "(%ldL - 1)", k + 1);
+  else
+    fprintf(fp, "%ldL", k);
+}
+
+
+/* variable - a variable as a C lvalue */
+static void variable(FILE *fp, short int var)
+{
+  if (var & EXTERNAL)
+    fprintf(fp, "ext[%d]", var & (short int)~EXTERNAL);
+  else
+    fprintf(fp, "lp[%d]", var);
+}
+
+
+/* expression - x op y as C, same as operate() in cpu.c */
+static void expression(FILE *fp, int op)
+{
+  const char *e;
+
+  switch (op) {
+    case OP_ASSIGN:                     e = "y"; break;
+    case OP_OR:                         e = "x | y"; break;
+    case OP_XOR:                        e = "x ^ y"; break;
+    case OP_AND:                        e = "x & y"; break;
+    case OP_LT:                         e = "x < y"; break;
+    case OP_GT:                         e = "x > y"; break;
+    case OP_ADD:                        e = "x + y"; break;
+    case OP_SUB:                        e = "x - y"; break;
+    case OP_MUL:                        e = "x * y"; break;
+    case OP_DIV:                        e = "(y == 0L ? 0L : x / y)"; break;
+    case OP_MOD:                        e = "x % y"; break;
+    case OP_SHL:                        e = "(long) ((unsigned long) x << (y & 63))"; break;
+    case OP_SHR:                        e = "x >> (y & 63)"; break;
+    case OP_LE:                         e = "x <= y"; break;
+    case OP_GE:                         e = "x >= y"; break;
+    case OP_EQ:                         e = "x == y"; break;
+    case OP_NE:                         e = "x != y"; break;
+    case OP_LAND:                       e = "x && y"; break;
+    case OP_LOR:                        e = "x || y"; break;
+    case OP_NEG:                        e = "-x"; break;
+    case OP_NOT:                        e = "!x"; break;
+    case OP_COMP:                       e = "~x"; break;
+    default:                            e = "x"; break;
+  }
+  fprintf(fp, "(%s)", e);
+}
+
+
+/* label - a jump to the label of an instruction, or to the interpreter */
+/*         for a target outside of the code */
+static void label(FILE *fp, int t, int len, int pc)
+{
+  if (t < 0 || t > len)
+    fprintf(fp, "SLOW(%d)", pc);
+  else
+    fprintf(fp, "goto L%d", t);
+}
+
+
+/* emit - one instruction as straight-line C, under its label; each */
+/*        takes its cycle, and leaves to the interpreter what could fail */
+static void emit(FILE *fp, s_program *p, int pc, int len)
+{
+  s_instr *c = p->code + pc;
+  s_func *f;
+  int k;
+
+  fprintf(fp, " L%d:\n  CYCLE(%d);\n", pc, pc);
+
+  switch (pc < len ? c->ins_type : NOP) {
+
+    case FETCH:
+    case CONST:
+      fprintf(fp, "  if (ret - sp <= 1) SLOW(%d);\n  *++sp = ", pc);
+      if (c->ins_type == FETCH)
+	variable(fp, I_VAR(c));
+      else
+	constant(fp, I_K(p, c));
+      fprintf(fp, ";\n");
+      break;
+
+    case BINOP_OP ... BINOP_OP + NOPS - 1:
+    case STORE_OP ... STORE_OP + NOPS - 1:
+      fprintf(fp, "  if (sp - base < 2) SLOW(%d);\n"
+	      "  x = sp[-1];\n  y = sp[0];\n  *--sp = ", pc);
+      expression(fp, I_OP(c));
+      fprintf(fp, ";\n");
+      if (IS_STORE(c->ins_type)) {
+	fprintf(fp, "  ");
+	variable(fp, I_VAR(c));
+	fprintf(fp, " = *sp;\n");
+      }
+      break;
+
+    case UCALL:
+      f = I_FN(p, c);
+      if (f->first - p->code < 0 || f->first - p->code > len) {
+	fprintf(fp, "  SLOW(%d);\n", pc);
+	return;
+      }
+      k = f->var_count - f->par_count + 1;	/* locals above the arguments */
+      if (k < 0)
+	k = 0;
+      fprintf(fp, "  if (ret - sp <= %d) SLOW(%d);\n"
+	      "  ret -= 2;\n  *(char **) (ret + 1) = code + %ldL;\n"
+	      "  *(long **) ret = lp;\n  lp = sp + %d;\n",
+	      k + 2, pc, (long) (pc + 1) * (long) sizeof(s_instr),
+	      1 - f->par_count);
+      if (k > 0)
+	fprintf(fp, "  for (x = %d; x <= %d; x++)\n    lp[x] = 0L;\n",
+		f->par_count, f->var_count);
+      fprintf(fp, "  sp = lp + %d;\n  goto L%ld;\n", f->var_count,
+	      (long) (f->first - p->code));
+      return;
+
+    case RETSUB:
+      fprintf(fp, "  if (ret == end || sp == base) SLOW(%d);\n"
+	      "  f = *(long **) (ret + 2);\n"
+	      "  if (f == base || f == ret + 3) SLOW(%d);\n"
+	      "  x = *(char **) (ret + 1) - code;\n"
+	      "  if ((unsigned long) x > %ldUL || x %% %d) SLOW(%d);\n"
+	      "  y = *sp;\n  lp = *(long **) ret;\n  ret += 3;\n"
+	      "  sp = f;\n  *sp = y;\n  pc = x / %d;\n  goto dispatch;\n",
+	      pc, pc, (long) len * (long) sizeof(s_instr),
+	      (int) sizeof(s_instr), pc, (int) sizeof(s_instr));
+      return;
+
+    case BRANCH:
+      if (!c->arg) {
+	fprintf(fp, "  SLOW(%d);\n", pc);
+	return;
+      }
+      fprintf(fp, "  if (sp == base) SLOW(%d);\n  if (*sp-- == 0L) ", pc);
+      label(fp, I_BR(c) - p->code, len, pc);
+      fprintf(fp, ";\n");
+      break;
+
+    case CHOP:
+      fprintf(fp, "  if (sp == base) SLOW(%d);\n  sp--;\n", pc);
+      break;
+
+    case FRAME:
+      fprintf(fp, "  if (ret - sp <= 1) SLOW(%d);\n"
+	      "  ret--;\n  *(long **) ret = sp;\n", pc);
+      break;
+
+    case ENTER:
+      fprintf(fp, "  if (ret - sp <= %d) SLOW(%d);\n"
+	      "  for (x = 0; x < %d; x++)\n    *++sp = 0L;\n",
+	      c->arg, pc, c->arg);
+      break;
+
+    case LEAVE:
+      fprintf(fp, "  if (sp - base <= %d) SLOW(%d);\n"
+	      "  x = *sp;\n  sp -= %d;\n  *sp = x;\n", c->arg, pc, c->arg);
+      break;
+
+    case FCOP:
+    case FFOP:
+      fprintf(fp, "  if (ret - sp <= 2) SLOW(%d);\n  x = ", pc);
+      variable(fp, I_VAR(c));
+      fprintf(fp, ";\n  y = ");
+      if (c->ins_type == FCOP)
+	constant(fp, I_K(p, c + 1));
+      else
+	variable(fp, I_VAR(c + 1));
+      fprintf(fp, ";\n  *++sp = ");
+      expression(fp, I_OP(c + 2));
+      fprintf(fp, ";\n  OWE(2);\n  goto L%d;\n", pc + 3);
+      return;
+
+    case JUMP:
+      fprintf(fp, "  if (ret - sp <= 1) SLOW(%d);\n  OWE(1);\n  ", pc);
+      label(fp, I_BR(c + 1) - p->code, len, pc);
+      fprintf(fp, ";\n");
+      return;
+
+    case OPBR:
+      fprintf(fp, "  if (sp - base < 2) SLOW(%d);\n"
+	      "  x = sp[-1];\n  y = sp[0];\n  sp -= 2;\n  OWE(1);\n  if (", pc);
+      expression(fp, I_OP(c));
+      fprintf(fp, " == 0L) ");
+      label(fp, I_BR(c + 1) - p->code, len, pc);
+      fprintf(fp, ";\n  goto L%d;\n", pc + 2);
+      return;
+
+    case ICALL:			/* intrinsics are the interpreter's */
+      fprintf(fp, "  SLOW(%d);\n", pc);
+      return;
+
+    case NOP:
+      if (pc == len) {		/* past the end of the code */
+	fprintf(fp, "  SLOW(%d);\n", pc);
+	return;
+      }
+      break;
+
+    default:
+      break;			/* no-ops, missing functions */
+  }
+}
+
+
+/* generate - write the robot as C */
+static void generate(FILE *fp, s_program *p, char *name)
+{
+  s_func *f, **order;
+  long a[ABI_LEN], arg;
+  int len, nfuncs, i, pc;
+
+  for (len = 0; p->code[len].ins_type != NOP; len++)
+    ;
+
+  abi(a);
+
+  fprintf(fp, "/* %s - generated by %s, do not edit */\n\n", name, PACKAGE_STRING);
+  fprintf(fp, "#define IP    (*(char **) (r + %ld))\n", a[3]);
+  fprintf(fp, "#define SP    (*(long **) (r + %ld))\n", a[5]);
+  fprintf(fp, "#define RET   (*(long **) (r + %ld))\n", a[6]);
+  fprintf(fp, "#define BASE  (*(long **) (r + %ld))\n", a[7]);
+  fprintf(fp, "#define END   (*(long **) (r + %ld))\n", a[13]);
+  fprintf(fp, "#define LOC   (*(long **) (r + %ld))\n", a[8]);
+  fprintf(fp, "#define EXT   (*(long **) (r + %ld))\n", a[9]);
+  fprintf(fp, "#define STALL (*(int *) (r + %ld))\n", a[10]);
+  fprintf(fp, "#define CODE  (*(char **) (*(char **) (r + %ld) + %ld))\n\n", a[4], a[12]);
+  fprintf(fp, "/* the cycle of an instruction, if there is one left */\n"
+	  "#define CYCLE(i) if (--n < 0) { pc = (i); goto yield; }\n");
+  fprintf(fp, "/* the cycles a superinstruction owes, beyond those left */\n"
+	  "#define OWE(k)   if ((n -= (k)) < 0) { STALL = -n; n = 0; }\n");
+  fprintf(fp, "/* an instruction for the interpreter, its cycle taken */\n"
+	  "#define SLOW(i)  { pc = (i); goto slow; }\n\n");
+
+  fprintf(fp, "const long crow_aot_abi[%d] = {", ABI_LEN);
+  for (i = 0; i < ABI_LEN; i++)
+    fprintf(fp, "%s%ld", i ? ", " : " ", a[i]);
+  fprintf(fp, " };\n\n");
+
+  /* the robot as the compiler left it */
+  fprintf(fp, "const int crow_aot_ext_count = %d;\n", p->ext_count);
+  fprintf(fp, "const int crow_aot_ninstr = %d;\n", len);
+  fprintf(fp, "const long crow_aot_code[][2] = {\n");
+  for (pc = 0; pc < len; pc++) {
+    i = source(p, p->code + pc, &arg);
+    fprintf(fp, "  { %d, ", i);
+    constant(fp, arg);
+    fprintf(fp, " },\n");
+  }
+  fprintf(fp, "  { 0, 0L }\n};\n\n");
+
+  nfuncs = 0;
+  for (f = p->code_list; f; f = f->nextfunc)
+    nfuncs++;
+  order = malloc((nfuncs + 1) * sizeof(s_func *));
+  nfuncs = 0;
+  for (f = p->code_list; f; f = f->nextfunc)
+    order[nfuncs++] = f;
+
+  fprintf(fp, "const int crow_aot_nfuncs = %d;\n", nfuncs);
+  fprintf(fp, "const char *const crow_aot_fnames[] = {");
+  for (i = 0; i < nfuncs; i++)
+    fprintf(fp, "%s\"%s\"", i ? ", " : " ", order[i]->func_name);
+  fprintf(fp, " };\n");
+  fprintf(fp, "const long crow_aot_funcs[][3] = {\n");
+  for (i = 0; i < nfuncs; i++)
+    fprintf(fp, "  { %ld, %d, %d },\n", (long) (order[i]->first - p->code),
+	    order[i]->var_count, order[i]->par_count);
+  fprintf(fp, "  { 0, 0, 0 }\n};\n");
+  fprintf(fp, "const char *const crow_aot_ftab[] = {");
+  for (i = 0; i < p->funcs->count; i++)
+    fprintf(fp, " \"%s\",", SYM_NAME(p->funcs, i));
+  fprintf(fp, " 0 };\n\n");
+
+  fprintf(fp, "const unsigned long crow_aot_sum = %luUL;\n\n", fingerprint(p->code));
+
+  /* the code, entered at any instruction, with a comment where each */
+  /* function starts; calls and returns stay inside */
+  fprintf(fp, "long crow_aot_run(char *r, long n, long pc)\n{\n"
+	  "  char *const code = CODE;\n"
+	  "  long *const base = BASE, *const end = END, *const ext = EXT;\n"
+	  "  long *sp = SP, *ret = RET, *lp = LOC, *f;\n"
+	  "  long x, y;\n\n"
+	  " dispatch:\n  switch (pc) {\n");
+  for (pc = 0; pc < len; pc++)
+    fprintf(fp, "  case %d: goto L%d;\n", pc, pc);
+  fprintf(fp, "  default: goto L%d;\n  }\n\n", len);
+
+  for (pc = 0; pc <= len; pc++) {
+    for (i = 0; i < nfuncs; i++)
+      if (order[i]->first - p->code == pc)
+	fprintf(fp, "  /* %s() */\n", order[i]->func_name);
+    emit(fp, p, pc, len);
+  }
+
+  fprintf(fp, "\n yield:\n  SP = sp;\n  RET = ret;\n  LOC = lp;\n"
+	  "  IP = code + pc * %ld;\n  return 0;\n", (long) sizeof(s_instr));
+  fprintf(fp, "\n slow:\n  SP = sp;\n  RET = ret;\n  LOC = lp;\n"
+	  "  IP = code + pc * %ld;\n  (void) f;\n  (void) x;\n  (void) y;\n"
+	  "  return -n - 1;\n}\n", (long) sizeof(s_instr));
+
+  free(order);
+}
+
+
+/* aot_file - check whether a robot file is a compiled shared object */
+int aot_file(char *f)
+{
+  size_t len = strlen(f);
+
+  return (len > 3 && strcmp(f + len - 3, ".so") == 0);
+}
+
+
+/* aot_build - compile a robot, after fuse_code(), to a shared object */
+/*             with the C compiler in $CC or cc; returns 0 on failure */
+int aot_build(s_program *p, char *so)
+{
+  char *src, *cmd, *cc;
+  FILE *fp;
+  int rc;
+
+  if (strchr(so, '\'')) {
+    warnx("invalid output file name '%s'", so);
+    return (0);
+  }
+
+  src = malloc(strlen(so) + 3);
+  sprintf(src, "%s.c", so);
+  fp = fopen(src, "w");
+  if (!fp) {
+    warn("cannot write '%s'", src);
+    free(src);
+    return (0);
+  }
+  generate(fp, p, so);
+  fclose(fp);
+
+  cc = getenv("CC");
+  if (!cc || !*cc)
+    cc = "cc";
+
+  cmd = malloc(strlen(cc) + 2 * strlen(so) + 64);
+  sprintf(cmd, "%s -shared -fPIC -O2 -fwrapv -o '%s' '%s'", cc, so, src);
+  rc = system(cmd);
+  unlink(src);
+  free(src);
+  free(cmd);
+
+  if (rc != 0) {
+    warnx("failed building '%s'", so);
+    return (0);
+  }
+  return (1);
+}
+
+
+#ifdef HAVE_DLFCN_H
+
+/* symbol - look up a symbol in a robot shared object */
+static void *symbol(void *handle, char *name, char *so)
+{
+  void *p = dlsym(handle, name);
+
+  if (!p)
+    warnx("'%s' is not a compiled robot, missing %s", so, name);
+  return (p);
+}
+
+
+/* aot_load - load a robot compiled by aot_build(), in place of init_comp() */
+/*            and the parser, with a stack of 'stack'; returns 0 on failure */
+int aot_load(s_robot *r, char *so, int stack)
+{
+  const long (*code)[2], (*funcs)[3], *sym_abi;
+  const char *const *fnames, *const *ftab;
+  const int *ninstr, *nfuncs, *ext_count;
+  const unsigned long *sum;
+  aot_run run;
+  long a[ABI_LEN];
+  s_program *p;
+  void *handle;
+  char *path;
+  s_func *f;
+  int i;
+
+  /* dlopen() searches the library path for names without a slash */
+  path = malloc(strlen(so) + 3);
+  sprintf(path, "%s%s", strchr(so, '/') ? "" : "./", so);
+  handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  free(path);
+  if (!handle) {
+    warnx("%s", dlerror());
+    return (0);
+  }
+
+  sym_abi   = symbol(handle, "crow_aot_abi", so);
+  ext_count = symbol(handle, "crow_aot_ext_count", so);
+  ninstr    = symbol(handle, "crow_aot_ninstr", so);
+  code      = symbol(handle, "crow_aot_code", so);
+  nfuncs    = symbol(handle, "crow_aot_nfuncs", so);
+  fnames    = symbol(handle, "crow_aot_fnames", so);
+  funcs     = symbol(handle, "crow_aot_funcs", so);
+  ftab      = symbol(handle, "crow_aot_ftab", so);
+  sum       = symbol(handle, "crow_aot_sum", so);
+  run       = (aot_run) symbol(handle, "crow_aot_run", so);
+  if (!sym_abi || !ext_count || !ninstr || !code || !nfuncs || !fnames ||
+      !funcs || !ftab || !sum || !run) {
+    dlclose(handle);
+    return (0);
+  }
+
+  abi(a);
+  if (memcmp(a, sym_abi, sizeof(a)) != 0) {
+    warnx("'%s' was compiled by another version of crobots", so);
+    dlclose(handle);
+    return (0);
+  }
+
+  p = prog_new();
+  p->code = calloc(*ninstr + 1, sizeof(s_instr));
+  p->pool = malloc((*ninstr + 1) * sizeof(long));
+  p->pool_count = 0;
+  for (i = 0; i < *ninstr; i++) {
+    s_instr *c = p->code + i;
+
+    c->ins_type = code[i][0];
+    switch (c->ins_type) {
+      case CONST:
+	c->arg = add_const(p, code[i][1]);
+	break;
+      case BRANCH:
+	c->arg = code[i][1] < 0 ? 0 : code[i][1] - i;
+	break;
+      default:
+	c->arg = (unsigned short int) code[i][1];
+	break;
+    }
+  }
+  p->code[*ninstr].ins_type = NOP;
+
+  /* same order of function headers as the compiler made */
+  p->code_list = NULL;
+  for (i = *nfuncs - 1; i >= 0; i--) {
+    f = malloc(sizeof(s_func) + strlen(fnames[i]) + 1);
+    f->nextfunc = p->code_list;
+    p->code_list = f;
+    strcpy(f->func_name, fnames[i]);
+    f->first = p->code + funcs[i][0];
+    f->var_count = funcs[i][1];
+    f->par_count = funcs[i][2];
+  }
+
+  p->funcs = sym_new();
+  for (i = 0; ftab[i]; i++)
+    sym_add(p->funcs, ftab[i]);
+
+  p->ext_count = *ext_count;
+  p->aot = malloc(sizeof(struct aot));
+  p->aot->handle = handle;
+  p->aot->run = run;
+  p->aot->len = *ninstr;
+  p->aot->sum = *sum;
+  prog_attach(r, p, stack);
+
+  return (1);
+}
+
+
+/* aot_free - release the shared object of a program */
+void aot_free(s_program *p)
+{
+  if (!p->aot)
+    return;
+
+  dlclose(p->aot->handle);
+  free(p->aot);
+  p->aot = NULL;
+}
+
+#else  /* !HAVE_DLFCN_H */
+
+int aot_load(s_robot *r, char *so, int stack)
+{
+  (void)r;
+  (void)stack;
+  warnx("cannot load '%s', no dynamic loading on this system", so);
+  return (0);
+}
+
+void aot_free(s_program *p)
+{
+  (void)p;
+}
+
+#endif /* HAVE_DLFCN_H */
+
+
+/* aot_bind - run a loaded robot natively, after fuse_code() has given it */
+/*            the code it was generated from; returns 0 if interpreted */
+int aot_bind(s_program *p)
+{
+  if (!p->aot)
+    return (0);
+
+  if (fingerprint(p->code) != p->aot->sum) {
+    warnx("compiled robot does not match its code, interpreting ...");
+    aot_free(p);
+    return (0);
+  }
+  return (1);
+}
+
+
+/* aot_burst - run n cycles of the current robot, from its shared */
+/*             object if loaded from one and n is more than one */
+void aot_burst(s_arena *a, int n)
+{
+  register s_robot *r = a->cur_robot;
+  struct aot *o = r->prog->aot;
+  long left = n, i;
+
+  if (!o) {
+    jit_burst(a, n);
+    return;
+  }
+  if (n == 1) {			/* a lone cycle does not pay the entry */
+    burst(a, n);
+    return;
+  }
+
+  while (left > 0) {
+    if (r->stall > 0) {		/* owed by a superinstruction */
+      i = r->stall < left ? r->stall : left;
+      r->stall -= i;
+      left -= i;
+      continue;
+    }
+
+    i = r->ip - r->prog->code;
+    if (i < 0 || i > o->len) {
+      burst(a, left);
+      return;
+    }
+
+    left = o->run((char *) r, left, i);
+    if (left < 0) {		/* an instruction that could fail */
+      cycle(a);
+      left = -left - 1;
+    }
+  }
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: nil
+ *  c-file-style: "gnu"
+ * End:
+ */
@@ -0,0 +1,44 @@
+/* aot.h - robots compiled ahead of time to shared objects
+ *
+ * Copyright (C) 2026 The CROW authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef CROBOTS_AOT_H_
+#define CROBOTS_AOT_H_
+
+#include "crobots.h"
+
+#define AOT_ABI 5		/* bump on any change of the generated symbols */
+
+/* runs the robot natively from the instruction at pc for up to n cycles */
+/* and returns the cycles left, or -(left + 1) after taking the cycle of */
+/* an instruction left to the interpreter, at the robot's ip */
+typedef long (*aot_run)(char *r, long n, long pc);
+
+/* a loaded shared object */
+struct aot {
+  void *handle;			/* from dlopen() */
+  aot_run run;			/* the robot's code */
+  int len;			/* instructions of the code */
+  unsigned long sum;		/* fingerprint of the fused code */
+};
+
+int  aot_file(char *f);
+int  aot_build(s_program *p, char *so);
+int  aot_load(s_robot *r, char *so, int stack);
+int  aot_bind(s_program *p);
+void aot_free(s_program *p);
+void aot_burst(s_arena *a, int n);
+
+#endif /* CROBOTS_AOT_H_ */
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: nil
+ *  c-file-style: "gnu"
+ * End:
+ */
@@ -0,0 +1,163 @@
+/* bench.c - forks per second of a match, with libcrow
+ *
+ * Copyright (C) 2026 The CROW authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * Plays a match of the robots given up to a cycle, then branches it
+ * with crow_fork(): into new battlefields, into one reused, and into
+ * one reused that plays every branch out, counting who wins.  Robots
+ * that call rand() make the branches differ.
+ */
+
+#include "config.h"
+
+#include <err.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "crow.h"
+
+
+/* now - seconds of a monotonic clock */
+static double now(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (t.tv_sec + t.tv_nsec / 1e9);
+}
+
+
+static int usage(int rc)
+{
+  printf("Usage:\n"
+	 "  crow-bench [options] robot1.r [robotN.r]\n"
+	 "\n"
+	 "Options:\n"
+	 "  -c CYCLES Cycles of the match before it is forked (default 5000)\n"
+	 "  -J        Run robots as native code\n"
+	 "  -k SIZE   Max robot instruction limit (default 1000)\n"
+	 "  -n NUM    Forks timed (default 100000)\n"
+	 "  -r NUM    Forks played out (default 1000)\n"
+	 "  -S SEED   Seed of the match (default 1)\n"
+	 "\n");
+
+  return rc;
+}
+
+
+int main(int argc, char *argv[])
+{
+  crow_options_t opt = { 0 };
+  crow_obs_t obs;
+  crow_t *c, *b;
+  uint64_t seed = 1;
+  long cycles = 5000, forks = 100000, rollouts = 1000, steps = 0;
+  long wins[CROW_MAXROBOTS + 1] = { 0 };
+  double t;
+  long i;
+  int ch, j, n;
+
+  while ((ch = getopt(argc, argv, "c:hJk:n:r:S:")) != EOF) {
+    switch (ch) {
+      case 'c':
+	cycles = atol(optarg);
+	break;
+
+      case 'J':
+	opt.jit = 1;
+	break;
+
+      case 'k':
+	opt.max_instr = atoi(optarg);
+	break;
+
+      case 'n':
+	forks = atol(optarg);
+	break;
+
+      case 'r':
+	rollouts = atol(optarg);
+	break;
+
+      case 'S':
+	seed = strtoull(optarg, NULL, 0);
+	break;
+
+      case 'h':
+	return usage(0);
+
+      default:
+	return usage(1);
+    }
+  }
+
+  n = argc - optind;
+  if (n < 1 || forks < 1 || rollouts < 1)
+    return usage(1);
+
+  c = crow_open(&argv[optind], n, &opt);
+  if (!c)
+    errx(1, "cannot open a battlefield of these robots");
+  crow_reset(c, seed);
+  if (!crow_step(c, cycles))
+    errx(1, "the match is over before cycle %ld", cycles);
+  crow_observe(c, &obs);
+  printf("Forking match of seed %llu at cycle %ld, %d of %d robots alive\n",
+	 (unsigned long long) seed, obs.cycle, obs.alive, obs.robots);
+
+  t = now();
+  for (i = 0; i < forks; i++)
+    crow_close(crow_fork(c, NULL, i));
+  t = now() - t;
+  printf("  new forks.........: %10.0f forks/s\n", forks / t);
+
+  b = crow_fork(c, NULL, 0);
+  t = now();
+  for (i = 0; i < forks; i++)
+    crow_fork(c, b, i);
+  t = now() - t;
+  printf("  reused forks......: %10.0f forks/s\n", forks / t);
+
+  t = now();
+  for (i = 0; i < rollouts; i++) {
+    crow_fork(c, b, i);
+    while (crow_step(b, 15))
+      steps++;
+    crow_observe(b, &obs);
+    if (obs.alive == 1) {
+      for (j = 0; !obs.robot[j].status; j++)
+	;
+      wins[j]++;
+    } else {
+      wins[CROW_MAXROBOTS]++;
+    }
+  }
+  t = now() - t;
+  printf("  played out........: %10.0f forks/s, %.0f motion updates/s\n",
+	 rollouts / t, steps / t);
+
+  for (j = 0; j < crow_robots(c); j++)
+    printf("  (%d)%14s: wins=%ld\n", j + 1, crow_name(c, j), wins[j]);
+  printf("  no winner.........: %ld\n", wins[CROW_MAXROBOTS]);
+
+  crow_close(b);
+  crow_close(c);
+
+  return 0;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: nil
+ *  c-file-style: "gnu"
+ * End:
+ */
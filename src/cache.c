@@ -0,0 +1,528 @@
+/* cache.c - compiled robots cached on disk, by hash of their source
+ *
+ * Copyright (C) 2026 The CROW authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * 'crobots -D DIR' keeps each robot it compiles in DIR, as the compiler
+ * left it: before link_code(), so the file holds no pointers.  The file
+ * is named by a hash of the source, the instruction limit, the level of
+ * optimization and the version of crobots, so any change of those
+ * compiles the robot again.  A file is written under a temporary name and
+ * renamed, so processes sharing a directory never see half a file.
+ *
+ * Loading maps the file and rebuilds the robot from it, which is then
+ * linked, fused and threaded as if just compiled; no parsing at all.
+ * The format is that of the host: a file from another kind of machine,
+ * or another build, fails the checks of the header and is compiled again.
+ *
+ *   struct head
+ *   long     pool[npool]		constants
+ *   s_instr  code[ninstr]		instructions, branches relative
+ *   struct   rec funcs[nfuncs]	function headers, in code_list order
+ *   uint32_t ftab[nnames]		function table, names by offset
+ *   char     names[nchars]		all names, each ends with '\0'
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#include <sys/stat.h>
+
+#include "crobots.h"
+#include "cache.h"
+#include "compiler.h"
+#include "program.h"
+#include "symtab.h"
+
+#define CACHE_MAGIC "CROWRBC"
+
+struct head {
+  char magic[8];		/* CACHE_MAGIC */
+  uint32_t version;		/* CACHE_VERSION */
+  uint32_t instr_size;		/* sizeof(s_instr) */
+  uint64_t key;			/* from cache_key() */
+  uint32_t ninstr;		/* instructions, without the NOP */
+  uint32_t npool;		/* constants */
+  uint32_t nfuncs;		/* function headers */
+  uint32_t nnames;		/* function table */
+  uint32_t nchars;		/* bytes of all names */
+  uint32_t ext_count;		/* external variables */
+  uint32_t undeclared;		/* warnings of the compiler */
+  uint32_t postfix;
+};
+
+struct rec {			/* an s_func without pointers */
+  uint32_t name;		/* offset in names */
+  uint32_t first;		/* offset in code */
+  int32_t var_count;
+  int32_t par_count;
+};
+
+
+/* fnv - FNV-1a of n bytes, from the hash h */
+static uint64_t fnv(uint64_t h, const void *p, size_t n)
+{
+  const unsigned char *b = p;
+
+  while (n-- > 0) {
+    h ^= *b++;
+    h *= 1099511628211ULL;
+  }
+  return (h);
+}
+
+
+/* path - the name of the file of a key, or a temporary for it */
+static char *path(const char *dir, uint64_t key, int tmp)
+{
+  size_t len = strlen(dir) + 64;
+  char *p = malloc(len);
+
+  if (tmp)
+    snprintf(p, len, "%s/%016llx.rbc.%ld", dir, (unsigned long long) key,
+	     (long) getpid());
+  else
+    snprintf(p, len, "%s/%016llx.rbc", dir, (unsigned long long) key);
+  return (p);
+}
+
+
+/* cache_key - hash of a robot source file and whatever else changes its */
+/*             code, the instruction limit and level of optimization */
+/*             it is compiled with; reads the file through, then rewinds it */
+uint64_t cache_key(FILE *fp, int max_instr, int level)
+{
+  uint64_t h = 14695981039346656037ULL;
+  char buf[4096];
+  size_t n;
+  int k[4];
+
+  while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+    h = fnv(h, buf, n);
+  rewind(fp);
+
+  k[0] = CACHE_VERSION;
+  k[1] = max_instr;
+  k[2] = level;
+  k[3] = sizeof(s_instr);
+  h = fnv(h, k, sizeof(k));
+  return (fnv(h, PACKAGE_STRING, strlen(PACKAGE_STRING)));
+}
+
+
+/* frame - whether every path of a function from its entry stays in its */
+/*         code, and every local it fetches or stores is in its frame: */
+/*         its own locals and the slots pushed since, with the depth of */
+/*         the stack walked as depth() of the compiler does */
+static int frame(const struct head *h, const long *pool, const s_instr *code,
+		 const struct rec *f, long end, int *dep, int *frames, int *work)
+{
+  int top, nf, zero, d, v;
+  long i, t;
+
+  for (i = f->first; i < end; i++)
+    dep[i] = -1;
+  top = 0;
+  dep[f->first] = 0;
+  work[top++] = f->first;
+
+  while (top > 0) {
+    i = work[--top];
+    d = dep[i];
+    nf = 0;
+    zero = 0;
+
+    /* one straight line of code, until a return or a path met */
+    for (;;) {
+      switch (code[i].ins_type) {
+	case FETCH:
+	case STORE_OP ... STORE_OP + NOPS - 1:
+	  v = I_VAR(code + i);
+	  if (code[i].arg < 0 || code[i].arg > 0xffff)
+	    return (0);
+	  if (v & EXTERNAL) {
+	    if ((uint32_t) (v & (short int) ~EXTERNAL) >= h->ext_count)
+	      return (0);
+	  } else if (v > f->var_count + d + nf) {
+	    return (0);
+	  }
+	  d += code[i].ins_type == FETCH ? 1 : -1;
+	  break;
+
+	case CONST:
+	  d++;
+	  break;
+
+	case BINOP_OP ... BINOP_OP + NOPS - 1:
+	case CHOP:
+	  d--;
+	  break;
+
+	case ENTER:
+	  d += code[i].arg;
+	  break;
+
+	case LEAVE:
+	  d -= code[i].arg;
+	  break;
+
+	case FRAME:
+	  frames[nf++] = d;
+	  break;
+
+	case FCALL:
+	  if (nf == 0)
+	    return (0);
+	  d = frames[--nf];
+	  break;
+
+	case BRANCH:
+	  d--;
+	  t = i + code[i].arg;
+	  if (nf > 0 || code[i].arg == 0 || t < f->first || t >= end)
+	    return (0);
+	  if (dep[t] < 0) {
+	    dep[t] = d;
+	    work[top++] = t;
+	  } else if (dep[t] != d) {
+	    return (0);
+	  }
+	  if (zero)			/* always taken, a return inlined */
+	    goto ended;
+	  break;
+
+	case RETSUB:
+	  if (nf > 0)
+	    return (0);
+	  goto ended;
+
+	default:
+	  return (0);
+      }
+      if (d < 0)
+	return (0);
+      zero = code[i].ins_type == CONST && pool[code[i].arg] == 0L;
+
+      if (++i >= end)			/* after the last branch of a loop */
+	break;
+      if (dep[i] >= 0) {		/* paths meet, outside any call */
+	if (nf > 0 || dep[i] != d)
+	  return (0);
+	break;
+      }
+      dep[i] = d;
+    }
+  ended:
+    ;
+  }
+
+  return (1);
+}
+
+
+/* valid - whether all offsets of a cached robot are in range: constants, */
+/*         branches, calls and externals, and the locals of each function */
+/*         in its frame; the functions cover the code from its start, and */
+/*         no path of one enters another but by a call */
+static int valid(const struct head *h, const long *pool, const s_instr *code,
+		 const struct rec *fr, const uint32_t *ftab)
+{
+  int *dep, *frames, *work;
+  uint32_t i, j;
+  long t, end;
+  int ok, start = 0;
+
+  for (i = 0; i < h->ninstr; i++) {
+    switch (code[i].ins_type) {
+      case CONST:
+	if ((uint32_t) code[i].arg >= h->npool)
+	  return (0);
+	break;
+      case BRANCH:
+	t = (long) i + code[i].arg;
+	if (t < 0 || t > (long) h->ninstr)
+	  return (0);
+	break;
+      case FCALL:
+	if ((uint32_t) code[i].arg >= h->nnames)
+	  return (0);
+	break;
+      case NOP:
+	return (0);
+      default:
+	break;
+    }
+  }
+  for (i = 0; i < h->nfuncs; i++) {
+    if (fr[i].name >= h->nchars || fr[i].first >= h->ninstr ||
+	fr[i].var_count < fr[i].par_count || fr[i].par_count < 0)
+      return (0);
+    if (fr[i].first == 0)
+      start = 1;
+  }
+  if (!start)
+    return (0);
+  for (i = 0; i < h->nnames; i++) {
+    if (ftab[i] >= h->nchars)
+      return (0);
+  }
+
+  /* each function runs to the first of the next one */
+  dep = malloc(h->ninstr * sizeof(int));
+  frames = malloc(h->ninstr * sizeof(int));
+  work = malloc(h->ninstr * sizeof(int));
+  ok = 1;
+  for (i = 0; ok && i < h->nfuncs; i++) {
+    end = h->ninstr;
+    for (j = 0; j < h->nfuncs; j++) {
+      if (j != i && fr[j].first == fr[i].first)
+	ok = 0;
+      else if (fr[j].first > fr[i].first && fr[j].first < end)
+	end = fr[j].first;
+    }
+    ok = ok && frame(h, pool, code, fr + i, end, dep, frames, work);
+  }
+  free(work);
+  free(frames);
+  free(dep);
+  return (ok);
+}
+
+
+#ifdef HAVE_SYS_MMAN_H
+
+/* map_file - the contents of an open file of size bytes, NULL on failure */
+static char *map_file(int fd, size_t size)
+{
+  char *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  return (p == MAP_FAILED ? NULL : p);
+}
+
+/* unmap_file - release what map_file() returned */
+static void unmap_file(char *p, size_t size)
+{
+  munmap(p, size);
+}
+
+#else  /* !HAVE_SYS_MMAN_H */
+
+/* map_file - the contents of an open file of size bytes, read into */
+/*            memory without mmap(); NULL on failure */
+static char *map_file(int fd, size_t size)
+{
+  char *p = malloc(size);
+  size_t done = 0;
+  ssize_t n;
+
+  while (p && done < size) {
+    n = read(fd, p + done, size - done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      free(p);
+      return (NULL);
+    }
+    done += n;
+  }
+  return (p);
+}
+
+/* unmap_file - release what map_file() returned */
+static void unmap_file(char *p, size_t size)
+{
+  (void)size;
+  free(p);
+}
+
+#endif /* HAVE_SYS_MMAN_H */
+
+
+/* cache_load - rebuild a robot from the cache, 0 if it is not there; */
+/*              the warnings of its compile go to out, unless NULL, */
+/*              and the robot gets a stack of 'stack' */
+int cache_load(s_robot *r, const char *dir, uint64_t key, FILE *out,
+	       int stack)
+{
+  const struct head *h;
+  const struct rec *fr;
+  const uint32_t *ftab;
+  const char *names;
+  const long *pool;
+  const s_instr *code;
+  s_program *prog;
+  struct stat st;
+  s_func *f;
+  size_t size;
+  char *p, *map;
+  int fd, i;
+
+  p = path(dir, key, 0);
+  fd = open(p, O_RDONLY);
+  free(p);
+  if (fd < 0)
+    return (0);
+  if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(struct head)) {
+    close(fd);
+    return (0);
+  }
+  size = st.st_size;
+  map = map_file(fd, size);
+  close(fd);
+  if (!map)
+    return (0);
+
+  h = (const struct head *) map;
+  if (memcmp(h->magic, CACHE_MAGIC, sizeof(h->magic)) != 0 ||
+      h->version != CACHE_VERSION || h->instr_size != sizeof(s_instr) ||
+      h->key != key ||
+      size != sizeof(*h) + h->npool * sizeof(long) +
+      h->ninstr * sizeof(s_instr) + h->nfuncs * sizeof(struct rec) +
+      h->nnames * sizeof(uint32_t) + h->nchars ||
+      h->nchars == 0 || map[size - 1] != '\0') {
+    unmap_file(map, size);
+    return (0);
+  }
+  pool = (const long *) (h + 1);
+  code = (const s_instr *) (pool + h->npool);
+  fr = (const struct rec *) (code + h->ninstr);
+  ftab = (const uint32_t *) (fr + h->nfuncs);
+  names = (const char *) (ftab + h->nnames);
+  if (!valid(h, pool, code, fr, ftab)) {
+    unmap_file(map, size);
+    return (0);
+  }
+
+  prog = prog_new();
+  prog->code = malloc((h->ninstr + 1) * sizeof(s_instr));
+  memcpy(prog->code, code, h->ninstr * sizeof(s_instr));
+  prog->code[h->ninstr].ins_type = NOP;
+  prog->code[h->ninstr].arg = 0;
+  prog->pool = malloc((h->npool + 1) * sizeof(long));
+  memcpy(prog->pool, pool, h->npool * sizeof(long));
+  prog->pool_count = h->npool;
+
+  /* same order of function headers as the compiler made */
+  prog->code_list = NULL;
+  for (i = h->nfuncs - 1; i >= 0; i--) {
+    f = malloc(sizeof(s_func) + strlen(names + fr[i].name) + 1);
+    f->nextfunc = prog->code_list;
+    prog->code_list = f;
+    strcpy(f->func_name, names + fr[i].name);
+    f->first = prog->code + fr[i].first;
+    f->var_count = fr[i].var_count;
+    f->par_count = fr[i].par_count;
+  }
+
+  prog->funcs = sym_new();
+  for (i = 0; i < (int) h->nnames; i++)
+    sym_add(prog->funcs, names + ftab[i]);
+
+  prog->ext_count = h->ext_count;
+  prog_attach(r, prog, stack);
+
+  /* the same warnings as when it was compiled */
+  if (comp_warnings(out, h->undeclared, h->postfix) && out)
+    fputs("\n", out);
+
+  unmap_file(map, size);
+  return (1);
+}
+
+
+/* cache_save - write a program just compiled to the cache, 0 on failure */
+/*              with the counts of warnings of its compile */
+int cache_save(s_program *prog, const char *dir, uint64_t key,
+	       int undeclared, int postfix)
+{
+  struct head h;
+  struct rec fr;
+  s_func *f;
+  uint32_t off;
+  char *tmp, *p;
+  FILE *fp;
+  int i, ok;
+
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, CACHE_MAGIC, sizeof(h.magic));
+  h.version = CACHE_VERSION;
+  h.instr_size = sizeof(s_instr);
+  h.key = key;
+  for (h.ninstr = 0; prog->code[h.ninstr].ins_type != NOP; h.ninstr++)
+    ;
+  h.npool = prog->pool_count;
+  for (f = prog->code_list; f; f = f->nextfunc) {
+    h.nfuncs++;
+    h.nchars += strlen(f->func_name) + 1;
+  }
+  h.nnames = prog->funcs->count;
+  for (i = 0; i < prog->funcs->count; i++)
+    h.nchars += strlen(SYM_NAME(prog->funcs, i)) + 1;
+  h.ext_count = prog->ext_count;
+  h.undeclared = undeclared;
+  h.postfix = postfix;
+
+  if (mkdir(dir, 0777) < 0 && errno != EEXIST)
+    return (0);
+  tmp = path(dir, key, 1);
+  fp = fopen(tmp, "wb");
+  if (!fp) {
+    free(tmp);
+    return (0);
+  }
+
+  fwrite(&h, sizeof(h), 1, fp);
+  fwrite(prog->pool, sizeof(long), h.npool, fp);
+  fwrite(prog->code, sizeof(s_instr), h.ninstr, fp);
+
+  off = 0;			/* names of functions, then of the table */
+  for (f = prog->code_list; f; f = f->nextfunc) {
+    fr.name = off;
+    fr.first = f->first - prog->code;
+    fr.var_count = f->var_count;
+    fr.par_count = f->par_count;
+    fwrite(&fr, sizeof(fr), 1, fp);
+    off += strlen(f->func_name) + 1;
+  }
+  for (i = 0; i < prog->funcs->count; i++) {
+    fwrite(&off, sizeof(off), 1, fp);
+    off += strlen(SYM_NAME(prog->funcs, i)) + 1;
+  }
+  for (f = prog->code_list; f; f = f->nextfunc)
+    fwrite(f->func_name, 1, strlen(f->func_name) + 1, fp);
+  for (i = 0; i < prog->funcs->count; i++)
+    fwrite(SYM_NAME(prog->funcs, i), 1, strlen(SYM_NAME(prog->funcs, i)) + 1, fp);
+
+  ok = !ferror(fp);
+  if (fclose(fp) != 0)
+    ok = 0;
+
+  p = path(dir, key, 0);
+  if (!ok || rename(tmp, p) < 0) {
+    unlink(tmp);
+    ok = 0;
+  }
+  free(p);
+  free(tmp);
+  return (ok);
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: nil
+ *  c-file-style: "gnu"
+ * End:
+ */
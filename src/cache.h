@@ -0,0 +1,34 @@
+/* cache.h - compiled robots cached on disk, by hash of their source
+ *
+ * Copyright (C) 2026 The CROW authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef CROBOTS_CACHE_H_
+#define CROBOTS_CACHE_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "crobots.h"
+
+#define CACHE_VERSION 2		/* bump on any change of the file format, */
+				/* or of what the compiler makes */
+
+uint64_t cache_key(FILE *fp, int max_instr, int level);
+int      cache_load(s_robot *r, const char *dir, uint64_t key, FILE *out,
+		    int stack);
+int      cache_save(s_program *prog, const char *dir, uint64_t key,
+		    int undeclared, int postfix);
+
+#endif /* CROBOTS_CACHE_H_ */
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: nil
+ *  c-file-style: "gnu"
+ * End:
+ */
@@ -16,6 +16,7 @@
  * with this program; if not, write to the Free Software Foundation, Inc.,
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
+#include <limits.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -24,47 +25,21 @@
 #include "compiler.h"
 #include "grammar.h"
 #include "library.h"
+#include "cpu.h"
+#include "policy.h"
+#include "program.h"
+#include "symtab.h"
 
 
-char last_ident[8],	/* last identifier recognized */
-     func_ident[8];	/* used on function definitions */
-
-s_instr *last_ins,	/* last instruction compiled */
-        *instruct;	/* current instruction */
-
-int num_parm,		/* number of parameters in a function definition */
-    un_op,		/* for special unary operators */
-    num_instr,		/* counts number of instructions */
-    column,		/* from lexical analyzer */
-    if_nest,		/* current if nest level */
-    undeclared,		/* count variables that are implicit */
-    postfix;		/* count the usage of postfix operators */
-
-char *ext_tab,		/* external symbol table */
-     *var_tab,		/* local symbol table */
-     *func_tab,		/* function table */
-     *func_stack,	/* function call stack */
-     *var_stack;	/* variable stack */
-
-int  func_off,		/* function stack offset */
-     var_off,		/* variable stack offset */
-     *op_stack,		/* assignment operator stack */
-     op_off,		/* assignment operator offset */
-     work,		/* integer work value */
-     while_nest,	/* current while nest level */
-     in_func;		/* in or not in function body, for variable declares */
-
-s_func *nf;		/* current function header */
-
 struct fix_if {
   s_instr *fix_true;	/* where true branches around else */
   s_instr *fix_false;	/* where if-false goes to */
-} *ifs;
+};
 
 struct fix_while {
   s_instr *loop;	/* where end-of-while should loop to */
   s_instr *fix_br;	/* where while expr should branch on false */
-} *whiles;
+};
 
 struct intrin intrinsics[20] = {
   {"*dummy*",	NULL},
@@ -83,314 +58,1325 @@ struct intrin intrinsics[20] = {
   {"sqrt",	c_sqrt},
   {"batsiz",	c_batsiz},
   {"canrng",	c_canrng},
-  {"",		NULL}
+  {"",		NULL},
+  [I_POLICY] = {"policy", c_policy}	/* of policy robots only */
 };
 
 
 /* yyerror - simple error message on parser failure */
-void yyerror(char *s)
+void yyerror(void *scanner, s_comp *cc, const char *s)
 {
   int i;
-  r_flag = 1;
-  fprintf(f_out,"\n");
-  for (i = 1; i < column; i++)
-    fprintf(f_out," ");
-  fprintf(f_out,"^\n");
-  fprintf(f_out,"** Error line %d ** %s\n", yylineno, s);
+  cc->error = 1;
+  if (!cc->out)
+    return;
+  fprintf(cc->out,"\n");
+  for (i = 1; i < cc->column; i++)
+    fprintf(cc->out," ");
+  fprintf(cc->out,"^\n");
+  fprintf(cc->out,"** Error line %d ** %s\n", yyget_lineno(scanner), s);
 }
 
 
-/* init_comp - initializes the compiler for one file */
-/* assumes robot structure allocated and pointed to by cur->robot */
-void init_comp(void) 
+/* clearid - empty an identifier stack, keeping its room */
+static void clearid(s_idstack *stack)
 {
-  register int i;
+  while (stack->top > 0)
+    free(stack->id[stack->top--]);
+}
 
-  /* these tables freed after the entire file is compiled */
-  ifs = (struct fix_if *) malloc(sizeof (struct fix_if) * NESTLEVEL);
-  if_nest = 0;
-  whiles = (struct fix_while *) malloc(sizeof (struct fix_while) * NESTLEVEL);
-  while_nest = 0;
 
-  /* compiler flags */
-  column = 0;
-  num_parm = 0;
-  num_instr = 0;
-  in_func = 0;
-  r_flag = 0;  /* global error flag */
-  undeclared = 0;
-  postfix = 0;
+/* init_comp - initializes the compiler for one file */
+/* assumes robot structure allocated, compiles from in to the robot */
+void init_comp(s_comp *cc, s_robot *r, FILE *in, const s_compopt *opt)
+{
+  cc->robot = r;
+  cc->out = opt->out;
+  cc->debug = opt->debug && opt->out;
+  cc->max_instr = opt->max_instr;
+  cc->optimize = opt->optimize;
+  cc->stack_size = opt->stack_size;
+  yylex_init_extra(cc, &cc->scanner);
+  yyset_in(in, cc->scanner);
+
+  /* these tables freed after the entire file is compiled, they grow */
+  /* with the nesting of the source, see new_if() and new_while() */
+  cc->if_room = 16;
+  cc->ifs = (struct fix_if *) malloc(sizeof (struct fix_if) * cc->if_room);
+  cc->if_nest = 0;
+  cc->while_room = 16;
+  cc->whiles = (struct fix_while *) malloc(sizeof (struct fix_while) * cc->while_room);
+  cc->while_nest = 0;
 
-  strncpy(last_ident,"",ILEN);
-  strncpy(func_ident,"",ILEN);
+  /* compiler flags */
+  cc->column = 0;
+  cc->num_parm = 0;
+  cc->num_instr = 0;
+  cc->in_func = 0;
+  cc->error = 0;  /* compile error flag */
+  cc->undeclared = 0;
+  cc->postfix = 0;
+
+  cc->last_ident = strdup("");	/* any length, see setid() */
+  cc->func_ident = strdup("");
+
+  cc->ext_tab = sym_new();   /* freed after file */
+  cc->var_tab = sym_new();   /* cleared after function, freed after file */
+
+  cc->func_tab = sym_new();  /* should not be freed, part of program */
+
+  /* pending identifiers and operators, grow as needed, freed after file */
+  memset(&cc->var_stack, 0, sizeof (s_idstack));
+  memset(&cc->func_stack, 0, sizeof (s_idstack));
+
+  cc->op_room = 16;
+  cc->op_stack = (int *) malloc(cc->op_room * sizeof (int));
+  cc->op_off = 0;
+
+  /* allocate code space in a program, code should not be freed */
+  cc->prog = prog_new();
+  cc->prog->code = malloc(cc->max_instr * sizeof(s_instr));
+  cc->prog->pool = malloc(cc->max_instr * sizeof(long));
+  cc->prog->pool_count = 0;
+  cc->instruct = cc->prog->code;
+}
 
-  ext_tab = malloc(MAXSYM * ILEN);   /* freed after file */
-  var_tab = malloc(MAXSYM * ILEN);   /* freed after function */
 
-  func_tab = malloc(MAXSYM * ILEN);  /* should not be freed, part of robot */
+/* intrinsic_tab - a symbol table of the intrinsics, offsets by index */
+static s_symtab *intrinsic_tab(void)
+{
+  s_symtab *t = sym_new();
+  int j;
 
-  var_stack = malloc(MAXSYM * ILEN);  /* freed after file */
-  var_off = 0;
+  for (j = 0; *intrinsics[j].n != '\0'; j++)
+    sym_add(t, intrinsics[j].n);
+  return (t);
+}
 
-  func_stack = malloc(MAXSYM * ILEN);  /* freed after file */
-  func_off = 0;
 
-  op_stack = (int *) malloc(MAXSYM * sizeof (int)); /* freed after file */
-  op_off = 0;
+/* comp_warnings - report the warnings of a robot, unless out is NULL; */
+/*                 returns their number */
+int comp_warnings(FILE *out, int undeclared, int postfix)
+{
+  int warnings = 0;
 
-  /* allocate code space in robot, code should not be freed */
-  cur_robot->code_list = NULL;
-  cur_robot->code = malloc(g_config.max_instr * sizeof(s_instr));
-  instruct = cur_robot->code;
+  if (undeclared > 0) {
+    if (out)
+      fprintf(out, "  ** Warning: %d undeclared variables!\n", undeclared);
+    warnings++;
+  }
 
-  /* initialize all tables */
-  for (i = 0; i < MAXSYM; i++) {
-    *(ext_tab + (i * ILEN)) = '\0';
-    *(var_tab + (i * ILEN)) = '\0';
-    *(func_tab+ (i * ILEN)) = '\0';
-    *(var_stack + (i * ILEN)) = '\0';
-    *(func_stack + (i * ILEN)) = '\0';
-    *(op_stack + i) = 0;
+  if (postfix > 0) {
+    if (out)
+      fprintf(out, "  ** Warning: %d postfix operators, treated as prefix operators!\n" ,postfix);
+    warnings++;
   }
 
+  return (warnings);
 }
 
 
 /* reset_comp - resets the compiler for another file */
-/* completes the robot structure */
-int reset_comp(void) 
+/* completes the program, and makes the robot run it */
+int reset_comp(s_comp *cc)
 {
   s_func *chain;
+  s_symtab *defined;
   int mainfunc = 0;
   int warnings = 0;
-  int found = 0;
   int good = 1;
   int ext_size;
-  int i, j;
+  int i;
 
-  fprintf(f_out, "  code utilization: %3d%%   (%4d / %4d)\n",
-	  (int) (((long) num_instr) * 100L / g_config.max_instr) ,num_instr,g_config.max_instr);
+  if (cc->out)
+    fprintf(cc->out, "  code utilization: %3d%%   (%4d / %4d)\n",
+	    (int) (((long) cc->num_instr) * 100L / cc->max_instr) ,cc->num_instr,cc->max_instr);
 
   /* check for too many intructions */
-  if (num_instr == g_config.max_instr) {
-    fprintf(f_out, "  ** Error: instruction space exceeded!\n");
-    r_flag = 1;
+  if (cc->num_instr == cc->max_instr) {
+    if (cc->out)
+      fprintf(cc->out, "  ** Error: instruction space exceeded!\n");
+    cc->error = 1;
     good = 0;
   }
 
   /* check func_tab to code_list for missing functions (accept intrinsics) */
   /* this ensures no functions are referenced that are not coded or intrinsic */
-  for (i = 0; *(func_tab + (i * ILEN)) != '\0'; i++) {
-    found = 0;
-    for (chain = cur_robot->code_list; chain; chain = chain->nextfunc) {
-      if (strcmp((func_tab + (i *ILEN)),chain->func_name) == 0) {
-	found = 1;
-	break;
+  defined = intrinsic_tab();
+  for (chain = cc->prog->code_list; chain; chain = chain->nextfunc) {
+    if (sym_find(defined, chain->func_name) == -1)
+      sym_add(defined, chain->func_name);
+  }
+
+  for (i = 0; i < cc->func_tab->count; i++) {
+    if (sym_find(defined, SYM_NAME(cc->func_tab, i)) == -1) {
+      if (cc->out)
+	fprintf(cc->out, "  ** Error: function '%s (%d)' referenced, but not defined or intrinsic!\n",
+		SYM_NAME(cc->func_tab, i), i);
+      good = 0;
+      cc->error = 1;
+    }
+  }
+  sym_free(defined);
+
+  /* make sure that a main was declared */
+  mainfunc = sym_find(cc->func_tab, "main") != -1;
+
+  if (!mainfunc) {
+    if (cc->out)
+      fprintf(cc->out, "  ** Error: 'main()' not defined!\n");
+    good = 0;
+    cc->error = 1;
+  }
+
+  warnings = comp_warnings(cc->out, cc->undeclared, cc->postfix);
+
+  if (cc->out)
+    fflush(cc->out);
+
+  /* clean up compiler tables and flags, the counts of warnings stay in */
+  /* the context for cache_save() */
+  cc->num_parm = 0;
+  cc->num_instr = 0;
+  cc->in_func = 0;
+  ext_size = poolsize(cc->ext_tab);
+  yylex_destroy(cc->scanner);
+  free(cc->ifs);
+  free(cc->whiles);
+  sym_free(cc->ext_tab);
+  sym_free(cc->var_tab);
+  clearid(&cc->var_stack);
+  clearid(&cc->func_stack);
+  free(cc->var_stack.id);
+  free(cc->func_stack.id);
+  free(cc->op_stack);
+  free(cc->last_ident);
+  free(cc->func_ident);
+
+  /* if compile was ok, then the robot runs the program, with an external */
+  /* pool and a stack of its own */
+  if (good) {
+    cc->prog->ext_count = ext_size;
+    cc->prog->funcs = cc->func_tab;
+    cc->instruct->ins_type = NOP;
+    cc->instruct->arg = 0;
+    cc->prog->pool = realloc(cc->prog->pool,
+			       (cc->prog->pool_count + 1) * sizeof(long));
+    prog_attach(cc->robot, cc->prog, cc->stack_size);
+  } else {
+    sym_free(cc->func_tab);
+    prog_free(cc->prog);
+  }
+  cc->prog = NULL;
+
+  if (cc->out && !good)
+    fputs("  ** Robot disqualified!\n\n", cc->out);
+  else if (cc->out && warnings)
+    fputs("\n", cc->out);
+
+  return good;
+}
+
+
+/* optimize_comp - the passes of the level of optimization of a compile, */
+/*                 on the robot it compiled without error */
+void optimize_comp(s_comp *cc)
+{
+  s_program *p = cc->robot->prog;
+
+  if (cc->optimize > 0)
+    optimize_code(p, cc->out, cc->debug);
+  if (cc->optimize > 1 && inline_code(p, cc->out, cc->debug, cc->max_instr))
+    optimize_code(p, cc->out, cc->debug);
+}
+
+
+/* foldable - whether x op y of constants can be done by the compiler, */
+/*            that is whenever it cannot trap at run time */
+static int foldable(int op, long x, long y)
+{
+  if (op == OP_MOD && y == 0L)
+    return (0);
+  if ((op == OP_DIV || op == OP_MOD) && y == -1L && x == LONG_MIN)
+    return (0);
+  return (1);
+}
+
+
+/* compact - drop the dead instructions of a robot, moving branches and */
+/*           function entries to the next live one; returns the new length */
+static int compact(s_program *p, int len, char *dead, long *k)
+{
+  s_func *f;
+  int *map, *to;
+  int i, n;
+
+  map = malloc((len + 1) * sizeof(int));
+  to = malloc((len + 1) * sizeof(int));
+  for (i = 0, n = 0; i <= len; i++) {
+    map[i] = n;
+    to[i] = p->code[i].ins_type == BRANCH ? i + p->code[i].arg : i;
+    if (i < len && !dead[i])
+      n++;
+  }
+
+  for (i = 0; i < len; i++) {
+    if (dead[i])
+      continue;
+    p->code[map[i]] = p->code[i];
+    k[map[i]] = k[i];
+    if (p->code[i].ins_type == BRANCH)
+      p->code[map[i]].arg = map[to[i]] - map[i];
+  }
+  p->code[n] = p->code[len];
+  for (f = p->code_list; f; f = f->nextfunc)
+    f->first = p->code + map[f->first - p->code];
+
+  memset(dead, 0, len);
+  free(to);
+  free(map);
+  return (n);
+}
+
+
+/* optimize_code - fold constants, thread branches and drop unreachable */
+/* code of a compiled robot, before link_code(); repeated until nothing */
+/* changes, as each step can make room for the others.  A robot takes */
+/* fewer cycles to do the same work, so this is optional, see -O.  The */
+/* report goes to out, unless NULL, and the code too if debug */
+void optimize_code(s_program *p, FILE *out, int debug)
+{
+  s_func *f;
+  s_instr *c;
+  char *dead, *target, *reach;
+  int *work;
+  long *k, *pool;
+  int len, before, folded, threaded, unreachable, changed, drop;
+  int i, t, top, steps;
+
+  for (len = 0; p->code[len].ins_type != NOP; len++)
+    ;
+  before = len;
+  folded = threaded = unreachable = 0;
+
+  /* constants by instruction while the code moves, pooled again at the end */
+  k = calloc(len + 1, sizeof(long));
+  for (i = 0; i < len; i++) {
+    if (p->code[i].ins_type == CONST)
+      k[i] = I_K(p, p->code + i);
+  }
+  dead = calloc(len + 1, 1);
+  target = malloc(len + 1);
+  reach = malloc(len + 1);
+  work = malloc((len + 1) * sizeof(int));
+
+  do {
+    changed = 0;
+
+    memset(target, 0, len + 1);
+    for (f = p->code_list; f; f = f->nextfunc)
+      target[f->first - p->code] = 1;
+    for (i = 0; i < len; i++) {
+      if (p->code[i].ins_type == BRANCH)
+	target[i + p->code[i].arg] = 1;
+    }
+
+    /* CONST x, CONST y, BINOP --> CONST x op y */
+    /* CONST !0, BRANCH and CONST 0, BRANCH to the next --> nothing */
+    drop = 0;
+    for (i = 0; i < len; i++) {
+      c = p->code + i;
+      if (c->ins_type != CONST || target[i + 1])
+	continue;
+
+      if (i + 2 < len && (c + 1)->ins_type == CONST &&
+	  IS_BINOP((c + 2)->ins_type) && !target[i + 2] &&
+	  foldable(I_OP(c + 2), k[i], k[i + 1])) {
+	k[i] = operate(I_OP(c + 2), k[i], k[i + 1]);
+	dead[i + 1] = dead[i + 2] = 1;
+	drop += 2;
+	folded++;
+	i += 2;
+      } else if (i + 1 < len && (c + 1)->ins_type == BRANCH &&
+		 (k[i] != 0L || (c + 1)->arg == 1)) {
+	dead[i] = dead[i + 1] = 1;
+	drop += 2;
+	threaded++;
+	i++;
+      }
+    }
+    if (drop) {
+      len = compact(p, len, dead, k);
+      changed = 1;
+      continue;
+    }
+
+    /* a branch to CONST 0, BRANCH goes to where that one goes; */
+    /* the steps are bounded, for loops that branch to themselves */
+    for (i = 0; i < len; i++) {
+      if (p->code[i].ins_type != BRANCH)
+	continue;
+      t = i + p->code[i].arg;
+      for (steps = 0; steps < len && t + 1 < len &&
+	     p->code[t].ins_type == CONST && k[t] == 0L &&
+	     p->code[t + 1].ins_type == BRANCH &&
+	     t + 1 + p->code[t + 1].arg != t; steps++)
+	t = t + 1 + p->code[t + 1].arg;
+      if (t != i + p->code[i].arg) {
+	p->code[i].arg = t - i;
+	threaded++;
+	changed = 1;
+      }
+    }
+
+    /* code no path from a function entry leads to; a BRANCH is taken */
+    /* always after a CONST 0, unless it is a target of another */
+    memset(reach, 0, len + 1);
+    top = 0;
+    for (f = p->code_list; f; f = f->nextfunc) {
+      reach[f->first - p->code] = 1;
+      work[top++] = f->first - p->code;
+    }
+    while (top > 0) {
+      i = work[--top];
+      if (i >= len)
+	continue;
+      c = p->code + i;
+      if (c->ins_type == BRANCH) {
+	t = i + c->arg;
+	if (!reach[t]) {
+	  reach[t] = 1;
+	  work[top++] = t;
+	}
+	if (i > 0 && (c - 1)->ins_type == CONST && k[i - 1] == 0L &&
+	    !target[i])
+	  continue;
+      } else if (c->ins_type == RETSUB) {
+	continue;
+      }
+      if (!reach[i + 1]) {
+	reach[i + 1] = 1;
+	work[top++] = i + 1;
+      }
+    }
+    for (i = 0; i < len; i++) {
+      if (!reach[i]) {
+	dead[i] = 1;
+	drop++;
       }
     }
+    unreachable += drop;
+    if (drop) {
+      len = compact(p, len, dead, k);
+      changed = 1;
+    }
+  } while (changed);
+
+  /* only the constants still in use */
+  pool = p->pool;
+  p->pool = malloc((len + 1) * sizeof(long));
+  p->pool_count = 0;
+  for (i = 0; i < len; i++) {
+    if (p->code[i].ins_type == CONST)
+      p->code[i].arg = add_const(p, k[i]);
+  }
+  p->pool = realloc(p->pool, (p->pool_count + 1) * sizeof(long));
+  free(pool);
+
+  free(work);
+  free(reach);
+  free(target);
+  free(dead);
+  free(k);
+
+  if (!out)
+    return;
+  fprintf(out, "  optimized: %d instructions to %d, %d folded,"
+	  " %d branches threaded or dropped, %d unreachable\n",
+	  before, len, folded, threaded, unreachable);
+  if (debug) {
+    fprintf(out,"\n\nOptimized code:\n");
+    decompile(out, p, p->code);
+    fprintf(out,"\n");
+  }
+}
 
-    /* if not found as a coded function, check the intrinsic table */
-    for (j = 0; *intrinsics[j].n != '\0'; j++) {
-      if (strcmp((func_tab + (i * ILEN)),intrinsics[j].n) == 0) {
-	found = 1;
+
+/* a function of a program, as inline_code() sees it */
+struct inl {
+  s_func *f;
+  int first, end;		/* its code, first .. end - 1 */
+  int regular;			/* the stack depth is known at each call */
+  int leaf;			/* calls no coded function */
+  int nret;			/* returns in its code */
+  int maxloc;			/* highest local offset used */
+  int sites, done;		/* calls of it, and those inlined */
+  const char *why;		/* why a call was not inlined */
+  int gone;			/* inlined at every call, code dropped */
+};
+
+
+/* depth - walk every path of a function from its entry, as verify_code() */
+/*         does, noting the depth of the stack before each instruction */
+/*         and the frame of each call made outside the arguments of */
+/*         another; returns 0 if the depth is not the same wherever paths */
+/*         meet, or a path branches out of the function */
+static int depth(s_program *p, struct inl *c, int *callee, int *dep,
+		 int *frame, int *frames, int *work)
+{
+  s_instr *code = p->code;
+  int top, nf, i, t, d, n;
+  int zero;			/* the last instruction pushed 0 */
+
+  top = 0;
+  dep[c->first] = 0;
+  work[top++] = c->first;
+
+  while (top > 0) {
+    i = work[--top];
+    d = dep[i];
+    nf = 0;
+    zero = 0;
+
+    /* one straight line of code, until a return or a path met */
+    for (;;) {
+      switch (code[i].ins_type) {
+	case FETCH:
+	case CONST:
+	  d++;
+	  break;
+
+	case BINOP_OP ... BINOP_OP + NOPS - 1:
+	case STORE_OP ... STORE_OP + NOPS - 1:
+	case CHOP:
+	  d--;
+	  break;
+
+	case ENTER:
+	  d += code[i].arg;
+	  break;
+
+	case LEAVE:
+	  d -= code[i].arg;
+	  break;
+
+	case FRAME:
+	  frames[nf++] = i;
+	  break;
+
+	case FCALL:
+	  n = I_VAR(code + i);
+	  if (nf == 0 || n < 0 || n >= p->funcs->count || callee[n] == -2)
+	    return (0);
+	  t = frames[--nf];
+	  if (callee[n] >= 0) {
+	    c->leaf = 0;
+	    frame[i] = nf == 0 ? t : -1;
+	  }
+	  d = dep[t];
+	  break;
+
+	case BRANCH:
+	  d--;
+	  t = i + code[i].arg;
+	  if (nf > 0 || code[i].arg == 0 || t < c->first || t >= c->end)
+	    return (0);
+	  if (dep[t] < 0) {
+	    dep[t] = d;
+	    work[top++] = t;
+	  } else if (dep[t] != d) {
+	    return (0);
+	  }
+	  if (zero)			/* always taken, a return inlined */
+	    goto ended;
+	  break;
+
+	case RETSUB:
+	  if (d != 1 || nf > 0)
+	    return (0);
+	  break;
+
+	default:
+	  return (0);
+      }
+      if (d < 0)
+	return (0);
+      if (code[i].ins_type == RETSUB)
+	break;
+      zero = code[i].ins_type == CONST && I_K(p, code + i) == 0L;
+
+      if (++i >= c->end)		/* after the last branch of a loop */
+	break;
+      if (dep[i] >= 0) {		/* paths meet, outside any call */
+	if (nf > 0 || dep[i] != d)
+	  return (0);
 	break;
       }
+      dep[i] = d;
     }
+  ended:
+    ;
+  }
 
-    /* make sure that a main was declared */
-    if (strcmp("main", (func_tab + (i * ILEN))) == 0)
-      mainfunc = 1;
+  return (1);
+}
 
-    if (!found) {
-      fprintf(f_out, "  ** Error: function '%s (%d)' referenced, but not defined or intrinsic!\n",
-	      (func_tab + (i * ILEN)), i);
-      good = 0;
-      r_flag = 1;
+
+/* inline_code - expand calls of small functions where they are made, */
+/* after optimize_code(); returns the number of calls inlined.  A function */
+/* is inlined if it calls no coded function, so it is never recursive, */
+/* has at most INLINE_MAX instructions and the code stays within -k, the */
+/* smallest first.  The arguments stay where the caller pushed them, enter */
+/* pushes the other locals and leave drops them under the return value, */
+/* so the stack is laid out the same as for a call.  Repeated while some */
+/* function becomes a leaf by having its calls inlined; reports as */
+/* optimize_code() does */
+int inline_code(s_program *p, FILE *out, int debug, int max_instr)
+{
+  struct inl *fn, *c, *g;
+  s_func *f, **pf;
+  s_symtab *intrins;
+  s_instr *code, *to;
+  char *drop;
+  int *callee, *owner, *dep, *frame, *frames, *work, *inl, *map, *fix;
+  int *order, *bmap;
+  int len, before, nfn, total, calls, sites, grow, size, zero, ok;
+  int i, j, k, n, m, t, b, leave;
+
+  for (len = 0; p->code[len].ins_type != NOP; len++)
+    ;
+  before = len;
+
+  nfn = 0;
+  for (f = p->code_list; f; f = f->nextfunc)
+    nfn++;
+  fn = calloc(nfn + 1, sizeof(struct inl));
+  order = malloc((nfn + 1) * sizeof(int));
+  nfn = 0;
+  for (f = p->code_list; f; f = f->nextfunc)
+    fn[nfn++].f = f;
+
+  /* each name once: an intrinsic (-1), else the first coded function, */
+  /* same as link_code(), or missing (-2) */
+  callee = malloc((p->funcs->count + 1) * sizeof(int));
+  intrins = intrinsic_tab();
+  for (j = 0; j < p->funcs->count; j++) {
+    callee[j] = sym_find(intrins, SYM_NAME(p->funcs, j)) != -1 ? -1 : -2;
+    for (k = 0; callee[j] == -2 && k < nfn; k++) {
+      if (strcmp(fn[k].f->func_name, SYM_NAME(p->funcs, j)) == 0)
+	callee[j] = k;
     }
   }
+  sym_free(intrins);
 
-  if (!mainfunc) {
-    fprintf(f_out, "  ** Error: 'main()' not defined!\n");
-    good = 0;
-    r_flag = 1;
+  for (i = 0; i < len; i++) {
+    n = I_VAR(p->code + i);
+    if (p->code[i].ins_type == FCALL && n >= 0 && n < p->funcs->count &&
+	callee[n] >= 0)
+      fn[callee[n]].sites++;
   }
 
-  if (undeclared > 0) {
-    fprintf(f_out, "  ** Warning: %d undeclared variables!\n", undeclared);
-    warnings++;
+  total = 0;
+  zero = -1;
+  do {
+    code = p->code;
+    owner = malloc((len + 1) * sizeof(int));
+    dep = malloc((len + 1) * sizeof(int));
+    frame = malloc((len + 1) * sizeof(int));
+    frames = malloc((len + 1) * sizeof(int));
+    work = malloc((len + 1) * sizeof(int));
+    inl = malloc((len + 1) * sizeof(int));
+    bmap = malloc((len + 1) * sizeof(int));
+    map = malloc((len + 1) * sizeof(int));
+    drop = calloc(len + 1, 1);
+
+    /* the code of each function, up to the next one */
+    for (i = 0; i <= len; i++) {
+      owner[i] = -1;
+      dep[i] = -1;
+      frame[i] = -1;
+      inl[i] = -1;
+    }
+    for (k = 0; k < nfn; k++) {
+      if (!fn[k].gone)
+	owner[fn[k].f->first - code] = k;
+    }
+    for (i = 0, t = -1; i < len; i++) {
+      if (owner[i] >= 0) {
+	if (t >= 0)
+	  fn[t].end = i;
+	t = owner[i];
+	fn[t].first = i;
+      }
+      owner[i] = t;
+    }
+    if (t >= 0)
+      fn[t].end = len;
+
+    for (k = 0; k < nfn; k++) {
+      c = fn + k;
+      if (c->gone)
+	continue;
+      c->leaf = 1;
+      c->nret = 0;
+      c->maxloc = c->f->var_count;
+      for (i = c->first; i < c->end; i++) {
+	if (code[i].ins_type == RETSUB)
+	  c->nret++;
+	if ((code[i].ins_type == FETCH || IS_STORE(code[i].ins_type)) &&
+	    !(I_VAR(code + i) & EXTERNAL) && I_VAR(code + i) > c->maxloc)
+	  c->maxloc = I_VAR(code + i);
+      }
+      c->regular = depth(p, c, callee, dep, frame, frames, work);
+    }
+
+    /* the smallest functions first, while the code fits in -k */
+    m = 0;
+    for (k = 0; k < nfn; k++) {
+      if (fn[k].gone)
+	continue;
+      for (j = m++; j > 0 && fn[order[j - 1]].end - fn[order[j - 1]].first >
+	     fn[k].end - fn[k].first; j--)
+	order[j] = order[j - 1];
+      order[j] = k;
+    }
+
+    calls = grow = 0;
+    for (j = 0; j < m; j++) {
+      c = fn + order[j];
+      size = c->end - c->first;
+      if (strcmp(c->f->func_name, "main") == 0)
+	c->why = "main";
+      else if (!c->regular || code[c->end - 1].ins_type != RETSUB)
+	c->why = "irregular stack use";
+      else if (!c->leaf)
+	c->why = "calls other functions";
+      else if (size > INLINE_MAX)
+	c->why = "too large";
+      else
+	c->why = NULL;
+      ok = c->why == NULL;
+
+      for (i = 0, sites = 0, n = 0; i < len; i++) {
+	t = I_VAR(code + i);
+	if (code[i].ins_type != FCALL || t < 0 || t >= p->funcs->count ||
+	    callee[t] != order[j])
+	  continue;
+	sites++;
+	if (!ok)
+	  continue;
+	g = owner[i] >= 0 ? fn + owner[i] : NULL;
+	if (!g || !g->regular) {
+	  c->why = "irregular stack use in the caller";
+	} else if (dep[i] < 0) {
+	  c->why = "unreachable";
+	} else if ((t = frame[i]) < 0) {
+	  c->why = "called in the arguments of another call";
+	} else if (t == g->first || code[t - 1].ins_type != FETCH) {
+	  c->why = "irregular stack use in the caller";
+	} else if (dep[i] - dep[t] != c->f->par_count) {
+	  c->why = "arguments differ from parameters";
+	} else if (g->f->var_count + dep[t] + c->maxloc > MAXOFF) {
+	  c->why = "too many locals";
+	} else if (len + grow + size + c->nret - 3 >= max_instr) {
+	  c->why = "over the instruction limit";
+	} else {
+	  grow += size + c->nret - 3;
+	  inl[i] = order[j];
+	  drop[t - 1] = drop[t] = 1;
+	  n++;
+	}
+      }
+      c->done += n;
+      calls += n;
+      if (n > 0 && n == sites)
+	c->gone = 1;			/* not called any more */
+    }
+    total += calls;
+
+    if (calls > 0) {
+      to = malloc((len + grow + 1) * sizeof(s_instr));
+      fix = malloc((len + grow + 1) * sizeof(int));
+      for (i = 0, n = 0; i < len; i++) {
+	map[i] = n;
+	if ((owner[i] >= 0 && fn[owner[i]].gone) || drop[i])
+	  continue;
+	if (inl[i] < 0) {
+	  to[n] = code[i];
+	  fix[n++] = code[i].ins_type == BRANCH ? i + code[i].arg : -1;
+	  continue;
+	}
+
+	/* the callee's locals start at its first argument */
+	c = fn + inl[i];
+	b = fn[owner[i]].f->var_count + dep[frame[i]];
+	to[n].ins_type = ENTER;
+	to[n].arg = c->f->var_count - c->f->par_count + 1;
+	fix[n++] = -1;
+
+	/* where each instruction of the body goes, the last return falls */
+	/* through to the leave, the others branch to it */
+	for (j = c->first, m = n; j < c->end; j++) {
+	  bmap[j - c->first] = m;
+	  m += code[j].ins_type != RETSUB ? 1 : j < c->end - 1 ? 2 : 0;
+	}
+	leave = m;
+	for (j = c->first; j < c->end; j++) {
+	  to[n] = code[j];
+	  fix[n] = -1;
+	  switch (code[j].ins_type) {
+	    case FETCH:
+	    case STORE_OP ... STORE_OP + NOPS - 1:
+	      if (!(I_VAR(code + j) & EXTERNAL))
+		to[n].arg += b;
+	      n++;
+	      break;
+
+	    case BRANCH:
+	      to[n].arg = bmap[j + code[j].arg - c->first] - n;
+	      n++;
+	      break;
+
+	    case RETSUB:
+	      if (j == c->end - 1)
+		break;
+	      if (zero < 0) {
+		p->pool = realloc(p->pool, (p->pool_count + 2) * sizeof(long));
+		zero = add_const(p, 0L);
+	      }
+	      to[n].ins_type = CONST;
+	      to[n].arg = zero;
+	      fix[++n] = -1;
+	      to[n].ins_type = BRANCH;
+	      to[n].arg = leave - n;
+	      n++;
+	      break;
+
+	    default:
+	      n++;
+	      break;
+	  }
+	}
+	to[n].ins_type = LEAVE;
+	to[n].arg = c->f->var_count + 1;
+	fix[n++] = -1;
+      }
+      map[len] = n;
+      to[n].ins_type = NOP;
+      to[n].arg = 0;
+
+      for (i = 0; i < n; i++) {
+	if (fix[i] >= 0)
+	  to[i].arg = map[fix[i]] - i;
+      }
+      for (pf = &p->code_list; *pf; ) {
+	for (k = 0; fn[k].f != *pf; k++)
+	  ;
+	if (fn[k].gone) {
+	  *pf = (*pf)->nextfunc;
+	} else {
+	  (*pf)->first = to + map[fn[k].first];
+	  pf = &(*pf)->nextfunc;
+	}
+      }
+
+      free(fix);
+      free(p->code);
+      p->code = to;
+      len = n;
+    }
+
+    free(drop);
+    free(map);
+    free(bmap);
+    free(inl);
+    free(work);
+    free(frames);
+    free(frame);
+    free(dep);
+    free(owner);
+  } while (calls > 0);
+
+  if (out)
+    fprintf(out, "  inlined: %d calls, %d instructions to %d\n",
+	    total, before, len);
+  for (k = nfn - 1; k >= 0; k--) {
+    c = fn + k;
+    if (c->sites == 0)
+      continue;
+    if (out && c->done == c->sites)
+      fprintf(out, "    %-8s inlined at all %d calls%s\n", c->f->func_name,
+	      c->sites, c->gone ? ", dropped" : "");
+    else if (out && c->done > 0)
+      fprintf(out, "    %-8s inlined at %d of %d calls, not the others: %s\n",
+	      c->f->func_name, c->done, c->sites, c->why);
+    else if (out)
+      fprintf(out, "    %-8s not inlined: %s\n", c->f->func_name, c->why);
+    if (c->gone)
+      free(c->f);
   }
 
-  if (postfix > 0) {
-    fprintf(f_out, "  ** Warning: %d postfix operators, treated as prefix operators!\n" ,postfix);
-    warnings++;
+  free(callee);
+  free(order);
+  free(fn);
+
+  if (out && debug) {
+    fprintf(out,"\n\nInlined code:\n");
+    decompile(out, p, p->code);
+    fprintf(out,"\n");
   }
 
-  fflush(f_out);
-
-  /* clean up compiler tables and flags */
-  num_parm = 0;
-  num_instr = 0;
-  in_func = 0;
-  undeclared = 0;
-  postfix = 0;
-  ext_size = poolsize(ext_tab);
-  free(ifs);
-  free(whiles);
-  free(ext_tab);
-  free(var_tab);
-  free(var_stack);
-  free(func_stack);
-  free(op_stack);
-
-  /* if compile was ok, then allocate external pool, stack, and robot flags */
-  if (good) {
-    cur_robot->ext_count = ext_size;
-    cur_robot->external = (long *) malloc(cur_robot->ext_count * sizeof(long)); /*fixed size reserved*/
-    cur_robot->stackbase = (long *) malloc(DATASPACE * sizeof(long));
-    cur_robot->stackend = cur_robot->stackbase + DATASPACE;
-    cur_robot->funcs = func_tab;
-    cur_robot->status = ACTIVE;
-    instruct->ins_type = NOP;
-  } else {
-    free(func_tab);
+  return (total);
+}
+
+
+/* link_code - resolve function calls of a compiled robot */
+/* rewrites each fcall into an icall of an intrinsic or a ucall of a coded */
+/* function, so that no names are looked up while the robot runs; calls */
+/* that cannot be resolved are left as fcall, a no-op like before */
+void link_code(s_program *p)
+{
+  s_instr *code;
+  s_func *f;
+  s_symtab *intrins;
+  int *intrinsic;
+  int j, n;
+
+  for (f = p->code_list; f; f = f->nextfunc) {
+    if (strcmp(f->func_name,"main") == 0) {
+      p->entry = f;
+      break;
+    }
   }
 
-  if (!good)
-    puts("  ** Robot disqualified!\n");
-  else if (warnings)
-    puts("");
+  /* each name once: the intrinsic, else the first coded function */
+  free(p->callee);
+  p->callee = calloc(p->funcs->count + 1, sizeof(s_func *));
+  intrinsic = malloc((p->funcs->count + 1) * sizeof(int));
+  intrins = intrinsic_tab();
+  for (j = 0; j < p->funcs->count; j++)
+    intrinsic[j] = sym_find(intrins, SYM_NAME(p->funcs, j));
+  sym_free(intrins);
+  for (f = p->code_list; f; f = f->nextfunc) {
+    n = sym_find(p->funcs, f->func_name);
+    if (n != -1 && !p->callee[n])
+      p->callee[n] = f;
+  }
 
-  return good;
+  for (code = p->code; code->ins_type != NOP; code++) {
+    if (code->ins_type != FCALL)
+      continue;
+
+    n = I_VAR(code);
+    if (n < 0 || n >= p->funcs->count)
+      continue;
+
+    /* intrinsics take precedence, same as the original run time search */
+    if (intrinsic[n] != -1) {
+      code->ins_type = ICALL;
+      code->arg = intrinsic[n];
+    } else if (p->callee[n]) {
+      code->ins_type = UCALL;		/* keeps the name offset */
+    }
+  }
+
+  free(intrinsic);
+}
+
+
+/* fuse_code - combine common instruction sequences into superinstructions */
+/* only the first instruction of a sequence is changed, the others keep */
+/* their operands and are skipped; a superinstruction makes the robot wait */
+/* the cycles it saved, so scheduling is the same as for unfused code; */
+/* the counts go to out, unless NULL */
+void fuse_code(s_program *p, FILE *out)
+{
+  s_instr *code;
+  s_func *f;
+  char *target;
+  int fused[4] = { 0, 0, 0, 0 };
+  int len;
+  int i;
+
+  for (len = 0; p->code[len].ins_type != NOP; len++)
+    ;
+
+  /* instructions entered other than in sequence cannot be fused away */
+  target = calloc(len + 1, 1);
+  for (f = p->code_list; f; f = f->nextfunc)
+    target[f->first - p->code] = 1;
+  for (i = 0; i < len; i++) {
+    if (p->code[i].ins_type == BRANCH && p->code[i].arg != 0)
+      target[I_BR(p->code + i) - p->code] = 1;
+  }
+
+  for (i = 0; i < len; i++) {
+    code = p->code + i;
+
+    if (i + 2 < len && !target[i + 1] && !target[i + 2] &&
+	code->ins_type == FETCH && IS_BINOP((code + 2)->ins_type) &&
+	((code + 1)->ins_type == CONST || (code + 1)->ins_type == FETCH)) {
+      code->ins_type = (code + 1)->ins_type == CONST ? FCOP : FFOP;
+      fused[code->ins_type - FCOP]++;
+      i += 2;
+      continue;
+    }
+
+    if (i + 1 < len && !target[i + 1] && (code + 1)->ins_type == BRANCH) {
+      if (code->ins_type == CONST && I_K(p, code) == 0L) {
+	code->ins_type = JUMP;
+	fused[JUMP - FCOP]++;
+	i++;
+      } else if (IS_BINOP(code->ins_type)) {
+	code->arg = I_OP(code);
+	code->ins_type = OPBR;
+	fused[OPBR - FCOP]++;
+	i++;
+      }
+    }
+  }
+
+  free(target);
+
+  if (out)
+    fprintf(out, "  superinstructions: %d fetch-const-op, %d fetch-fetch-op,"
+	    " %d jump, %d op-branch\n",
+	    fused[0], fused[1], fused[2], fused[3]);
+}
+
+
+/* verify_code - bound the stack use of each function, after fuse_code() */
+/* walks every path from the entry of a function, with the depth of the */
+/* expression stack and the pending call frames; the depth must be the */
+/* same wherever paths meet and no path may pop what it did not push, */
+/* else the function keeps the checks.  The interpreter drops the checks */
+/* on push and pop while the stack has the room of the current instruction; */
+/* the counts go to out, unless NULL */
+void verify_code(s_program *p, FILE *out)
+{
+  s_room *room;
+  s_func *f;
+  s_instr *br;
+  char *mine;
+  int *work, *frames, *visit;
+  int len, top, nf, nvisit, peak, ok;
+  int nfunc = 0, bounded = 0, deepest = 0;
+  int i, pc, d, u;
+
+  for (len = 0; p->code[len].ins_type != NOP; len++)
+    ;
+
+  room = malloc((len + 1) * sizeof(s_room));
+  for (i = 0; i <= len; i++) {
+    room[i].need = ROOM_NONE;
+    room[i].depth = -1;		/* not reached yet */
+  }
+  mine = calloc(len + 1, 1);
+  work = malloc(2 * (len + 1) * sizeof(int));
+  frames = malloc((len + 1) * sizeof(int));
+  visit = malloc((len + 1) * sizeof(int));
+
+  for (f = p->code_list; f; f = f->nextfunc) {
+    nfunc++;
+    nvisit = 0;
+    peak = 0;
+    ok = 1;
+    top = 0;
+    work[top++] = f->first - p->code;
+    work[top++] = 0;
+
+    while (ok && top > 0) {
+      d = work[--top];
+      pc = work[--top];
+      nf = 0;
+
+      /* one straight line of code, until a return or a branch taken */
+      while (ok) {
+	if (pc < 0 || pc >= len) {
+	  ok = 0;
+	  break;
+	}
+	u = d + nf;
+	if (room[pc].depth >= 0) {	/* paths meet, outside any call */
+	  if (nf > 0 || room[pc].depth != d || room[pc].need == ROOM_NONE)
+	    ok = 0;
+	  else if (mine[pc] && room[pc].need != d)
+	    ok = 0;
+	  else if (!mine[pc] && d + room[pc].need > peak)
+	    peak = d + room[pc].need;
+	  break;
+	}
+	room[pc].depth = d;
+	room[pc].need = u;		/* slots in use, until the peak is known */
+	mine[pc] = 1;
+	visit[nvisit++] = pc;
+	if (u > peak)
+	  peak = u;
+
+	switch (p->code[pc].ins_type) {
+	  case FETCH:
+	  case CONST:
+	    if (u + 1 > peak)
+	      peak = u + 1;
+	    d++;
+	    pc++;
+	    break;
+
+	  case BINOP_OP ... BINOP_OP + NOPS - 1:
+	  case STORE_OP ... STORE_OP + NOPS - 1:
+	    ok = d >= 2;
+	    d--;
+	    pc++;
+	    break;
+
+	  case CHOP:
+	    ok = d >= 1;
+	    d--;
+	    pc++;
+	    break;
+
+	  case FRAME:
+	    if (u + 1 > peak)
+	      peak = u + 1;
+	    frames[nf++] = d;
+	    pc++;
+	    break;
+
+	  case ICALL:			/* checked, the frame restores the depth */
+	  case UCALL:
+	    ok = nf > 0;
+	    if (ok)
+	      d = frames[--nf];
+	    pc++;
+	    break;
+
+	  case ENTER:
+	    if (u + p->code[pc].arg > peak)
+	      peak = u + p->code[pc].arg;
+	    d += p->code[pc].arg;
+	    pc++;
+	    break;
+
+	  case LEAVE:
+	    ok = d > p->code[pc].arg;
+	    d -= p->code[pc].arg;
+	    pc++;
+	    break;
+
+	  case FCALL:			/* missing function, a no-op */
+	    pc++;
+	    break;
+
+	  case FCOP:
+	  case FFOP:
+	    if (u + 2 > peak)
+	      peak = u + 2;
+	    d++;
+	    pc += 3;
+	    break;
+
+	  case BRANCH:
+	  case OPBR:
+	    if (p->code[pc].ins_type == BRANCH) {
+	      br = p->code + pc;
+	      d--;
+	      pc++;
+	    } else {
+	      br = p->code + pc + 1;
+	      d -= 2;
+	      pc += 2;
+	    }
+	    ok = d >= 0 && nf == 0 && br->arg != 0;
+	    br = I_BR(br);
+	    if (ok) {
+	      work[top++] = br - p->code;
+	      work[top++] = d;
+	    }
+	    break;
+
+	  case JUMP:
+	    if (u + 1 > peak)
+	      peak = u + 1;
+	    br = p->code + pc + 1;
+	    ok = nf == 0 && br->arg != 0;
+	    if (ok)
+	      pc = I_BR(br) - p->code;
+	    break;
+
+	  case RETSUB:			/* checked, ends the path */
+	    ok = d >= 1;
+	    goto ended;
+
+	  default:
+	    ok = 0;
+	    break;
+	}
+      }
+    ended:
+      ;
+    }
+
+    for (i = 0; i < nvisit; i++) {
+      pc = visit[i];
+      mine[pc] = 0;
+      if (ok) {
+	room[pc].need = peak - room[pc].need;
+      } else {
+	room[pc].need = ROOM_NONE;
+	room[pc].depth = -1;
+      }
+    }
+    if (ok) {
+      bounded++;
+      if (peak > deepest)
+	deepest = peak;
+    }
+  }
+
+  free(visit);
+  free(frames);
+  free(work);
+  free(mine);
+
+  free(p->room);
+  p->room = room;
+
+  if (out)
+    fprintf(out, "  stack depth: %d of %d functions bounded, deepest %d\n",
+	    bounded, nfunc, deepest);
 }
 
 
 /* new_func - reset the compiler for a new function within the same file */
-int new_func(void)
+int new_func(s_comp *cc)
 {
   register int i;
   
   /* make sure name is not an intrinsic */
   for (i = 0; *(intrinsics[i].n) != '\0'; i++) {
-    if (strcmp(intrinsics[i].n,func_ident) == 0) {
-     fprintf(f_out,"\n** Error ** '%s' function definition same as intrinsic\n",
-	      func_ident);
-      r_flag = 1;
-      if (r_debug)
-        fprintf(f_out,"\n\n**new_func**\n\n");
+    if (strcmp(intrinsics[i].n,cc->func_ident) == 0) {
+      if (cc->out)
+	fprintf(cc->out,"\n** Error ** '%s' function definition same as intrinsic\n",
+		cc->func_ident);
+      cc->error = 1;
+      if (cc->debug)
+        fprintf(cc->out,"\n\n**new_func**\n\n");
       return (0);
     }
   }
 
   /* func name ok, insert a new function header */
-  nf = (s_func *) malloc(sizeof (s_func)); /* never freed */
-  nf->nextfunc = cur_robot->code_list;		/* link in */
-  cur_robot->code_list = nf;			/*  "    " */
-  strcpy(nf->func_name,func_ident);		/* copy name */
-  nf->first = instruct;			/* current instruct is start */
-  nf->var_count = 0; 				/* filled-in later */
-  nf->par_count = num_parm;			/* number of parms */
-  in_func = 1;
-  if (findvar(func_ident,func_tab) == -1)	/* add name to function table */
-    allocvar(func_ident,func_tab);
+  cc->nf = (s_func *) malloc(sizeof (s_func) + strlen(cc->func_ident) + 1);
+  cc->nf->nextfunc = cc->prog->code_list;		/* link in */
+  cc->prog->code_list = cc->nf;			/*  "    " */
+  strcpy(cc->nf->func_name,cc->func_ident);		/* copy name */
+  cc->nf->first = cc->instruct;			/* current instruct is start */
+  cc->nf->var_count = 0; 				/* filled-in later */
+  cc->nf->par_count = cc->num_parm;			/* number of parms */
+  cc->in_func = 1;
+  if (findvar(cc->func_ident,cc->func_tab) == -1)	/* add name to function table */
+    allocvar(cc, cc->func_ident,cc->func_tab);
   return (1);
 
 }
 
 
 /* end_func - cleanup the end of a function */
-void end_func(void) 
+void end_func(s_comp *cc) 
 {
-  register int i;
-
   /* fill in the space required by local variables into function header */
-  cur_robot->code_list->var_count = poolsize(var_tab);
-  num_parm = 0;
-  in_func = 0;
-  func_off = 0;
-  op_off = 0;
-  var_off = 0;
-
-  if (r_debug) {
-    fprintf(f_out,"\n\nFunction: %s\n\nLocal symbol table:\n",nf->func_name);
-    dumpoff(var_tab);
-    fprintf(f_out,"\n\nExternal symbol table:\n");
-    dumpoff(ext_tab);
-    fprintf(f_out,"\n\nFunction symbol table:\n");
-    dumpoff(func_tab);
-    fprintf(f_out,"\n\nGenerated code:\n");
-    decompile(cur_robot->code_list->first);
+  cc->prog->code_list->var_count = poolsize(cc->var_tab);
+  cc->num_parm = 0;
+  cc->in_func = 0;
+  clearid(&cc->func_stack);
+  cc->op_off = 0;
+  clearid(&cc->var_stack);
+
+  if (cc->debug) {
+    fprintf(cc->out,"\n\nFunction: %s\n\nLocal symbol table:\n",cc->nf->func_name);
+    dumpoff(cc->out, cc->var_tab);
+    fprintf(cc->out,"\n\nExternal symbol table:\n");
+    dumpoff(cc->out, cc->ext_tab);
+    fprintf(cc->out,"\n\nFunction symbol table:\n");
+    dumpoff(cc->out, cc->func_tab);
+    fprintf(cc->out,"\n\nGenerated code:\n");
+    decompile(cc->out, cc->prog, cc->prog->code_list->first);
   }
 
 
   /* initialize local variable table again */
-  for (i = 0; i < NESTLEVEL; i++) {
-    *(var_tab + (i * ILEN)) = '\0';
-  }
+  sym_clear(cc->var_tab);
 
 }
 
 
 /* allocvar - allocates a variable in a pool, returns offset */
-int allocvar(char s[], char *pool) 
+int allocvar(s_comp *cc, char s[], s_symtab *pool) 
 {
-  register int i;
-
-  for (i = 0; i < MAXSYM; i++) {
-    if (*(pool + (i * ILEN)) == '\0') {		/* pool is treated as two- */
-      strcpy(pool + (i * ILEN),s);		/* dim array, by adding ints */
-      return (i);				/* to pointers; see K&R */
-    }
-  }
-  r_flag = 1;
-  if (r_debug)
-    fprintf(f_out,"\n\n**alloc_var**\n\n");
-  fprintf(f_out,"\n\n** Error ** symbol pool exceeded\n");
+  if (pool->count <= MAXOFF)
+    return (sym_add(pool,s));
+
+  cc->error = 1;
+  if (cc->debug)
+    fprintf(cc->out,"\n\n**alloc_var**\n\n");
+  if (cc->out)
+    fprintf(cc->out,"\n\n** Error ** symbol pool exceeded\n");
   return (-1);
 }
 
 
 
 /* findvar - returns offset of variable in a pool */
-int findvar(char s[], char *pool)
+int findvar(char s[], s_symtab *pool)
 {
-  register int i;
+  return (sym_find(pool,s));
+}
 
-  for (i = 0; i < MAXSYM; i++) {
-    if (strcmp(pool + (i * ILEN),s) == 0)
-      return (i);
-  }  
-   
-  return (-1);
+
+/* setid - copy an identifier of any length to one of the compiler's */
+void setid(char **id, const char *s)
+{
+  *id = realloc(*id, strlen(s) + 1);
+  strcpy(*id, s);
 }
 
 
-/* stackid - stacks an identifier, note pointer to stack offset */
-int stackid(char id[], char *stack, int *ptr)
+/* stackid - stacks a copy of an identifier, the stack grows as needed */
+int stackid(s_comp *cc, char id[], s_idstack *stack)
 {
-  if (*ptr < MAXSYM - 1) {
-    (*ptr)++;				/* the ptr itself is incremented */
-    strcpy(stack + (*ptr * ILEN),id);
-    return (1);
-  } else {
-    r_flag = 1;
-    if (r_debug)
-      fprintf(f_out,"\n\n**stackid**\n\n");
-    return (-1);
+  (void)cc;
+  if (stack->top + 1 >= stack->room) {
+    stack->room = stack->room ? 2 * stack->room : 16;
+    stack->id = realloc(stack->id, stack->room * sizeof (char *));
+  }
+  stack->id[++stack->top] = strdup(id);
+  return (1);
+}
+
+
+/* pushop - stacks an assignment or unary operator, growing the stack */
+int pushop(s_comp *cc, int op)
+{
+  if (cc->op_off + 1 >= cc->op_room) {
+    cc->op_room *= 2;
+    cc->op_stack = realloc(cc->op_stack, cc->op_room * sizeof (int));
   }
+  *(cc->op_stack + ++cc->op_off) = op;
+  return (1);
 }
 
 
-/* popid - unstacks an identifier, note pointer to stack offset */
-int popid(char id[], char *stack, int *ptr)
+/* popid - unstacks an identifier, handing its copy over to id */
+int popid(s_comp *cc, char **id, s_idstack *stack)
 {
-  if (*ptr > 0) {
-    strcpy(id,stack + (*ptr * ILEN));
-    (*ptr)--;
+  if (stack->top > 0) {
+    free(*id);
+    *id = stack->id[stack->top--];
     return (1);
   } else {
-    r_flag = 1;
-    if (r_debug)
-      fprintf(f_out,"\n\n**popid**\n\n");
+    cc->error = 1;
+    if (cc->debug)
+      fprintf(cc->out,"\n\n**popid**\n\n");
     return (-1);
   }
 }
@@ -399,35 +1385,22 @@ int popid(char id[], char *stack, int *ptr)
 
 
 /* poolsize - returns the size of a pool */
-int poolsize(char *pool)
+int poolsize(s_symtab *pool)
 {
-  register int i;
-
-  /* count the number of items */
-  for (i = 0; i < MAXSYM; i++) {
-    if (*(pool + (i * ILEN)) == '\0')
-      return (i);
-  }  
-   
-  r_flag = 1;
-  if (r_debug)
-    fprintf(f_out,"\n\n**poolsize**\n\n");
-  return (-1);
+  return (pool->count);
 }
 
 
 /* dumpoff - print a table of names and offsets in a symbol pool */
-void dumpoff(char *pool)
+void dumpoff(FILE *out, s_symtab *pool)
 {
   register int i;
   int count = 0;
 
-  for (i = 0; i < MAXSYM; i++) {
-    if (*(pool + (i * ILEN)) == '\0')
-      return;
-    fprintf(f_out,"%4d : %-8s  ",i,pool + (i * ILEN));
+  for (i = 0; i < pool->count; i++) {
+    fprintf(out,"%4d : %-8s  ",i,SYM_NAME(pool,i));
     if (++count == 4) {
-      fprintf(f_out,"\n");
+      fprintf(out,"\n");
       count = 0;
     }
   }
@@ -438,456 +1411,420 @@ void dumpoff(char *pool)
 /* the current instruction pointer within the code space */
 
 /* efetch - emit a fetch instruction */
-int efetch(int offset)
+int efetch(s_comp *cc, int offset)
 {
-  if (++num_instr == g_config.max_instr) {
-    r_flag = 1;
-    if (r_debug)
-      fprintf(f_out,"\n\n**efetch**\n\n");
+  if (++cc->num_instr == cc->max_instr) {
+    cc->error = 1;
+    if (cc->debug)
+      fprintf(cc->out,"\n\n**efetch**\n\n");
     return (0);
   }
-  instruct->ins_type = FETCH;
-  instruct->u.var1 = offset;
-  last_ins = instruct++;
+  cc->instruct->ins_type = FETCH;
+  cc->instruct->arg = (unsigned short int) offset;
+  cc->last_ins = cc->instruct++;
   return (1);
 }
 
 
+/* op_index - the operator of a token, see OP_ASSIGN ... in crobots.h */
+static int op_index(int token)
+{
+  switch (token) {
+    case '=':		return (OP_ASSIGN);
+    case '|':
+    case OR_ASSIGN:	return (OP_OR);
+    case '^':
+    case XOR_ASSIGN:	return (OP_XOR);
+    case '&':
+    case AND_ASSIGN:	return (OP_AND);
+    case '<':		return (OP_LT);
+    case '>':		return (OP_GT);
+    case '+':
+    case ADD_ASSIGN:	return (OP_ADD);
+    case '-':
+    case SUB_ASSIGN:	return (OP_SUB);
+    case '*':
+    case MUL_ASSIGN:	return (OP_MUL);
+    case '/':
+    case DIV_ASSIGN:	return (OP_DIV);
+    case '%':
+    case MOD_ASSIGN:	return (OP_MOD);
+    case LEFT_OP:
+    case LEFT_ASSIGN:	return (OP_SHL);
+    case RIGHT_OP:
+    case RIGHT_ASSIGN:	return (OP_SHR);
+    case LE_OP:		return (OP_LE);
+    case GE_OP:		return (OP_GE);
+    case EQ_OP:		return (OP_EQ);
+    case NE_OP:		return (OP_NE);
+    case AND_OP:	return (OP_LAND);
+    case OR_OP:		return (OP_LOR);
+    case U_NEGATIVE:	return (OP_NEG);
+    case U_NOT:		return (OP_NOT);
+    case U_ONES:	return (OP_COMP);
+    default:		return (OP_NONE);
+  }
+}
+
+
 /* estore - emit a store instruction */
-int estore(int offset, int op)
+int estore(s_comp *cc, int offset, int op)
 {
-  if (++num_instr == g_config.max_instr) {
-    r_flag = 1;
-    if (r_debug)
-      fprintf(f_out,"\n\n**estore*\n\n");
+  if (++cc->num_instr == cc->max_instr) {
+    cc->error = 1;
+    if (cc->debug)
+      fprintf(cc->out,"\n\n**estore*\n\n");
     return (0);
   }
-  instruct->ins_type = STORE;
-  instruct->u.a.var2 = (short int)offset;
-  instruct->u.a.a_op = op;
-  last_ins = instruct++;
+  cc->instruct->ins_type = STORE_OP + op_index(op);
+  cc->instruct->arg = (unsigned short int) offset;
+  cc->last_ins = cc->instruct++;
   return (1);
 }
 
 
-/* econst - emit a constant instruction */
-int econst(long c)
+/* add_const - index of a constant in the pool of a robot, added if new */
+/*             the pool must have room for one more */
+int add_const(s_program *p, long c)
 {
-  if (++num_instr == g_config.max_instr) {
-    r_flag = 1;
-printf("\n\n**econst*\n\n");
+  register int i;
+
+  for (i = 0; i < p->pool_count; i++) {
+    if (p->pool[i] == c)
+      return (i);
+  }
+  p->pool[p->pool_count] = c;
+  return (p->pool_count++);
+}
+
+
+/* econst - emit a constant instruction, the constant goes in the pool */
+int econst(s_comp *cc, long c)
+{
+  if (++cc->num_instr == cc->max_instr) {
+    cc->error = 1;
+    if (cc->debug)
+      fprintf(cc->out,"\n\n**econst*\n\n");
     return (0);
   }
-  instruct->ins_type = CONST;
-  instruct->u.k = c;
-  last_ins = instruct++;
+  cc->instruct->ins_type = CONST;
+  cc->instruct->arg = add_const(cc->prog, c);
+  cc->last_ins = cc->instruct++;
   return (1);
 }
 
 
 /* ebinop - emit a binop instruction */
-int ebinop(int c)
+int ebinop(s_comp *cc, int c)
 {
-  if (++num_instr == g_config.max_instr) {
-    r_flag = 1;
-    if (r_debug)
-      fprintf(f_out,"\n\n**ebinop**\n\n");
+  if (++cc->num_instr == cc->max_instr) {
+    cc->error = 1;
+    if (cc->debug)
+      fprintf(cc->out,"\n\n**ebinop**\n\n");
     return (0);
   }
-  instruct->ins_type = BINOP;
-  instruct->u.var1 = c;
-  last_ins = instruct++;
+  cc->instruct->ins_type = BINOP_OP + op_index(c);
+  cc->instruct->arg = 0;
+  cc->last_ins = cc->instruct++;
   return (1);
 }
 
 
 /* efcall - emit a fcall instruction */
-int efcall(int c)
+int efcall(s_comp *cc, int c)
 {
-  if (++num_instr == g_config.max_instr) {
-    r_flag = 1;
-    if (r_debug)
-      fprintf(f_out,"\n\n**efcall**\n\n");
+  if (++cc->num_instr == cc->max_instr) {
+    cc->error = 1;
+    if (cc->debug)
+      fprintf(cc->out,"\n\n**efcall**\n\n");
     return (0);
   }
-  instruct->ins_type = FCALL;
-  instruct->u.var1 = c;
-  last_ins = instruct++;
+  cc->instruct->ins_type = FCALL;
+  cc->instruct->arg = c;
+  cc->last_ins = cc->instruct++;
   return (1);
 }
 
 
 /* eretsub - emit a retsub instruction */
-int eretsub(void)
+int eretsub(s_comp *cc)
 {
-  if (++num_instr == g_config.max_instr) {
-    r_flag = 1;
-    if (r_debug)
-      fprintf(f_out,"\n\n**eretsub**\n\n");
+  if (++cc->num_instr == cc->max_instr) {
+    cc->error = 1;
+    if (cc->debug)
+      fprintf(cc->out,"\n\n**eretsub**\n\n");
     return (0);
   }
-  instruct->ins_type = RETSUB;
-  last_ins = instruct++;
+  cc->instruct->ins_type = RETSUB;
+  cc->instruct->arg = 0;
+  cc->last_ins = cc->instruct++;
   return (1);
 }
 
 
 /* ebranch - emit a  branch instruction */
-int ebranch(void)
+int ebranch(s_comp *cc)
 {
-  if (++num_instr == g_config.max_instr) {
-    r_flag = 1;
-    if (r_debug)
-      fprintf(f_out,"\n\n**ebranch**\n\n");
+  if (++cc->num_instr == cc->max_instr) {
+    cc->error = 1;
+    if (cc->debug)
+      fprintf(cc->out,"\n\n**ebranch**\n\n");
     return (0);
   }
-  instruct->ins_type = BRANCH;
-  instruct->u.br = NULL;	/* must be fixed later */
-  last_ins = instruct++;
+  cc->instruct->ins_type = BRANCH;
+  cc->instruct->arg = 0;		/* must be fixed later */
+  cc->last_ins = cc->instruct++;
   return (1);
 }
 
 
 /* echop - emit a chop instruction */
-int echop(void)
+int echop(s_comp *cc)
 {
-  if (++num_instr == g_config.max_instr) {
-    r_flag = 1;
-    if (r_debug)
-      fprintf(f_out,"\n\n**echop**\n\n");
+  if (++cc->num_instr == cc->max_instr) {
+    cc->error = 1;
+    if (cc->debug)
+      fprintf(cc->out,"\n\n**echop**\n\n");
     return (0);
   }
-  instruct->ins_type = CHOP;
-  last_ins = instruct++;
+  cc->instruct->ins_type = CHOP;
+  cc->instruct->arg = 0;
+  cc->last_ins = cc->instruct++;
   return (1);
 }
 
 
 /* eframe - emit a stack frame instruction */
-int eframe(void)
+int eframe(s_comp *cc)
 {
-  if (++num_instr == g_config.max_instr) {
-    r_flag = 1;
-    if (r_debug)
-      fprintf(f_out,"\n\n**eframe**\n\n");
+  if (++cc->num_instr == cc->max_instr) {
+    cc->error = 1;
+    if (cc->debug)
+      fprintf(cc->out,"\n\n**eframe**\n\n");
     return (0);
   }
-  instruct->ins_type = FRAME;
-  last_ins = instruct++;
+  cc->instruct->ins_type = FRAME;
+  cc->instruct->arg = 0;
+  cc->last_ins = cc->instruct++;
   return (1);
 }
 
 
+/* fix_branch - point a branch instruction at its target */
+static void fix_branch(s_instr *c, s_instr *target)
+{
+  c->arg = target - c;
+}
+
+
 /* new_if - start a nest for an if statement */
-int new_if(void)
+int new_if(s_comp *cc)
 {
-  if (if_nest == NESTLEVEL) {
-    fprintf(f_out,"\n** Error ** 'if' nest level exceeded\n");
-    r_flag = 1;
-    if (r_debug)
-      fprintf(f_out,"\n\n**new_if**\n\n");
-    return (0);
+  if (cc->if_nest + 1 >= cc->if_room) {
+    cc->if_room *= 2;
+    cc->ifs = realloc(cc->ifs, sizeof (struct fix_if) * cc->if_room);
   }
 
-  if_nest++;
-  if (!ebranch())
+  cc->if_nest++;
+  if (!ebranch(cc))
     return (0);
 
   /* save the not-true branch instruction address to be fixed later */
   /* this branch jumps to the else part, if any */
-  (ifs + if_nest)->fix_false = last_ins;
+  (cc->ifs + cc->if_nest)->fix_false = cc->last_ins;
 
   return (1);
 }
 
 
 /* else_part - the else part of an if-then-else */
-int else_part(void)
+int else_part(s_comp *cc)
 {	
   /* setup a unconditional branch around the else part */
-  if (!econst(0L))
+  if (!econst(cc, 0L))
     return(0);  
-  if (!ebranch())
+  if (!ebranch(cc))
     return (0);
 
   /* save the else branch instruction address */
   /* this branch jumps around the else part, if any */
-  (ifs + if_nest)->fix_true = last_ins;
+  (cc->ifs + cc->if_nest)->fix_true = cc->last_ins;
 
   /* fix the not-true branch */
   /* the branch instrunction address was saved in new_if() */
-  (ifs + if_nest)->fix_false->u.br = instruct;
+  fix_branch((cc->ifs + cc->if_nest)->fix_false, cc->instruct);
 
   return (1);
 }
 
 
 /* close_if - close out an if nest */
-void close_if(void)
+void close_if(s_comp *cc)
 {
   /* fix the not-else branch saved in else_part() */
-  (ifs + if_nest)->fix_true->u.br = instruct;
+  fix_branch((cc->ifs + cc->if_nest)->fix_true, cc->instruct);
 
-  if_nest--;
+  cc->if_nest--;
 }
 
 
 /* new_while - start a nest for a new while statement */
-int new_while(void)
+int new_while(s_comp *cc)
 {
-  if (while_nest == NESTLEVEL) {
-    fprintf(f_out,"\n** Error ** 'while' nest level exceeded\n");
-    r_flag = 1;
-    if (r_debug)
-      fprintf(f_out,"\n\n**new_while**\n\n");
-    return (0);
+  if (cc->while_nest + 1 >= cc->while_room) {
+    cc->while_room *= 2;
+    cc->whiles = realloc(cc->whiles, sizeof (struct fix_while) * cc->while_room);
   }
-  while_nest++;
+  cc->while_nest++;
 
   /* save the target intruction for while-loop expression evaluation */
-  (whiles + while_nest)->loop = instruct;
+  (cc->whiles + cc->while_nest)->loop = cc->instruct;
 
   return (1);
 }
 
 
 /* while_expr - while expression loop fix */
-int while_expr(void)
+int while_expr(s_comp *cc)
 {
-  if (!ebranch())
+  if (!ebranch(cc))
     return (0);
 
   /* save the branch out of while-loop address to fix later */
   /* this branch jumps around the while-body */
-  (whiles + while_nest)->fix_br = last_ins;
+  (cc->whiles + cc->while_nest)->fix_br = cc->last_ins;
 
   return (1);
 }
 
 
 /* close_while - close out the while nest */
-int close_while(void)
+int close_while(s_comp *cc)
 {
   /* emit an unconditional branch */
-  if (!econst(0L))
+  if (!econst(cc, 0L))
     return (0);
-  if (!ebranch())
+  if (!ebranch(cc))
     return (0);
 
   /* fix the jump back to expression evaluation */
   /* this was saved in new_while() */
-  last_ins->u.br = (whiles + while_nest)->loop;
+  fix_branch(cc->last_ins, (cc->whiles + cc->while_nest)->loop);
 
   /* fix the not while branch */
   /* this was saved in while_expr() */
-  (whiles + while_nest)->fix_br->u.br = instruct;
+  fix_branch((cc->whiles + cc->while_nest)->fix_br, cc->instruct);
 
-  while_nest--;
+  cc->while_nest--;
   return (1);
 }
 
 
 /* decompile - print machine code */
-void decompile(s_instr * code)
+void decompile(FILE *out, s_program *p, s_instr *code)
 {
 
   while (code->ins_type != NOP) {
-    decinstr(code);
+    decinstr(out, p, code);
     code++;
   }
 }
        
 
 
-/* decinstr - print one instruct; watch out for pointer to long conversion! */
-void decinstr(s_instr *code)
+/* decinstr - print one instruct, at its offset in the code */
+void decinstr(FILE *out, s_program *p, s_instr *code)
 {
 
-  fprintf(f_out,"%8ld : ",(long) code);	/* this could be flakey */
+  fprintf(out,"%8ld : ",(long) (code - p->code));
   switch (code->ins_type) {
     case FETCH:
-      if (code->u.var1 & EXTERNAL) 
-	fprintf(f_out,"fetch   %hd external\n", (short)(code->u.var1 & ~EXTERNAL));
+      if (I_VAR(code) & EXTERNAL) 
+	fprintf(out,"fetch   %hd external\n", (short)(I_VAR(code) & ~EXTERNAL));
       else
-	fprintf(f_out,"fetch   %hd local\n", code->u.var1);
+	fprintf(out,"fetch   %hd local\n", I_VAR(code));
       break;
-    case STORE:
-      if (code->u.a.var2 & EXTERNAL)
-	fprintf(f_out,"store   %hd external, ", (short)(code->u.a.var2 & ~EXTERNAL));
+    case STORE_OP ... STORE_OP + NOPS - 1:
+      if (I_VAR(code) & EXTERNAL)
+	fprintf(out,"store   %hd external, ", (short)(I_VAR(code) & ~EXTERNAL));
       else
-	fprintf(f_out,"store   %hd local, ",code->u.a.var2);
-      printop(code->u.a.a_op);
-      fprintf(f_out,"\n");
+	fprintf(out,"store   %hd local, ",I_VAR(code));
+      printop(out, I_OP(code));
+      if (I_OP(code) != OP_ASSIGN)
+	fprintf(out,"=");
+      fprintf(out,"\n");
       break;
     case CONST:
-      fprintf(f_out,"const   %ld\n",code->u.k);
+      fprintf(out,"const   %ld\n",I_K(p, code));
       break;
-    case BINOP:
-      fprintf(f_out,"binop   ");
-      printop(code->u.var1);
-      fprintf(f_out,"\n");
+    case BINOP_OP ... BINOP_OP + NOPS - 1:
+      fprintf(out,"binop   ");
+      printop(out, I_OP(code));
+      fprintf(out,"\n");
       break;
     case FCALL:
-      fprintf(f_out,"fcall   %hd\n",code->u.var1);
+      fprintf(out,"fcall   %hd\n",I_VAR(code));
+      break;
+    case ICALL:
+      fprintf(out,"icall   %s\n",intrinsics[code->arg].n);
+      break;
+    case UCALL:
+      fprintf(out,"ucall   %s\n",I_FN(p, code)->func_name);
+      break;
+    case FCOP:
+    case FFOP:
+      if (I_VAR(code) & EXTERNAL)
+	fprintf(out,"%s    %hd external\n",code->ins_type == FCOP ? "fcop" : "ffop",
+		(short)(I_VAR(code) & ~EXTERNAL));
+      else
+	fprintf(out,"%s    %hd local\n",code->ins_type == FCOP ? "fcop" : "ffop",
+		I_VAR(code));
+      break;
+    case JUMP:
+      fprintf(out,"jump    %ld\n",(long) (I_BR(code + 1) - p->code));
+      break;
+    case OPBR:
+      fprintf(out,"opbr    ");
+      printop(out, I_OP(code));
+      fprintf(out,"\n");
       break;
     case RETSUB:
-      fprintf(f_out,"retsub\n");
+      fprintf(out,"retsub\n");
       break;
     case BRANCH:
-      fprintf(f_out,"branch  %ld\n",(long) code->u.br); /* more flakiness */
+      fprintf(out,"branch  %ld\n",(long) (I_BR(code) - p->code));
       break;
     case CHOP:
-      fprintf(f_out,"chop\n");
+      fprintf(out,"chop\n");
       break;
     case FRAME:
-      fprintf(f_out,"frame\n");
+      fprintf(out,"frame\n");
+      break;
+    case ENTER:
+      fprintf(out,"enter   %d\n",code->arg);
+      break;
+    case LEAVE:
+      fprintf(out,"leave   %d\n",code->arg);
       break;
     default:
-      fprintf(f_out,"ILLEGAL %d\n",code->ins_type);
+      fprintf(out,"ILLEGAL %d\n",code->ins_type);
       return;
   }
 }
 
 
 /* printop - print a binary operation code */
-void printop(int op)
+void printop(FILE *out, int op)
 {
-
-  switch (op) {
-
-    case  '=':
-      fprintf(f_out,"=");
-      break;
-
-    case  '|':
-      fprintf(f_out,"|");
-      break;
-
-    case  '^':
-      fprintf(f_out,"^");
-      break;
-
-    case  '&':
-      fprintf(f_out,"&");
-      break;
-
-    case  '<':
-      fprintf(f_out,"<");
-      break;
-
-    case  '>':
-      fprintf(f_out,">");
-      break;
-
-    case  '+':
-      fprintf(f_out,"+");
-      break;
-
-    case  '-':
-      fprintf(f_out,"-");
-      break;
-
-    case  '*':
-      fprintf(f_out,"*");
-      break;
-
-    case  '/':
-      fprintf(f_out,"/");
-      break;
-
-    case  '%':
-      fprintf(f_out,"%%");
-      break;
-
-    case  LEFT_OP:
-      fprintf(f_out,"<<");
-      break;
-
-    case  RIGHT_OP:
-      fprintf(f_out,">>");
-      break;
-
-    case  LE_OP:
-      fprintf(f_out,"<=");
-      break;
-
-    case  GE_OP:
-      fprintf(f_out,">=");
-      break;
-
-    case  EQ_OP:
-      fprintf(f_out,"==");
-      break;
-
-    case  NE_OP:
-      fprintf(f_out,"!=");
-      break;
-
-    case  AND_OP:
-      fprintf(f_out,"&&");
-      break;
-
-    case  OR_OP:
-      fprintf(f_out,"||");
-      break;
-
-    case  MUL_ASSIGN:
-      fprintf(f_out,"*=");
-      break;
-
-    case  DIV_ASSIGN:
-      fprintf(f_out,"/=");
-      break;
-
-    case  MOD_ASSIGN:
-      fprintf(f_out,"%%=");
-      break;
-
-    case  ADD_ASSIGN:
-      fprintf(f_out,"+=");
-      break;
-
-    case  SUB_ASSIGN:
-      fprintf(f_out,"-=");
-      break;
-
-    case  LEFT_ASSIGN:
-      fprintf(f_out,"<<=");
-      break;
-
-    case  RIGHT_ASSIGN:
-      fprintf(f_out,">>=");
-      break;
-
-    case  AND_ASSIGN:
-      fprintf(f_out,"&=");
-      break;
-
-    case  XOR_ASSIGN:
-      fprintf(f_out,"^=");
-      break;
-
-    case  OR_ASSIGN:
-      fprintf(f_out,"|=");
-      break;
-
-    case  U_NEGATIVE:
-      fprintf(f_out,"(-)");
-      break;
-
-    case  U_NOT:
-      fprintf(f_out,"(!)");
-      break;
-
-    case  U_ONES:
-      fprintf(f_out,"(~)");
-      break;
-
-    default:
-      fprintf(f_out,"ILLEGAL %d",op);
-      break;
-
-  }
+  static const char *name[NOPS] = {
+    "=", "|", "^", "&", "<", ">", "+", "-", "*", "/", "%", "<<", ">>",
+    "<=", ">=", "==", "!=", "&&", "||", "(-)", "(!)", "(~)", "?"
+  };
+
+  if (op >= 0 && op < NOPS)
+    fprintf(out,"%s",name[op]);
+  else
+    fprintf(out,"ILLEGAL %d",op);
 }
 
 /**
@@ -23,113 +23,138 @@
 
 #include <stdio.h>
 #include "crobots.h"
+#include "symtab.h"
 
 /* compiler variables */
 
-#define MAXSYM    SYMAX /* maximum number of symbol table entries per pool */
-#define NESTLEVEL 16	/* maximum nest level for ifs, whiles, and fcalls */
-
-extern char *yytext;	/* from lexical analyzer */
-extern int   yylineno;	/* from lexical analyzer */
-extern FILE *yyin,	/* flex input and output files */
-	    *yyout;
-
-extern FILE *f_in,	/* the compiler input source file */
-            *f_out;	/* the compiler diagnostic file, assumed opened */
-
-extern
-char last_ident[],	/* last identifier recognized */
-     func_ident[];	/* used on function definitions */
-/*TODO: include mainheim */
-     
-extern
-s_instr *last_ins,	/* last instruction compiled */
-        *instruct;	/* current instruction */
-
-extern
-long kk;		/* constant */
-
-extern
-int num_parm,		/* number of parameters in a function definition */
-    un_op,		/* for special unary operators */
-    num_instr,		/* counts number of instructions */
-    column,		/* from lexical analyzer */
-    if_nest,		/* current if nest level */
-    undeclared,		/* count variables that are implicit */
-    postfix;		/* count the usage of postfix operators */
-
-extern
-char *ext_tab,		/* external symbol table */
-     *var_tab,		/* local symbol table */
-     *func_tab,		/* function table */
-     *func_stack,	/* function call stack */
-     *var_stack;	/* variable stack */
-
-extern
-int  func_off,		/* function stack offset */
-     var_off,		/* variable stack offset */
-     *op_stack,		/* assignment operator stack */
-     op_off,		/* assignment operator offset */
-     work,		/* integer work value */
-     while_nest,	/* current while nest level */
-     in_func;		/* in or not in function body, for variable declares */
-
-extern
-s_func *nf;		/* current function header */
+#define MAXOFF    (EXTERNAL - 1) /* highest offset in a symbol table */
+#define INLINE_MAX 48	/* largest function inlined, see inline_code() */
+
+/* identifiers pending in calls and assignments, see stackid() */
+typedef struct idstack {
+  char **id;		/* 1 .. top, each a copy of its own */
+  int top;		/* last stacked, 0 when empty */
+  int room;		/* entries allocated */
+} s_idstack;
+
+/* how a robot is compiled, see init_comp() */
+typedef struct compopt {
+  FILE *out;		/* diagnostics and listings, NULL for none */
+  int debug;		/* full listing on out, -c and -d */
+  int max_instr;	/* instruction limit, -k */
+  int optimize;		/* level of optimize_comp(), -O */
+  int stack_size;	/* data stack of the robot, -K */
+} s_compopt;
+
+/* the state of one compile, the scanner and the parser are reentrant and */
+/* the compile reads no global settings, so each thread may compile a */
+/* robot of its own */
+typedef struct comp {
+  void *scanner;	/* reentrant flex scanner */
+  FILE *out;		/* diagnostics of this compile, NULL for none */
+  int debug,		/* full listing on out */
+      max_instr,	/* instruction limit */
+      optimize,		/* level of optimize_comp() */
+      stack_size;	/* data stack of the robot */
+  s_robot *robot;	/* robot being compiled */
+  s_program *prog;	/* its code, until reset_comp() */
+  int error;		/* set on any compile error */
+  char *last_ident,	/* last identifier recognized */
+       *func_ident;	/* used on function definitions */
+  s_instr *last_ins,	/* last instruction compiled */
+          *instruct;	/* current instruction */
+  long kk;		/* constant */
+  int num_parm,		/* number of parameters in a function definition */
+      un_op,		/* for special unary operators */
+      num_instr,	/* counts number of instructions */
+      column,		/* from lexical analyzer */
+      if_nest,		/* current if nest level */
+      undeclared,	/* count variables that are implicit */
+      postfix;		/* count the usage of postfix operators */
+  s_symtab *ext_tab,	/* external symbol table */
+           *var_tab,	/* local symbol table */
+           *func_tab;	/* function table */
+  s_idstack func_stack,	/* function call stack */
+            var_stack;	/* variable stack */
+  int  *op_stack,	/* assignment operator stack */
+       op_off,		/* assignment operator offset */
+       op_room,		/* size of op_stack */
+       work,		/* integer work value */
+       while_nest,	/* current while nest level */
+       in_func;		/* in or not in function body, for variable declares */
+  s_func *nf;		/* current function header */
+  struct fix_if *ifs;	/* open ifs by nest level */
+  struct fix_while *whiles;	/* open whiles by nest level */
+  int if_room,		/* sizes of ifs and whiles, they grow as needed */
+      while_room;
+} s_comp;
 
 struct intrin {
   char *n;
-  void (*f)();
+  void (*f)(s_arena *a);
 };
 
 extern struct intrin intrinsics[];
 
 
 /* functions */
-void yyerror(char *s);
-int yyparse(void);
-int yylex_destroy(void);
-
-void init_comp(void);
-int reset_comp(void);
-
-int new_func(void);
-void end_func(void);
-
-int allocvar(char s[], char *pool);
-int findvar(char s[], char *pool);
-
-int stackid(char id[], char *stack, int *ptr);
-int popid(char id[], char *stack, int *ptr);
-
-int poolsize(char *pool);
-void dumpoff(char *pool);
-
-int efetch(int offset);
-int estore(int offset, int op);
-
-int econst(long c);
-int ebinop(int c);
-int efcall(int c);
-
-int eretsub(void);
-int ebranch(void);
-
-int echop(void);
-int eframe(void);
-
-int new_if(void);
-int else_part(void);
-void close_if(void);
-
-int new_while(void);
-int while_expr(void);
-int close_while(void);
-
-void decompile(s_instr * code);
-void decinstr(s_instr *code);
-
-void printop(int op);
+void yyerror(void *scanner, s_comp *cc, const char *s);
+int yyparse(void *scanner, s_comp *cc);
+int yylex_init_extra(s_comp *cc, void **scanner);
+void yyset_in(FILE *in, void *scanner);
+int yyget_lineno(void *scanner);
+int yylex_destroy(void *scanner);
+
+void init_comp(s_comp *cc, s_robot *r, FILE *in, const s_compopt *opt);
+int reset_comp(s_comp *cc);
+void optimize_comp(s_comp *cc);
+int comp_warnings(FILE *out, int undeclared, int postfix);
+void optimize_code(s_program *p, FILE *out, int debug);
+int inline_code(s_program *p, FILE *out, int debug, int max_instr);
+void link_code(s_program *p);
+void fuse_code(s_program *p, FILE *out);
+void verify_code(s_program *p, FILE *out);
+
+int new_func(s_comp *cc);
+void end_func(s_comp *cc);
+
+int allocvar(s_comp *cc, char s[], s_symtab *pool);
+int findvar(char s[], s_symtab *pool);
+
+int stackid(s_comp *cc, char id[], s_idstack *stack);
+int popid(s_comp *cc, char **id, s_idstack *stack);
+int pushop(s_comp *cc, int op);
+void setid(char **id, const char *s);
+
+int poolsize(s_symtab *pool);
+void dumpoff(FILE *out, s_symtab *pool);
+
+int efetch(s_comp *cc, int offset);
+int estore(s_comp *cc, int offset, int op);
+
+int add_const(s_program *p, long c);
+int econst(s_comp *cc, long c);
+int ebinop(s_comp *cc, int c);
+int efcall(s_comp *cc, int c);
+
+int eretsub(s_comp *cc);
+int ebranch(s_comp *cc);
+
+int echop(s_comp *cc);
+int eframe(s_comp *cc);
+
+int new_if(s_comp *cc);
+int else_part(s_comp *cc);
+void close_if(s_comp *cc);
+
+int new_while(s_comp *cc);
+int while_expr(s_comp *cc);
+int close_while(s_comp *cc);
+
+void decompile(FILE *out, s_program *p, s_instr *code);
+void decinstr(FILE *out, s_program *p, s_instr *code);
+
+void printop(FILE *out, int op);
 
 #endif /* CROBOTS_COMPILER_H_ */
 
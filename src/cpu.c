@@ -19,184 +19,164 @@
 #include <stdio.h>
 #include <string.h>
 #include "crobots.h"
-#include "grammar.h"
 #include "compiler.h"
 #include "cpu.h"
 
 /* push - basic stack push mechanism */
-/*         depends on cur_robot, set r_flag on overflow */
+/*         depends on a->cur_robot, set a->r_flag on overflow */
 
-long push(long k)
+long push(s_arena *a, long k)
 {
   /* increment stack and check for collistion into return ptrs */
-  if (++cur_robot->stackptr == cur_robot->retptr) {
-    r_flag = 1;  /* signal a stack overflow, i.e., collision into returns */
+  if (++a->cur_robot->stackptr == a->cur_robot->retptr) {
+    a->r_flag = 1;  /* signal a stack overflow, i.e., collision into returns */
     return(0L);
   }
-  *cur_robot->stackptr = k;
+  *a->cur_robot->stackptr = k;
   return (k);
 }
 
 
 /* pop - basic stack pop mechanism */
-/*         depends on cur_robot, set r_flag on overflow */
+/*         depends on a->cur_robot, set a->r_flag on underflow */
 
-long pop(void)
+long pop(s_arena *a)
 {
   long v;
-  if (cur_robot->stackptr == cur_robot->stackbase) {
-    r_flag = 1;  /* signal a stack underflow */
+  if (a->cur_robot->stackptr == a->cur_robot->stackbase) {
+    a->r_flag = 1;  /* signal a stack underflow */
     return (0L);
   }
-  v = *cur_robot->stackptr;
-  cur_robot->stackptr--;
+  v = *a->cur_robot->stackptr;
+  a->cur_robot->stackptr--;
   return (v);
 }
 
 
-/* cycle - interpret one instruction for current robot */
-/*         depends on cur_robot and cur_instr */
+/* varaddr - address of a variable from its offset in either pool */
+
+static inline long *varaddr(s_robot *r, short int var)
+{
+  if (var & EXTERNAL)
+    return (r->external + (var & (short int)~EXTERNAL));
+  return (r->local + var);
+}
+
+
+/* interpret - interpret one instruction for current robot */
+/*             depends on cur_robot and cur_instr */
 
 /* any errors (stack collision, missing functions, etc) cause the 'main' */
 /* function to be restarted, with a clean stack; signal by r_flag = 1 */
 
-void cycle(void)
+static void interpret(s_arena *a)
 {
+  register s_robot *cur_robot = a->cur_robot;
   int j;
-  int c;
-  int called = 0;
   long value;
   register struct instr *cur_instr;
   struct func *f;
-  register char *n;
   struct instr **i;
   long **l;
-  long push();
-  long pop();
 
-  cur_instr = cur_robot->ip;
+  /* a superinstruction owes the cycles of the instructions it fused, */
+  /* so the robot gets no more work done per cycle than before fusion */
+  if (cur_robot->stall > 0) {
+    cur_robot->stall--;
+    return;
+  }
 
-  if (r_debug) 
-    decinstr(cur_instr);
+  cur_instr = cur_robot->ip;
 
   switch(cur_instr->ins_type) {
 
     case FETCH:		/* push a value from a variable pool */
 
-      if (cur_instr->u.var1 & EXTERNAL) 
-	push(*(cur_robot->external + (cur_instr->u.var1 & (short int)~EXTERNAL)));
-      else
-	push(*(cur_robot->local + cur_instr->u.var1));
+      push(a, *varaddr(cur_robot, I_VAR(cur_instr)));
       cur_robot->ip++;
       break;
 
 
-    case STORE:		/* store tos in a variable pool */
+    case STORE_OP ... STORE_OP + NOPS - 1:	/* store tos in a variable pool */
 
-      binaryop(cur_instr->u.a.a_op);	/* perform assignment operation */
-      if (cur_instr->u.a.var2 & EXTERNAL) 
-	*(cur_robot->external +(cur_instr->u.a.var2 & (short int)~EXTERNAL)) = push(pop());
-      else
-	*(cur_robot->local + cur_instr->u.var1) = push(pop());
+      binaryop(a, I_OP(cur_instr));	/* perform assignment operation */
+      *varaddr(cur_robot, I_VAR(cur_instr)) = push(a, pop(a));
       cur_robot->ip++;
       break;
 
       
     case CONST:		/* push a constant */
 
-      push(cur_instr->u.k);
+      push(a, I_K(cur_robot->prog, cur_instr));
       cur_robot->ip++;
       break;
 
 
-    case BINOP:		/* do a binary operation */
+    case BINOP_OP ... BINOP_OP + NOPS - 1:	/* do a binary operation */
 
-      binaryop(cur_instr->u.var1);
+      binaryop(a, I_OP(cur_instr));
       cur_robot->ip++;
       break;
 
 
-    case FCALL:
+    case ICALL:		/* call an intrinsic, resolved by link_code() */
+
+      (*intrinsics[cur_instr->arg].f)(a);  /* call the intrinsic function */
+      value = pop(a); 		/* get return value */
+
+      /* re-frame stack to ensure we discard all expressions */
+      l = (long **) cur_robot->retptr++;
+      cur_robot->stackptr = *l;
+
+      pop(a);  			/* get rid of bogus function value */
+      push(a, value);  		/* put return value on stack */
+      cur_robot->ip++;
+      break;
+
+
+    case UCALL:		/* call a coded function, resolved by link_code() */
+
+      f = I_FN(cur_robot->prog, cur_instr);
+
+      /* save next instruction pointer */
+      if (--cur_robot->retptr == cur_robot->stackptr) {
+	a->r_flag = 1;
+      }
+      i = (struct instr **) cur_robot->retptr;
+      *i = (cur_robot->ip + 1);
 
-      n = cur_robot->funcs + (cur_instr->u.var1 * ILEN); /* get function name*/
-
-      /* first, check for an intrinsic call */
-      for (j = 0; *intrinsics[j].n != '\0'; j++) {
-        if (r_debug)
-          printf("\nfunc %s found %s\n",n,intrinsics[j].n);
-	if (strcmp(intrinsics[j].n,n) == 0) {
-	  (*intrinsics[j].f)();  	/* call the intrinsic function */
-	  value = pop(); 		/* get return value */
-
-          /* re-frame stack to ensure we discard all expressions */
-          l = (long **) cur_robot->retptr++;
-          cur_robot->stackptr = *l;
-
-	  pop();  			/* get rid of bogus function value */
-	  push(value);  		/* put return value on stack */
-          cur_robot->ip++;
-	  called = 1;
-	  break;
-	}
+      /* save current local variable pointer */
+      if (--cur_robot->retptr == cur_robot->stackptr) {
+	a->r_flag = 1;
       }
+      l = (long **) cur_robot->retptr;
+      *l = cur_robot->local;
+
+      /* setup new variable pool, if any */
+      /* variable pool starts at the first of the current agruments */
+      cur_robot->local = cur_robot->stackptr - f->par_count + 1;
+
+      /* initialize all other local variables to zero */
+      for (j = f->par_count; j <= f->var_count; j++)
+	*(cur_robot->local + j) = 0L;
 
-      if (!called) {
-	/* find coded function by name */
-	/* search through function headers */
-	for (f=cur_robot->code_list; f; f=f->nextfunc) {
-	  if (r_debug)
-            printf("\nfunc %s found %s\n",n,f->func_name);
-
-	  if (strcmp(f->func_name,n) == 0) {
-	    /* save next instruction pointer */
-	    if (--cur_robot->retptr == cur_robot->stackptr) {
-	      r_flag = 1;
-	    }
-	    i = (struct instr **) cur_robot->retptr;
-	    *i = (cur_robot->ip + 1);
-	    if (r_debug)
-              printf("\nsaving  return ip %ld\n",(long)(cur_robot->ip + 1));
-
-	    /* save current local variable pointer */
-	    if (--cur_robot->retptr == cur_robot->stackptr) {
-	      r_flag = 1;
-	    }
-	    l = (long **) cur_robot->retptr;
-	    *l = cur_robot->local;
-	    if (r_debug)
-              printf("\nsaving local pool %ld\n",(long)cur_robot->local);
-
-	    /* setup new variable pool, if any */
-	    /* variable pool starts at the first of the current agruments */
-	    cur_robot->local = cur_robot->stackptr - f->par_count + 1;
-
-	    /* initialize all other local variables to zero */
-	    for (j = f->par_count; j <= f->var_count; j++)
-	      *(cur_robot->local + j) = 0L;
-
-	    /* set new stackptr just beyond the local variables */
-	    cur_robot->stackptr = cur_robot->local + f->var_count;
-
-	    /* check for collision into return stack */
-	    if (cur_robot->stackptr >= cur_robot->retptr) {
-	      r_flag = 1;
-	    }
-
-	    /* set new ip at start of module for next cycle */
-	    cur_robot->ip = f->first;
-	    called = 1;
-
-	    break;
-
-	  }
-	}
-
-	if (!called) {
-	/* big trouble -- missing function */
-	cur_robot->ip++;
-	}
+      /* set new stackptr just beyond the local variables */
+      cur_robot->stackptr = cur_robot->local + f->var_count;
+
+      /* check for collision into return stack */
+      if (cur_robot->stackptr >= cur_robot->retptr) {
+	a->r_flag = 1;
       }
 
+      /* set new ip at start of module for next cycle */
+      cur_robot->ip = f->first;
+      break;
+
+
+    case FCALL:		/* not resolved by link_code() */
+
+      /* big trouble -- missing function */
+      cur_robot->ip++;
       break;
 
 
@@ -204,53 +184,66 @@ void cycle(void)
 
       /* check for end of main */
       if (cur_robot->retptr == cur_robot->stackend) {
-        if (r_debug)
-          printf("\nend of main\n");
-        r_flag = 1;
+        a->r_flag = 1;
 	break;
       }
 
-      value = pop();     /* save return value */
-      if (r_debug) {
-        printf("\n\nreturn pointers\n");
-        dumpvar(cur_robot->retptr,3);
-      }
+      value = pop(a);     /* save return value */
 
       /* restore previous local variable pool */
       l = (long **) cur_robot->retptr++;
       cur_robot->local = *l;
-      if (r_debug)
-        printf("\nrestore local pool %ld\n",(long) cur_robot->local);
 
       /* restore next instruction pointer */
       i = (struct instr **) cur_robot->retptr++;
       cur_robot->ip = *i;
-      if (r_debug)
-        printf("\nrestore ip %ld\n",(long) cur_robot->ip);
 
       /* re-frame stack to ensure we discard all expressions */
       l = (long **) cur_robot->retptr++;
       cur_robot->stackptr = *l;
-      if (r_debug)
-        printf("\nrestore stack %ld\n",(long) cur_robot->stackptr);
 
-      pop();		/* get rid of bogus function value */
-      push(value);	/* place return value on stack */
+      pop(a);		/* get rid of bogus function value */
+      push(a, value);	/* place return value on stack */
 
       break;
 
 
     case BRANCH:	/* branch if tos == zero */
 
-      if (pop() == 0L)
-	cur_robot->ip = cur_instr->u.br;
+      if (pop(a) == 0L)
+	cur_robot->ip = I_BR(cur_instr);
       else
         cur_robot->ip++;
       break;
 
     case CHOP:		/* discard tos */
       
-      pop();
+      pop(a);
+      cur_robot->ip++;
+      break;
+
+
+    case ENTER:		/* push the zeroed locals of an inlined function */
+
+      if (cur_robot->retptr - cur_robot->stackptr > cur_instr->arg) {
+	for (j = cur_instr->arg; j > 0; j--)
+	  *++cur_robot->stackptr = 0L;
+      } else {
+	a->r_flag = 1;
+      }
+      cur_robot->ip++;
+      break;
+
+
+    case LEAVE:		/* drop the frame of an inlined function under tos */
+
+      if (cur_robot->stackptr - cur_robot->stackbase > cur_instr->arg) {
+	value = *cur_robot->stackptr;
+	cur_robot->stackptr -= cur_instr->arg;
+	*cur_robot->stackptr = value;
+      } else {
+	a->r_flag = 1;
+      }
       cur_robot->ip++;
       break;
 
@@ -259,17 +252,61 @@ void cycle(void)
 
       /* retptr grows downward toward stackptr */
       if (--cur_robot->retptr == cur_robot->stackptr) {
-	r_flag = 1;
+	a->r_flag = 1;
       }
 
       l = (long **) cur_robot->retptr;
       *l = cur_robot->stackptr;
-      if (r_debug)
-        printf("\nsave frame %ld\n",(long)cur_robot->stackptr);
 
       cur_robot->ip++;
       break;
 
+    /* superinstructions stop at the first failing step, owing only */
+    /* the cycles of the steps done, as the robot restarts there */
+
+    case FCOP:		/* fetch, const, binop */
+    case FFOP:		/* fetch, fetch, binop */
+
+      push(a, *varaddr(cur_robot,I_VAR(cur_instr)));
+      if (a->r_flag)
+	break;
+      if (cur_instr->ins_type == FCOP)
+	push(a, I_K(cur_robot->prog, cur_instr + 1));
+      else
+	push(a, *varaddr(cur_robot,I_VAR(cur_instr + 1)));
+      cur_robot->stall = 1;
+      if (a->r_flag)
+	break;
+      binaryop(a, I_OP(cur_instr + 2));
+      cur_robot->stall = 2;
+      cur_robot->ip += 3;
+      break;
+
+
+    case JUMP:		/* const 0, branch */
+
+      push(a, 0L);
+      if (a->r_flag)
+	break;
+      pop(a);
+      cur_robot->stall = 1;
+      cur_robot->ip = I_BR(cur_instr + 1);
+      break;
+
+
+    case OPBR:		/* binop, branch */
+
+      binaryop(a, I_OP(cur_instr));
+      if (a->r_flag)
+	break;
+      cur_robot->stall = 1;
+      if (pop(a) == 0L)
+	cur_robot->ip = I_BR(cur_instr + 1);
+      else
+	cur_robot->ip += 2;
+      break;
+
+
     default:
 
       cur_robot->ip++;
@@ -278,212 +315,741 @@ void cycle(void)
   }
 
   /* check for execution failure: stack corruption, etc */
-  if (r_flag) {
+  if (a->r_flag) {
     robot_go(cur_robot);	/* restart the 'main' function */
-    r_flag = 0;
-  }
-
-  if (r_debug) {
-    printf("\t\t\t\ttos %ld: * %ld\n",
-	   (long)cur_robot->stackptr,*cur_robot->stackptr);
-    printf("d,h,q,<cr>: ");
-    if ((c=getchar()) == 'd') {
-      printf("\nexternals");
-      dumpvar(cur_robot->external,cur_robot->ext_count);
-      printf("\nlocal stack");
-      dumpvar(cur_robot->local,cur_robot->stackptr - cur_robot->local + 1);
-      printf("\n\nx...........%7d",cur_robot->x);
-      printf("\ty...........%7d",cur_robot->y);
-      printf("\norg_x.......%7d",cur_robot->org_x);
-      printf("\torg_y.......%7d",cur_robot->org_y);
-      printf("\nrange.......%7d",cur_robot->range);
-      printf("\tspeed.......%7d",cur_robot->speed);
-      printf("\nd_speed.....%7d",cur_robot->d_speed);
-      printf("\theading.....%7d",cur_robot->heading);
-      printf("\nd_heading...%7d",cur_robot->d_heading);
-      printf("\tdamage......%7d",cur_robot->damage);
-      printf("\nmiss[0]stat.%7d",missiles[cur_robot-&robots[0]][0].stat);
-      printf("\tmiss[1]stat.%7d",missiles[cur_robot-&robots[0]][1].stat);
-      printf("\nmiss[0]head.%7d",missiles[cur_robot-&robots[0]][0].head);
-      printf("\tmiss[1]head.%7d",missiles[cur_robot-&robots[0]][1].head);
-      printf("\nmiss[0]x....%7d",missiles[cur_robot-&robots[0]][0].cur_x);
-      printf("\tmiss[1]y....%7d",missiles[cur_robot-&robots[0]][1].cur_y);
-      printf("\nmiss[0]dist.%7d",missiles[cur_robot-&robots[0]][0].curr_dist);
-      printf("\tmiss[1]dist.%7d",missiles[cur_robot-&robots[0]][1].curr_dist);
-      printf("\n\n");
-      getchar();
-    } else {
-      if (c == 'q') {     /* quit debugging */
-	r_flag = 1;
-      } else {            /* induce damage */
-	if (c == 'h') {
-	  cur_robot->damage += 10;
-	}
-      }
-    }
+    a->r_flag = 0;
   }
-
-
 }
      
 
-/* binaryop - pops 2 operands, performs operation, pushes result */
-/*            divide by zero handled by returning 0 */
+/* operate - performs a binary operation on x and y, returns the result */
+/*           divide by zero handled by returning 0; also used by the */
+/*           compiler to fold constants, see optimize_code() */
 
-void binaryop(int op)
+long operate(int op, long x, long y)
 {
-  long x,y;
-
-  y = pop();  /* top of stack */
-  x = pop();  /* next to top of stack */
-
-  if (r_debug)
-    printf("\nbinary operation %d, x = %ld y = %ld\n",op,x,y);
-
   switch (op) {
 
-    case  '=':
+    case  OP_ASSIGN:
       x = y;
       break;
 
-    case  '|':
+    case  OP_OR:
       x |= y;
       break;
 
-    case  '^':
+    case  OP_XOR:
       x ^= y;
       break;
 
-    case  '&':
+    case  OP_AND:
       x &= y;
       break;
 
-    case  '<':
+    case  OP_LT:
       x = x < y;
       break;
 
-    case  '>':
+    case  OP_GT:
       x = x > y;
       break;
 
-    case  '+':
+    case  OP_ADD:
       x += y;
       break;
 
-    case  '-':
+    case  OP_SUB:
       x -= y;
       break;
 
-    case  '*':
+    case  OP_MUL:
       x *= y;
       break;
 
-    case  '/':
+    case  OP_DIV:
       if (y == 0L)
 	x = 0L;
       else
         x /= y;
       break;
 
-    case  '%':
+    case  OP_MOD:
       x %= y;
       break;
 
-    case  LEFT_OP:
+    case  OP_SHL:
       x <<= y;
       break;
 
-    case  RIGHT_OP:
+    case  OP_SHR:
       x >>= y;
       break;
 
-    case  LE_OP:
+    case  OP_LE:
       x = x <= y;
       break;
 
-    case  GE_OP:
+    case  OP_GE:
       x = x >= y;
       break;
 
-    case  EQ_OP:
+    case  OP_EQ:
       x = x == y;
       break;
 
-    case  NE_OP:
+    case  OP_NE:
       x = x != y;
       break;
 
-    case  AND_OP:
+    case  OP_LAND:
       x = x && y;
       break;
 
-    case  OR_OP:
+    case  OP_LOR:
       x = x || y;
       break;
 
-    case  MUL_ASSIGN:
-      x *= y;
+    case  OP_NEG:
+      x = -x;
       break;
 
-    case  DIV_ASSIGN:
-      if (y == 0L)
-	x = 0L;
-      else
-        x /= y;
+    case  OP_NOT:
+      x = !x;
       break;
 
-    case  MOD_ASSIGN:
-      x %= y;
+    case  OP_COMP:
+      x = ~x;
       break;
 
-    case  ADD_ASSIGN:
-      x += y;
+    default:
       break;
 
-    case  SUB_ASSIGN:
-      x -= y;
-      break;
+  }
 
-    case  LEFT_ASSIGN:
-      x <<= y;
-      break;
+  return (x);
+}
 
-    case  RIGHT_ASSIGN:
-      x >>= y;
-      break;
 
-    case  AND_ASSIGN:
-      x &= y;
-      break;
+/* binaryop - pops 2 operands, performs operation, pushes result */
 
-    case  XOR_ASSIGN:
-      x ^= y;
-      break;
+void binaryop(s_arena *a, int op)
+{
+  long x,y;
 
-    case  OR_ASSIGN:
-      x |= y;
-      break;
+  y = pop(a);  /* top of stack */
+  x = pop(a);  /* next to top of stack */
 
-    case  U_NEGATIVE:
-      x = -x;
+  push(a, operate(op,x,y));
+}
+
+
+
+#ifdef THREADED_CODE
+
+/* tpush, tpop - push() and pop() for the threaded interpreter, on the */
+/*               stack pointer it keeps in a local; same error semantics */
+
+static inline long tpush(s_arena *a, s_robot *r, long **sp, long k)
+{
+  if (++*sp == r->retptr) {
+    a->r_flag = 1;
+    return (0L);
+  }
+  **sp = k;
+  return (k);
+}
+
+static inline long tpop(s_arena *a, s_robot *r, long **sp)
+{
+  if (*sp == r->stackbase) {
+    a->r_flag = 1;
+    return (0L);
+  }
+  return (*(*sp)--);
+}
+
+
+/* tvar - address of a variable, with the local pool held in lp */
+
+static inline long *tvar(s_robot *r, long *lp, short int var)
+{
+  if (var & EXTERNAL)
+    return (r->external + (var & (short int)~EXTERNAL));
+  return (lp + var);
+}
+
+
+/* roomy - whether the stack has the room verify_code() found for the */
+/*         rest of the current function, from the instruction at ip */
+
+static inline int roomy(s_robot *r, long *sp, s_instr *ip)
+{
+  s_room *room;
+
+  if (!r->prog->room)
+    return (0);
+  room = r->prog->room + (ip - r->prog->code);
+  return (r->retptr - sp > room->need && sp - r->stackbase >= room->depth);
+}
+
+
+static int threaded;		/* dispatch tables set by thread_code() */
+
+
+/* burst - interpret n instructions for current robot, token threaded */
+/*         each handler jumps to the next through a table by instruction */
+/*         type, filled once by thread_code() through this function; the */
+/*         single step debugger uses trace_cycle() instead */
+
+/* the handlers come in two sets: the checked ones test every push and */
+/* pop; the unchecked ones are used while roomy() says the function */
+/* cannot overflow or underflow the stack.  The mode is chosen again on */
+/* entry and after every call, return and restart */
+
+/* ip, stackptr and local are kept in locals for the whole burst and */
+/* written back to the robot around intrinsics and restarts.  While */
+/* unchecked, the top of the stack is kept in 'tos' as well; the slot at */
+/* sp is stale until 'tos' is stored back on leaving unchecked mode */
+
+/* each operator has its own unchecked handlers, one as a BINOP and one */
+/* as a STORE, from this list of the result of x op y, see operate() */
+#define OPERATORS(X) \
+  X(ASSIGN, y) \
+  X(OR, x | y) \
+  X(XOR, x ^ y) \
+  X(AND, x & y) \
+  X(LT, x < y) \
+  X(GT, x > y) \
+  X(ADD, x + y) \
+  X(SUB, x - y) \
+  X(MUL, x * y) \
+  X(DIV, y == 0L ? 0L : x / y) \
+  X(MOD, x % y) \
+  X(SHL, x << y) \
+  X(SHR, x >> y) \
+  X(LE, x <= y) \
+  X(GE, x >= y) \
+  X(EQ, x == y) \
+  X(NE, x != y) \
+  X(LAND, x && y) \
+  X(LOR, x || y) \
+  X(NEG, -x) \
+  X(NOT, !x) \
+  X(COMP, ~x) \
+  X(NONE, x)
+
+#define ULABELS(o, e) \
+    [BINOP_OP + OP_##o] = &&ubinop_##o, \
+    [STORE_OP + OP_##o] = &&ustore_##o,
+
+#define UHANDLERS(o, e) \
+ ubinop_##o: \
+  x = *--sp; \
+  y = tos; \
+  tos = (e); \
+  ip++; \
+  goto udone; \
+ ustore_##o: \
+  x = *--sp; \
+  y = tos; \
+  *tvar(r, lp, I_VAR(ip)) = tos = (e); \
+  ip++; \
+  goto udone;
+
+#define SAVE_VM(r)  ((r)->ip = ip, (r)->stackptr = sp, (r)->local = lp)
+#define LOAD_VM(r) (ip = (r)->ip, sp = (r)->stackptr, lp = (r)->local, \
+		    p = (r)->prog)
+#define PUSH(k)    tpush(a, r, &sp, (k))
+#define POP()      tpop(a, r, &sp)
+
+void burst(s_arena *a, int n)
+{
+  static void *const labels[] = {
+    [NOP]    = &&op_nop,
+    [FETCH]  = &&op_fetch,
+    [ENTER]  = &&op_enter,
+    [CONST]  = &&op_const,
+    [LEAVE]  = &&op_leave,
+    [FCALL]  = &&op_nop,	/* missing function */
+    [RETSUB] = &&op_retsub,
+    [BRANCH] = &&op_branch,
+    [CHOP]   = &&op_chop,
+    [FRAME]  = &&op_frame,
+    [ICALL]  = &&op_icall,
+    [UCALL]  = &&op_ucall,
+    [FCOP]   = &&op_fcop,
+    [FFOP]   = &&op_ffop,
+    [JUMP]   = &&op_jump,
+    [OPBR]   = &&op_opbr,
+    [BINOP_OP ... BINOP_OP + NOPS - 1] = &&op_binop,
+    [STORE_OP ... STORE_OP + NOPS - 1] = &&op_store
+  };
+  static void *const ulabels[] = {
+    [NOP]    = &&uop_nop,
+    [FETCH]  = &&uop_fetch,
+    [ENTER]  = &&uop_enter,
+    [CONST]  = &&uop_const,
+    [LEAVE]  = &&uop_leave,
+    [FCALL]  = &&uop_nop,
+    [RETSUB] = &&uop_call,	/* calls and returns are always checked */
+    [BRANCH] = &&uop_branch,
+    [CHOP]   = &&uop_chop,
+    [FRAME]  = &&uop_frame,
+    [ICALL]  = &&uop_call,
+    [UCALL]  = &&uop_call,
+    [FCOP]   = &&uop_fcop,
+    [FFOP]   = &&uop_ffop,
+    [JUMP]   = &&uop_jump,
+    [OPBR]   = &&uop_opbr,
+    OPERATORS(ULABELS)
+  };
+  static void *checked[256];	/* labels[] by any instruction type */
+  static void *unchecked[256];	/* ulabels[] by any instruction type */
+  register s_robot *r;
+  register s_instr *ip;
+  const s_program *p;		/* code of the robot, see LOAD_VM() */
+  long *sp;
+  long *lp;
+  struct func *f;
+  long value, x, y;
+  long tos = 0L;		/* top of the stack, while unchecked */
+  int j;
+
+  if (__builtin_expect(!threaded, 0)) {
+    if (a) {
+      while (n-- > 0)
+	interpret(a);
+      return;
+    }
+
+    for (j = 0; j < 256; j++) {	/* others are no-ops, like interpret() */
+      if (j < (int) (sizeof(labels) / sizeof(labels[0]))) {
+	checked[j] = labels[j];
+	unchecked[j] = ulabels[j];
+      } else {
+	checked[j] = &&op_nop;
+	unchecked[j] = &&uop_nop;
+      }
+    }
+    threaded = 1;
+    return;
+  }
+
+  r = a->cur_robot;
+  LOAD_VM(r);
+  if (roomy(r, sp, ip))
+    goto uenter;
+
+ next:
+  if (r->stall > 0) {		/* owed by a superinstruction */
+    r->stall--;
+    goto done;
+  }
+  goto *checked[ip->ins_type];
+
+ op_fetch:
+  PUSH(*tvar(r, lp, I_VAR(ip)));
+  ip++;
+  goto done;
+
+ op_store:
+  y = POP();
+  value = POP();
+  PUSH(operate(ip->ins_type - STORE_OP, value, y));
+  *tvar(r, lp, I_VAR(ip)) = PUSH(POP());
+  ip++;
+  goto done;
+
+ op_const:
+  PUSH(I_K(p, ip));
+  ip++;
+  goto done;
+
+ op_binop:
+  y = POP();
+  value = POP();
+  PUSH(operate(ip->ins_type - BINOP_OP, value, y));
+  ip++;
+  goto done;
+
+ op_icall:
+  r->stackptr = sp;		/* intrinsics work on cur_robot */
+  (*intrinsics[ip->arg].f)(a);
+  sp = r->stackptr;
+  value = POP();
+  sp = *(long **) r->retptr++;
+  POP();
+  PUSH(value);
+  ip++;
+  goto enter;
+
+ op_ucall:
+  f = I_FN(p, ip);
+  if (--r->retptr == sp)
+    a->r_flag = 1;
+  *(s_instr **) r->retptr = ip + 1;
+  if (--r->retptr == sp)
+    a->r_flag = 1;
+  *(long **) r->retptr = lp;
+
+  lp = sp - f->par_count + 1;
+  for (j = f->par_count; j <= f->var_count; j++)
+    *(lp + j) = 0L;
+  sp = lp + f->var_count;
+  if (sp >= r->retptr)
+    a->r_flag = 1;
+
+  ip = f->first;
+  goto enter;
+
+ op_retsub:
+  if (r->retptr == r->stackend) {
+    a->r_flag = 1;			/* end of main */
+    goto enter;
+  }
+  value = POP();
+  lp = *(long **) r->retptr++;
+  ip = *(s_instr **) r->retptr++;
+  sp = *(long **) r->retptr++;
+  POP();
+  PUSH(value);
+  goto enter;
+
+ op_branch:
+  if (POP() == 0L)
+    ip = I_BR(ip);
+  else
+    ip++;
+  goto done;
+
+ op_chop:
+  POP();
+  ip++;
+  goto done;
+
+ op_enter:
+  if (r->retptr - sp > ip->arg) {
+    for (j = ip->arg; j > 0; j--)
+      *++sp = 0L;
+  } else {
+    a->r_flag = 1;
+  }
+  ip++;
+  goto done;
+
+ op_leave:
+  if (sp - r->stackbase > ip->arg) {
+    value = *sp;
+    sp -= ip->arg;
+    *sp = value;
+  } else {
+    a->r_flag = 1;
+  }
+  ip++;
+  goto done;
+
+ op_frame:
+  if (--r->retptr == sp)
+    a->r_flag = 1;
+  *(long **) r->retptr = sp;
+  ip++;
+  goto done;
+
+ /* superinstructions take the fast path when no step can fail; */
+ /* otherwise the steps are done one by one, like interpret() */
+
+ op_fcop:
+  y = I_K(p, ip + 1);
+  goto fused_op;
+
+ op_ffop:
+  y = *tvar(r, lp, I_VAR(ip + 1));
+
+ fused_op:
+  value = *tvar(r, lp, I_VAR(ip));
+  if (sp + 2 < r->retptr) {
+    *++sp = operate((ip + 2)->ins_type - BINOP_OP, value, y);
+  } else {
+    PUSH(value);
+    if (a->r_flag)
+      goto done;
+    PUSH(y);
+    r->stall = 1;
+    if (a->r_flag)
+      goto done;
+    y = POP();
+    value = POP();
+    PUSH(operate((ip + 2)->ins_type - BINOP_OP, value, y));
+  }
+  r->stall = 2;
+  ip += 3;
+  goto done;
+
+ op_jump:
+  if (sp + 1 == r->retptr) {
+    PUSH(0L);
+    goto done;
+  }
+  r->stall = 1;
+  ip = I_BR(ip + 1);
+  goto done;
+
+ op_opbr:
+  if (sp - r->stackbase >= 2) {
+    y = *sp;
+    value = *(sp - 1);
+    sp -= 2;
+    value = operate(ip->arg, value, y);
+  } else {
+    y = POP();
+    value = POP();
+    PUSH(operate(ip->arg, value, y));
+    if (a->r_flag)
+      goto done;
+    value = POP();
+  }
+  r->stall = 1;
+  if (value == 0L)
+    ip = I_BR(ip + 1);
+  else
+    ip += 2;
+  goto done;
+
+ op_nop:
+  ip++;
+
+ done:
+  if (a->r_flag)
+    goto enter;
+  if (--n > 0)
+    goto next;
+  goto out;
+
+ enter:				/* a new function, or a new place in one */
+  if (a->r_flag) {
+    SAVE_VM(r);
+    robot_go(r);		/* restart the 'main' function */
+    a->r_flag = 0;
+    LOAD_VM(r);
+  }
+  if (--n <= 0)
+    goto out;
+  if (!roomy(r, sp, ip))
+    goto next;
+
+ uenter:
+  tos = *sp;
+
+ unext:
+  if (r->stall > 0) {
+    r->stall--;
+    goto udone;
+  }
+  goto *unchecked[ip->ins_type];
+
+ uop_fetch:
+  *sp++ = tos;
+  tos = *tvar(r, lp, I_VAR(ip));
+  ip++;
+  goto udone;
+
+ uop_const:
+  *sp++ = tos;
+  tos = I_K(p, ip);
+  ip++;
+  goto udone;
+
+ OPERATORS(UHANDLERS)
+
+ uop_branch:
+  value = tos;
+  tos = *--sp;
+  if (value == 0L)
+    ip = I_BR(ip);
+  else
+    ip++;
+  goto udone;
+
+ uop_chop:
+  tos = *--sp;
+  ip++;
+  goto udone;
+
+ uop_enter:
+  *sp = tos;
+  for (j = ip->arg; j > 0; j--)
+    *++sp = 0L;
+  tos = 0L;
+  ip++;
+  goto udone;
+
+ uop_leave:			/* tos stays, the slot it lands in is stale */
+  sp -= ip->arg;
+  ip++;
+  goto udone;
+
+ uop_frame:
+  *(long **) --r->retptr = sp;
+  ip++;
+  goto udone;
+
+ uop_fcop:
+  y = I_K(p, ip + 1);
+  goto ufused_op;
+
+ uop_ffop:
+  y = *tvar(r, lp, I_VAR(ip + 1));
+
+ ufused_op:
+  *sp++ = tos;
+  tos = operate((ip + 2)->ins_type - BINOP_OP, *tvar(r, lp, I_VAR(ip)), y);
+  r->stall = 2;
+  ip += 3;
+  goto udone;
+
+ uop_jump:
+  r->stall = 1;
+  ip = I_BR(ip + 1);
+  goto udone;
+
+ uop_opbr:
+  value = operate(ip->arg, *(sp - 1), tos);
+  sp -= 2;
+  tos = *sp;
+  r->stall = 1;
+  if (value == 0L)
+    ip = I_BR(ip + 1);
+  else
+    ip += 2;
+  goto udone;
+
+ uop_call:			/* to the checked handler, with the stack */
+  *sp = tos;
+  goto *checked[ip->ins_type];
+
+ uop_nop:
+  ip++;
+
+ udone:
+  if (--n > 0)
+    goto unext;
+  *sp = tos;
+
+ out:
+  SAVE_VM(r);
+}
+
+#undef OPERATORS
+#undef ULABELS
+#undef UHANDLERS
+#undef SAVE_VM
+#undef LOAD_VM
+#undef PUSH
+#undef POP
+
+
+/* cycle - interpret one instruction for current robot */
+
+void cycle(s_arena *a)
+{
+  burst(a, 1);
+}
+
+
+/* thread_code - set up the dispatch tables, before the first burst() */
+
+void thread_code(void)
+{
+  if (!threaded)
+    burst(NULL, 1);
+}
+
+#else
+
+/* cycle - interpret one instruction for current robot */
+
+void cycle(s_arena *a)
+{
+  interpret(a);
+}
+
+
+/* burst - interpret n instructions for current robot */
+
+void burst(s_arena *a, int n)
+{
+  while (n-- > 0)
+    interpret(a);
+}
+
+
+/* thread_code - nothing to set up for the switch interpreter */
+
+void thread_code(void)
+{
+}
+
+#endif /* THREADED_CODE */
+
+
+/* trace_cycle - interpret one instruction for current robot, showing */
+/*               what it does; the interpreter of the single step */
+/*               debugger, which keeps the others free of any debugging */
+
+void trace_cycle(s_arena *a)
+{
+  register s_robot *r = a->cur_robot;
+  s_instr *c = r->ip;
+  long *sp = r->stackptr;
+  int end = 0;
+
+  if (r->stall > 0) {		/* owed by a superinstruction */
+    interpret(a);
+    return;
+  }
+
+  decinstr(stdout, r->prog, c);
+
+  switch (c->ins_type) {
+    case BINOP_OP ... BINOP_OP + NOPS - 1:
+    case STORE_OP ... STORE_OP + NOPS - 1:
+    case OPBR:
+      if (sp - r->stackbase >= 2)
+	printf("\nbinary operation %d, x = %ld y = %ld\n",
+	       I_OP(c), *(sp - 1), *sp);
       break;
 
-    case  U_NOT:
-      x = !x;
+    case FCALL:
+      printf("\nfunc %hd not found\n", I_VAR(c));
       break;
 
-    case  U_ONES:
-      x = ~x;
+    case UCALL:
+      printf("\nsaving  return ip %ld\n", (long) (c + 1 - r->prog->code));
+      printf("\nsaving local pool %ld\n", (long) r->local);
       break;
 
-    default:
+    case RETSUB:
+      if ((end = r->retptr == r->stackend)) {
+	printf("\nend of main\n");
+      } else {
+	printf("\n\nreturn pointers\n");
+	dumpvar(r->retptr, 3);
+      }
       break;
 
+    case FRAME:
+      printf("\nsave frame %ld\n", (long) sp);
+      break;
   }
 
-  push(x);
-}
+  interpret(a);
 
+  if (c->ins_type == RETSUB && !end) {
+    printf("\nrestore local pool %ld\n", (long) r->local);
+    printf("\nrestore ip %ld\n", (long) (r->ip - r->prog->code));
+    printf("\nrestore stack %ld\n", (long) r->stackptr);
+  }
+}
 
 
 /* robot_go - start the robot pointed to by r */
@@ -493,18 +1059,15 @@ void robot_go(struct robot *r)
   register struct func *f;
   register int i;
   
-  for (f = r->code_list; f; f = f->nextfunc) {
-    if (strcmp(f->func_name,"main") == 0) {
-      r->ip = f->first;				/* start of code in main */
-      for (i = 0; i < r->ext_count; i++)	/* zero externals */
-	*(r->external + i) = 0L;
-      r->local = r->stackbase;			/* setup local variables */
-      for (i = 0; i <= f->var_count; i++)	/* zero locals */
-	*(r->local + i) = 0L;
-      r->stackptr = r->local + f->var_count;	/* set stack after locals */
-      r->retptr = r->stackend;			/* return stack starts at end*/
-      break;
-    }
+  if ((f = r->prog->entry) != NULL) {		/* main, found by link_code() */
+    r->ip = f->first;				/* start of code in main */
+    for (i = 0; i < r->prog->ext_count; i++)		/* zero externals */
+      *(r->external + i) = 0L;
+    r->local = r->stackbase;			/* setup local variables */
+    for (i = 0; i <= f->var_count; i++)		/* zero locals */
+      *(r->local + i) = 0L;
+    r->stackptr = r->local + f->var_count;	/* set stack after locals */
+    r->retptr = r->stackend;			/* return stack starts at end*/
   }
 }
 
@@ -19,10 +19,14 @@
 #ifndef CROBOTS_CPU_H_
 #define CROBOTS_CPU_H_
 
-long push(long k);
-long pop(void);
-void cycle(void);
-void binaryop(int op);
+long push(s_arena *a, long k);
+long pop(s_arena *a);
+void cycle(s_arena *a);
+void burst(s_arena *a, int n);
+void trace_cycle(s_arena *a);
+void thread_code(void);
+long operate(int op, long x, long y);
+void binaryop(s_arena *a, int op);
 void robot_go(struct robot *r);
 void dumpvar(long *pool, int size);
 
@@ -21,10 +21,14 @@
 
 #include "config.h"
 
-#define ILEN           8	/* length of identifiers, also in lexanal.l */
+#include <stdio.h>
+
+#include "rng.h"
+
 #define MAXROBOTS      4	/* maximum number of robots */
+#define MAX_WORKERS    256	/* maximum number of threads for match play */
 #define CODESPACE      INSTRMAX	/* maximum number of machine instructions (1000) */
-#define DATASPACE      DATAMAX	/* maximum number of data stack entries (500) */
+#define DATASPACE      DATAMAX	/* default number of data stack entries (500), see -K */
 #define UPDATE_CYCLES  30	/* number of cycles before screen update (30) */
 #define MOTION_CYCLES  15 	/* number of cycles before motion update (15) */
 #define CYCLE_DELAY    200	/* microseconds of sleep to slow down things when display is on*/
@@ -38,27 +42,54 @@
 
 
 
-typedef struct instr {		/* robot machine instruction */
-  char ins_type;		/* instruction type */
-  union {
-    long k;			/* constant value */
-    short int var1;		/* variable offset, function offset, operator */
-    struct instr *br;		/* false branch */
-    struct {
-      short int var2;		/* assignment variable offset */
-      short int a_op;		/* assignment operator */
-    } a;
-  } u;
+typedef struct instr {		/* robot machine instruction, 32 bits */
+  unsigned int ins_type : 8;	/* instruction type */
+  signed int arg : 24;		/* operand, see the accessors below */
 } s_instr;
 
+/* operands of the instructions, packed in 'arg' by the compiler: */
+/* a variable offset (FETCH, STORE), function name offset or intrinsic */
+/* as is; CONST an index in the program's constant pool; BRANCH an offset */
+/* to the target, 0 until fixed, see close_if() and close_while(); */
+/* the operator of BINOP and STORE is part of the instruction type */
+#define I_VAR(c)      ((short int) (c)->arg)
+#define I_OP(c)       ((c)->ins_type == OPBR ? (c)->arg : \
+		       (c)->ins_type - (IS_STORE((c)->ins_type) ? STORE_OP : BINOP_OP))
+#define I_K(p,c)      ((p)->pool[(c)->arg])
+#define I_BR(c)       ((c) + (c)->arg)
+#define I_FN(p,c)     ((p)->callee[(c)->arg])
+
 typedef struct func {		/* function header */
   struct func *nextfunc;	/* next function header in chain */
-  char func_name[ILEN];		/* function name */
   s_instr *first;		/* first instruction pointer */
   int var_count;		/* number of pool variables needed */
   int par_count;		/* number of parameters expected */
+  char func_name[];		/* function name, allocated with the header */
 } s_func;
 
+#define ROOM_NONE      0x7fffffff	/* stack use not bounded, keep the checks */
+
+typedef struct room {		/* stack use from an instruction to the return */
+  int need;			/* most slots pushed or framed, or ROOM_NONE */
+  int depth;			/* most slots popped below the stack pointer */
+} s_room;
+
+typedef struct program {	/* compiled robot, shared by its instances */
+  int refs;			/* robots running it, see prog_attach() */
+  int ext_count;		/* size of external pool needed */
+  struct symtab *funcs;		/* table of function names by offset */
+  s_func *code_list;		/* list of function headers */
+  s_func *entry;		/* header of main(), see link_code() */
+  s_instr *code;		/* machine instructions, actually instr */
+  struct jit *jit;		/* native code, see jit_compile() */
+  struct aot *aot;		/* shared object, see aot_load() */
+  struct policy *policy;	/* external policy, see policy_load() */
+  s_room *room;			/* by instruction, see verify_code() */
+  long *pool;			/* constants, see econst() */
+  int pool_count;		/* number of constants in pool */
+  s_func **callee;		/* functions by name offset, see link_code() */
+} s_program;
+
 /* Action logging structures */
 typedef struct action_log {
     int type;           /* ACTION_DRIVE, ACTION_SCAN, ACTION_CANNON */
@@ -95,18 +126,20 @@ typedef struct robot {		/* robot context */
   int scan;			/* current scan direction */
   int last_scan;		/* last scan direction */
   int reload;			/* number of cycles between reloading */
-  int ext_count;		/* size of external pool needed */
-  long *external;		/* external variable pool  (Lower MEM address) ?? */
+  s_program *prog;		/* code, read only while shared */
+  long *external;		/* external variable pool, then the stack in the */
+				/* same block, see prog_attach() */
   long *local;			/* current local variables on stack */
   long *stackbase;		/* base of local & expression stack */
   long *stackend;		/* end of stack (Higher MEM address) ?? */
   long *stackptr;		/* current stack pointer, grows up */
   long *retptr;			/* return frame pointers, grow down */
-  char *funcs;			/* table of function names by offset */
-  s_func *code_list;		/* list of function headers */
-  s_instr *code;		/* machine instructions, actually instr */
   s_instr *ip; 			/* instruction pointer */
+  int stall;			/* cycles owed by the last superinstruction */
   s_robot_actions action_buffer;	/* Action logging buffer */
+  s_rng rng;			/* random numbers of rand() */
+  struct lane *lane;		/* of the channel of a policy, see policy.c */
+  long clock;			/* cycles run in the match, by a policy */
 } s_robot;
 
 
@@ -133,27 +166,60 @@ typedef struct missile {	/* active missiles */
   int curr_dist;		/* current distance from orgin * 100 */
 } s_missile;
 
-extern s_missile missiles[MAXROBOTS][MIS_ROBOT];
-
-extern
-s_robot *cur_robot,		/* current robot */
-        robots[MAXROBOTS];	/* all robots */
-
 extern
-int r_debug,			/* debug switch */
-    r_flag;			/* global flag for push/pop errors */
+int r_debug;			/* debug switch */
 
 /* instruction types */
 #define NOP    0		/* end of code marker */
 #define FETCH  1		/* push(varpool(offset)) */
-#define STORE  2		/* push(pop op pop) --> varpool(offset) */
+#define ENTER  2		/* push arg zeros, locals of an inlined function */
 #define CONST  3		/* push(constant) */
-#define BINOP  4		/* pop -->y, pop -->x, push(x op y) */
+#define LEAVE  4		/* drop arg slots under tos, frame of an inlined one */
 #define FCALL  5		/* pop --> parmn..parm1, save ip, call */
 #define RETSUB 6		/* push(returnval), restore ip */
 #define BRANCH 7		/* if (pop == 0) branch --> ip*/
 #define CHOP   8		/* pop --> bit bucket */
 #define FRAME  9		/* frame stack pointer for call */
+#define ICALL  10		/* FCALL linked to intrinsics[var1] */
+#define UCALL  11		/* FCALL linked to function header fn */
+
+/* superinstructions, see fuse_code(); operands stay in the fused slots */
+#define FCOP   12		/* FETCH, CONST, BINOP */
+#define FFOP   13		/* FETCH, FETCH, BINOP */
+#define JUMP   14		/* CONST 0, BRANCH */
+#define OPBR   15		/* BINOP, BRANCH; the operator in arg */
+
+/* one instruction type by operator, for the former STORE and BINOP */
+#define BINOP_OP 16		/* + operator: pop -->y, pop -->x, push(x op y) */
+#define STORE_OP (BINOP_OP + NOPS)	/* + operator: push(pop op pop) --> varpool */
+#define IS_BINOP(t) ((t) >= BINOP_OP && (t) < BINOP_OP + NOPS)
+#define IS_STORE(t) ((t) >= STORE_OP && (t) < STORE_OP + NOPS)
+
+/* operators, see op_index(); assignments have the operator they combine */
+#define OP_ASSIGN 0		/* = */
+#define OP_OR     1		/* |, |= */
+#define OP_XOR    2		/* ^, ^= */
+#define OP_AND    3		/* &, &= */
+#define OP_LT     4		/* < */
+#define OP_GT     5		/* > */
+#define OP_ADD    6		/* +, += */
+#define OP_SUB    7		/* -, -= */
+#define OP_MUL    8		/* *, *= */
+#define OP_DIV    9		/* /, /=, 0 if dividing by 0 */
+#define OP_MOD    10		/* %, %= */
+#define OP_SHL    11		/* <<, <<= */
+#define OP_SHR    12		/* >>, >>= */
+#define OP_LE     13		/* <= */
+#define OP_GE     14		/* >= */
+#define OP_EQ     15		/* == */
+#define OP_NE     16		/* != */
+#define OP_LAND   17		/* && */
+#define OP_LOR    18		/* || */
+#define OP_NEG    19		/* unary -, of x */
+#define OP_NOT    20		/* unary ! */
+#define OP_COMP   21		/* unary ~ */
+#define OP_NONE   22		/* unknown, leaves x */
+#define NOPS      23
 
 /* external variable flag (or'ed in or and'ed out) , also in grammar.y */
 #define EXTERNAL 0x8000
@@ -170,18 +236,20 @@ typedef struct {
     int max_y;             /* battlefield_size (replaces MAX_Y) */
     int mis_range;         /* 70% of battlefield_size */
     int max_instr;         /* Maximum robot instruction limit (default 1000) */
+    int stack_size;        /* Data stack entries per robot (default DATASPACE) */
+    int decide;            /* Cycles between decisions of policies (default 15) */
     int snapshot_interval;  /* Cycles between snapshots (default 30) */
     int log_actions;        /* -a flag: log actions (default 1) */
     int log_rewards;        /* -r flag: log rewards (default 1) */
     int show_ascii;        /* -x flag: show ASCII visualization (default 0) */
 } config_t;
 
-extern config_t g_config;
+extern config_t g_config;	/* from the command line, copied to arenas */
 
 /* Macro aliases for seamless transition from compile-time constants */
-#define MAX_X g_config.max_x
-#define MAX_Y g_config.max_y
-#define MIS_RANGE g_config.mis_range
+#define MAX_X(a) ((a)->config.max_x)
+#define MAX_Y(a) ((a)->config.max_y)
+#define MIS_RANGE(a) ((a)->config.mis_range)
 
 /* damage factors, percent */
 #define DIRECT_HIT 10
@@ -212,6 +280,41 @@ typedef struct damage_tracker {
     int count;
 } s_damage_tracker;
 
+/* Snapshot state buffers, see snapshot.c */
+typedef struct {
+    int status;
+    int x, y;
+    int heading;
+    int speed;
+    int damage;
+    char name[14];
+} s_snapshot_robot_state;
+
+typedef struct {
+    int stat;
+    int cur_x, cur_y;
+    int head;
+    int rang_remaining;
+} s_snapshot_missile_state;
+
+typedef struct arena {		/* one battle, independent of any other */
+  s_robot robots[MAXROBOTS];	/* all robots */
+  s_missile missiles[MAXROBOTS][MIS_ROBOT];	/* their missiles */
+  s_robot *cur_robot;		/* current robot */
+  int r_flag;			/* flag for push/pop errors */
+  s_rng rng;			/* random numbers of play, e.g. placement */
+  config_t config;		/* battlefield and logging parameters */
+  s_damage_tracker damage_tracker;	/* damage since the last snapshot */
+  void (*show)(struct arena *a, int n);	/* status of robot n, see play() */
+
+  /* snapshot output, see snapshot.c */
+  FILE *snapshot_fp;
+  s_snapshot_robot_state prev_robots[MAXROBOTS];
+  s_snapshot_missile_state prev_missiles[MAXROBOTS * MIS_ROBOT];
+  int has_prev_state;
+  long prev_cycle;
+} s_arena;
+
 /* motion functions */
 
 #endif /* CROBOTS_H_ */
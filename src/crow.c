@@ -0,0 +1,894 @@
+/* crow.c - the CROBOTS simulator as a library, libcrow
+ *
+ * Copyright (C) 2026 The CROW authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * A battlefield plays a match the way one_match() in main.c does, one
+ * crow_step() at a time: every active robot gets a cycle, or a burst of
+ * them up to the next motion update, and robots and missiles move every
+ * MOTION_CYCLES.  Once one robot or none is left, or the cycle limit is
+ * reached, the missiles still flying land and the match is over.
+ */
+
+#include "config.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "crobots.h"
+#include "crow.h"
+#include "aot.h"
+#include "compiler.h"
+#include "cpu.h"
+#include "jit.h"
+#include "motion.h"
+#include "policy.h"
+#include "pool.h"
+#include "program.h"
+#include "rng.h"
+
+#if CROW_MAXROBOTS != MAXROBOTS || CROW_MISSILES != MIS_ROBOT
+#error "crow.h out of step with crobots.h"
+#endif
+
+/* debug switch of the intrinsics, set by the command line of crobots; */
+/* a battlefield has settings of its own, see settings() */
+int r_debug;
+
+struct crow {
+  s_arena arena;		/* robots, missiles and state of play */
+  int num_robots;		/* first after the arena, see crow_fork() */
+  void (*run)(s_arena *a, int n); /* burst(), jit_burst() or aot_burst() */
+  int burst;			/* cycles per robot turn */
+  long limit;			/* cycles per match */
+  long cycle;			/* cycles played, by motion update */
+  int movement;			/* cycles to the next motion update */
+  int left;			/* robots active in the last turn */
+  int done;			/* match over */
+  int match;			/* number of the match, see seed_match() */
+};
+
+/* a saved state, see crow_save_state(); integers of a fixed size only, */
+/* the pointers of a robot as offsets into its code or stack */
+#define STATE_MAGIC   0x65746174	/* "tate" */
+#define STATE_VERSION 1
+
+typedef struct blob {
+  unsigned char *out;		/* where to save, NULL once out of room */
+  const unsigned char *in;	/* what to load */
+  size_t len;			/* bytes saved or loaded */
+  size_t room;			/* size of out or in */
+  int bad;			/* loading past the end */
+} s_blob;
+
+/* the int members of a robot and a missile, in the order saved */
+static const size_t robot_ints[] = {
+  offsetof(s_robot, status), offsetof(s_robot, x), offsetof(s_robot, y),
+  offsetof(s_robot, org_x), offsetof(s_robot, org_y),
+  offsetof(s_robot, range), offsetof(s_robot, last_x),
+  offsetof(s_robot, last_y), offsetof(s_robot, speed),
+  offsetof(s_robot, last_speed), offsetof(s_robot, accel),
+  offsetof(s_robot, d_speed), offsetof(s_robot, heading),
+  offsetof(s_robot, last_heading), offsetof(s_robot, d_heading),
+  offsetof(s_robot, damage), offsetof(s_robot, last_damage),
+  offsetof(s_robot, scan), offsetof(s_robot, last_scan),
+  offsetof(s_robot, reload), offsetof(s_robot, stall)
+};
+
+static const size_t missile_ints[] = {
+  offsetof(s_missile, stat), offsetof(s_missile, beg_x),
+  offsetof(s_missile, beg_y), offsetof(s_missile, cur_x),
+  offsetof(s_missile, cur_y), offsetof(s_missile, last_xx),
+  offsetof(s_missile, last_yy), offsetof(s_missile, head),
+  offsetof(s_missile, count), offsetof(s_missile, rang),
+  offsetof(s_missile, curr_dist)
+};
+
+#define INT_AT(p,off) (*(int *) ((char *) (p) + (off)))
+#define NELEMS(a)     (sizeof(a) / sizeof((a)[0]))
+
+/* battlefields stepped in lockstep, see crow_batch_step() */
+struct crow_batch {
+  crow_t *env;			/* k battlefields, in one block */
+  int k;
+  struct pool *pool;		/* threads stepping them */
+  uint64_t seed;		/* of all matches, env i plays i + 1, i + 1 + k ... */
+  crow_obs_t *obs;		/* where the current step reports */
+  int *ended;			/* matches ended by env in this step */
+  int ended_total;		/* of all envs, see batch_done() */
+};
+
+
+/* load - compile or load robot i of a battlefield, 0 on any error */
+static int load(crow_t *c, int i, char *file, const crow_options_t *opt)
+{
+  s_robot *r = &c->arena.robots[i];
+  s_compopt copt = { opt->log, 0, c->arena.config.max_instr, opt->optimize,
+		     c->arena.config.stack_size };
+  s_comp cc;
+  FILE *in;
+  char *s;
+  int error;
+
+  if (policy_file(file)) {
+    error = !policy_load(r, file, copt.stack_size);
+  } else if (aot_file(file)) {
+    error = !aot_load(r, file, copt.stack_size);
+  } else {
+    in = fopen(file, "r");
+    if (!in)
+      return (0);
+
+    init_comp(&cc, r, in, &copt);
+    yyparse(cc.scanner, &cc);
+    reset_comp(&cc);
+    fclose(in);
+    error = cc.error;
+    if (!error)
+      optimize_comp(&cc);
+  }
+
+  if (error) {
+    prog_detach(r);
+    return (0);
+  }
+
+  link_code(r->prog);
+  fuse_code(r->prog, opt->log);
+  verify_code(r->prog, opt->log);
+  thread_code();
+  if (aot_bind(r->prog))
+    c->run = aot_burst;
+  else if (opt->jit)
+    jit_compile(r->prog);	/* or interpreted, by jit_burst() */
+
+  s = strrchr(file, '/');
+  s = s ? s + 1 : file;
+  strncpy(r->name, s, sizeof(r->name) - 1);
+  r->name[sizeof(r->name) - 1] = '\0';
+
+  return (1);
+}
+
+
+/* settings - check the options, and make them the settings of a */
+/*            battlefield as the command line would; 0 if out of range */
+static int settings(const crow_options_t *opt, config_t *cfg)
+{
+  if ((opt->battlefield && (opt->battlefield < 64 || opt->battlefield > 16384 ||
+			    (opt->battlefield & (opt->battlefield - 1)))) ||
+      (opt->max_instr && (opt->max_instr < 256 || opt->max_instr > 8000)) ||
+      (opt->stack_size && (opt->stack_size < 100 || opt->stack_size > 1000000)) ||
+      opt->optimize < 0 || opt->optimize > 2 || opt->burst < 0 || opt->limit < 0 ||
+      opt->decide < 0)
+    return (0);
+
+  memset(cfg, 0, sizeof(*cfg));
+  cfg->battlefield_size = opt->battlefield ? opt->battlefield : 1024;
+  cfg->snapshot_grid_size = 128;
+  cfg->max_x = cfg->max_y = cfg->battlefield_size;
+  cfg->mis_range = (cfg->battlefield_size * 70) / 100;
+  cfg->max_instr = opt->max_instr ? opt->max_instr : 1000;
+  cfg->stack_size = opt->stack_size ? opt->stack_size : DATASPACE;
+  cfg->decide = opt->decide ? opt->decide : MOTION_CYCLES;
+  cfg->snapshot_interval = 30;
+  cfg->log_actions = 0;		/* only snapshots of crobots read them */
+  cfg->log_rewards = 0;
+  return (1);
+}
+
+
+/* crow_open - compile the robots of a new battlefield, from source or */
+/*             shared objects; one robot is cloned to fight itself */
+crow_t *crow_open(char *const files[], int n, const crow_options_t *opt)
+{
+  static const crow_options_t none;
+  crow_t *c;
+  int i, ok = 1;
+
+  if (!opt)
+    opt = &none;
+  if (n < 1 || n > MAXROBOTS)
+    return (NULL);
+
+  c = calloc(1, sizeof(crow_t));
+  if (!c)
+    return (NULL);
+
+  /* the settings of the command line, for this battlefield only */
+  if (!settings(opt, &c->arena.config)) {
+    free(c);
+    return (NULL);
+  }
+
+  c->run = opt->jit ? jit_burst : burst;
+  c->burst = opt->burst ? opt->burst : 1;
+  c->limit = opt->limit ? opt->limit : CYCLE_LIMIT;
+
+  for (i = 0; i < MAXROBOTS; i++)
+    init_robot(&c->arena, i);
+  for (i = 0; i < n && ok; i++)
+    ok = load(c, i, files[i], opt);
+  c->num_robots = i;
+  if (ok && n == 1) {
+    c->arena.robots[1] = c->arena.robots[0];
+    prog_share(&c->arena.robots[1], &c->arena.robots[0]);
+    c->num_robots = 2;
+  }
+
+  if (!ok) {
+    crow_close(c);
+    return (NULL);
+  }
+
+  crow_reset(c, 0);
+  return (c);
+}
+
+
+/* detach - release the robots of a battlefield */
+static void detach(crow_t *c)
+{
+  int i;
+
+  for (i = 0; i < c->num_robots; i++)
+    prog_detach(&c->arena.robots[i]);
+}
+
+
+/* crow_close - release a battlefield, and its robots */
+void crow_close(crow_t *c)
+{
+  if (!c)
+    return;
+
+  detach(c);
+  free(c);
+}
+
+
+/* reseed - the random numbers of match m of a series by seed */
+static void reseed(s_arena *a, uint64_t seed, int m)
+{
+  uint64_t stream = (uint64_t) m * (MAXROBOTS + 1);	/* see seed_match() */
+  int i;
+
+  rng_seed(&a->rng, seed, stream);
+  for (i = 0; i < MAXROBOTS; i++)
+    rng_seed(&a->robots[i].rng, seed, stream + i + 1);
+}
+
+
+/* restart - start match m of a series, placing the robots by seed */
+static void restart(crow_t *c, uint64_t seed, int m)
+{
+  s_arena *a = &c->arena;
+  int i;
+
+  reseed(a, seed, m);
+  for (i = 0; i < c->num_robots; i++) {
+    init_robot(a, i);
+    robot_go(&a->robots[i]);
+    a->robots[i].status = ACTIVE;
+  }
+  rand_pos(a, c->num_robots);
+
+  c->cycle = 0L;
+  c->movement = MOTION_CYCLES;
+  c->left = c->num_robots;
+  c->done = 0;
+  c->match = m;
+}
+
+
+/* crow_reset - start a new match, placing the robots by seed; the same */
+/*              match as the first of 'crobots -S seed' */
+void crow_reset(crow_t *c, uint64_t seed)
+{
+  restart(c, seed, 1);
+}
+
+
+/* finish - let the missiles in flight land, which ends the match */
+static void finish(crow_t *c)
+{
+  s_arena *a = &c->arena;
+  int i, j, k;
+
+  do {
+    k = 0;
+    for (i = 0; i < c->num_robots; i++) {
+      for (j = 0; j < MIS_ROBOT; j++)
+	k |= a->missiles[i][j].stat == FLYING;
+    }
+    if (k) {
+      move_robots(a, 0);
+      move_miss(a, 0);
+    }
+  } while (k);
+
+  c->done = 1;
+}
+
+
+/* crow_step - play up to 'cycles' cycles of the match, 0 once it is over */
+int crow_step(crow_t *c, long cycles)
+{
+  s_arena *a = &c->arena;
+  int burst_len, alive;
+  int i, j;
+
+  while (cycles > 0 && !c->done) {
+    if (c->left < 2 || c->cycle >= c->limit) {
+      finish(c);
+      break;
+    }
+
+    /* robots only see each other move at motion updates, so bursts */
+    /* of any length up to there play the same match */
+    burst_len = c->burst < c->movement ? c->burst : c->movement;
+    if (burst_len > cycles)
+      burst_len = cycles;
+    if (burst_len > 1) {
+      for (alive = 0, i = 0; i < c->num_robots; i++)
+	alive += a->robots[i].status == ACTIVE;
+      if (alive < 2)
+	burst_len = 1;
+    }
+
+    c->left = 0;
+    for (i = 0; i < c->num_robots; i++) {
+      if (a->robots[i].status != ACTIVE)
+	continue;
+      c->left++;
+      a->cur_robot = &a->robots[i];
+      c->run(a, burst_len);
+    }
+
+    cycles -= burst_len;
+    c->movement -= burst_len;
+    if (c->movement == 0) {
+      c->cycle += MOTION_CYCLES;
+      c->movement = MOTION_CYCLES;
+      move_robots(a, 0);
+      move_miss(a, 0);
+
+      for (i = 0; i < c->num_robots; i++) {
+	for (j = 0; j < MIS_ROBOT; j++) {
+	  if (a->missiles[i][j].stat == EXPLODING)
+	    count_miss(a, i, j);
+	}
+      }
+    }
+  }
+
+  if (!c->done && (c->left < 2 || c->cycle >= c->limit))
+    finish(c);
+
+  return (!c->done);
+}
+
+
+/* crow_observe - the state of a battlefield, as the robots left it */
+void crow_observe(const crow_t *c, crow_obs_t *obs)
+{
+  observe_arena(&c->arena, obs);
+  obs->cycle = c->cycle;
+  obs->done = c->done;
+  obs->match = c->match;
+}
+
+
+/* crow_robots - the number of robots on a battlefield */
+int crow_robots(const crow_t *c)
+{
+  return (c->num_robots);
+}
+
+
+/* crow_name - the name of robot i, after its file */
+const char *crow_name(const crow_t *c, int i)
+{
+  if (i < 0 || i >= c->num_robots)
+    return (NULL);
+
+  return (c->arena.robots[i].name);
+}
+
+
+
+/* put - save n bytes, or only count them once out of room */
+static void put(s_blob *b, const void *v, size_t n)
+{
+  if (b->out && b->len + n > b->room)
+    b->out = NULL;
+  if (b->out)
+    memcpy(b->out + b->len, v, n);
+  b->len += n;
+}
+
+static void put32(s_blob *b, int32_t v)
+{
+  put(b, &v, sizeof(v));
+}
+
+static void put64(s_blob *b, int64_t v)
+{
+  put(b, &v, sizeof(v));
+}
+
+
+/* get - load n bytes, zeros past the end */
+static void get(s_blob *b, void *v, size_t n)
+{
+  if (b->bad || b->len + n > b->room) {
+    b->bad = 1;
+    memset(v, 0, n);
+    return;
+  }
+  memcpy(v, b->in + b->len, n);
+  b->len += n;
+}
+
+static int32_t get32(s_blob *b)
+{
+  int32_t v;
+
+  get(b, &v, sizeof(v));
+  return (v);
+}
+
+static int64_t get64(s_blob *b)
+{
+  int64_t v;
+
+  get(b, &v, sizeof(v));
+  return (v);
+}
+
+
+/* code_sum - a sum of the code of a program and its length, so a state */
+/*            is only loaded into robots running the same program */
+static uint32_t code_sum(const s_program *p, long *len)
+{
+  const s_instr *c;
+  const s_func *f;
+  uint32_t sum = p->ext_count;
+  int i;
+
+  for (c = p->code; c->ins_type != NOP; c++)
+    sum = sum * 31 + ((uint32_t) c->ins_type | (uint32_t) c->arg << 8);
+  for (i = 0; i < p->pool_count; i++)
+    sum = sum * 31 + (uint32_t) p->pool[i];
+  for (f = p->code_list; f; f = f->nextfunc)
+    sum = sum * 31 + (f->first - p->code) * 961 + f->var_count * 31 + f->par_count;
+  *len = c - p->code;
+  return (sum);
+}
+
+
+/* save_robot - the state of a robot; 0 if a return entry points */
+/*              neither into its code nor into its stack */
+static int save_robot(s_blob *b, const s_robot *r)
+{
+  const s_program *p = r->prog;
+  uintptr_t v, code = (uintptr_t) p->code;
+  uintptr_t base = (uintptr_t) r->stackbase;
+  long *e, len;
+  int st[3];
+  size_t i;
+
+  put32(b, code_sum(p, &len));
+  for (i = 0; i < NELEMS(robot_ints); i++)
+    put32(b, INT_AT(r, robot_ints[i]));
+  put64(b, r->clock);
+  put(b, &r->rng, sizeof(r->rng));
+  policy_state(r, st);
+  for (i = 0; i < 3; i++)
+    put32(b, st[i]);
+
+  put64(b, r->ip - p->code);
+  put64(b, r->local - r->stackbase);
+  put64(b, r->stackptr - r->stackbase);
+  put64(b, r->stackend - r->retptr);
+  for (i = 0; i < (size_t) p->ext_count; i++)
+    put64(b, r->external[i]);
+  for (e = r->stackbase; e <= r->stackptr; e++)
+    put64(b, *e);
+
+  /* return addresses, saved locals and frames, tagged by the low bit */
+  for (e = r->retptr; e < r->stackend; e++) {
+    v = (uintptr_t) *e;
+    if (v >= code && v <= code + len * sizeof(s_instr) &&
+	(v - code) % sizeof(s_instr) == 0)
+      put64(b, (int64_t) ((v - code) / sizeof(s_instr)) * 2 + 1);
+    else if (v >= base - sizeof(long) && v <= (uintptr_t) r->stackend &&
+	     (v - base) % sizeof(long) == 0)
+      put64(b, ((int64_t) (v - base) / (int64_t) sizeof(long)) * 2);
+    else
+      return (0);
+  }
+
+  return (1);
+}
+
+
+/* load_robot - check the state of a robot against its program and */
+/*              stack, and set it too if 'apply'; 0 if it does not fit */
+static int load_robot(s_blob *b, s_robot *r, int apply)
+{
+  const s_program *p = r->prog;
+  int ints[NELEMS(robot_ints)];
+  int64_t ip, local, sp, nret, v;
+  long len, room = r->stackend - r->stackbase;
+  long clock;
+  s_rng rng;
+  int st[3];
+  size_t i;
+
+  if ((uint32_t) get32(b) != code_sum(p, &len))
+    return (0);
+  for (i = 0; i < NELEMS(robot_ints); i++)
+    ints[i] = get32(b);
+  clock = get64(b);
+  get(b, &rng, sizeof(rng));
+  for (i = 0; i < 3; i++)
+    st[i] = get32(b);
+
+  ip = get64(b);
+  local = get64(b);
+  sp = get64(b);
+  nret = get64(b);
+  if (b->bad || ip < 0 || ip > len || local < 0 || local > sp || sp < 0 ||
+      nret < 0 || sp + 1 + nret > room)
+    return (0);
+
+  if (apply) {
+    for (i = 0; i < NELEMS(robot_ints); i++)
+      INT_AT(r, robot_ints[i]) = ints[i];
+    r->clock = clock;
+    r->rng = rng;
+    policy_restore(r, st);
+    r->ip = p->code + ip;
+    r->local = r->stackbase + local;
+    r->stackptr = r->stackbase + sp;
+    r->retptr = r->stackend - nret;
+  }
+
+  for (i = 0; i < (size_t) p->ext_count; i++) {
+    v = get64(b);
+    if (apply)
+      r->external[i] = v;
+  }
+  for (i = 0; i <= (size_t) sp; i++) {
+    v = get64(b);
+    if (apply)
+      r->stackbase[i] = v;
+  }
+  for (i = 0; i < (size_t) nret; i++) {
+    v = get64(b);
+    if (v & 1) {
+      if (v < 0 || v / 2 > len)
+	return (0);
+      if (apply)
+	*(s_instr **) &r->retptr[i] = p->code + v / 2;
+    } else {
+      if (v / 2 < -1 || v / 2 > room)
+	return (0);
+      if (apply)
+	*(long **) &r->retptr[i] = r->stackbase + v / 2;
+    }
+  }
+
+  return (!b->bad);
+}
+
+
+/* crow_save_state - save the match of a battlefield as it stands into */
+/*                   buf, if size is enough; returns the size of the */
+/*                   state, or 0 if it cannot be saved */
+size_t crow_save_state(const crow_t *c, void *buf, size_t size)
+{
+  const s_arena *a = &c->arena;
+  s_blob b = { buf, NULL, 0, size, 0 };
+  size_t k;
+  int i, j;
+
+  put32(&b, STATE_MAGIC);
+  put32(&b, STATE_VERSION);
+  put32(&b, c->num_robots);
+  put64(&b, c->cycle);
+  put32(&b, c->movement);
+  put32(&b, c->left);
+  put32(&b, c->done);
+  put32(&b, c->match);
+  put(&b, &a->rng, sizeof(a->rng));
+
+  for (i = 0; i < c->num_robots; i++) {
+    for (j = 0; j < MIS_ROBOT; j++) {
+      for (k = 0; k < NELEMS(missile_ints); k++)
+	put32(&b, INT_AT(&a->missiles[i][j], missile_ints[k]));
+    }
+  }
+  for (i = 0; i < c->num_robots; i++) {
+    if (!save_robot(&b, &a->robots[i]))
+      return (0);
+  }
+
+  return (b.len);
+}
+
+
+/* restore - check a state against a battlefield, and set it too if */
+/*           'apply'; 0 if it is not a state of the same robots */
+static int restore(crow_t *c, const void *buf, size_t size, int apply)
+{
+  s_arena *a = &c->arena;
+  s_blob b = { NULL, buf, 0, size, 0 };
+  int64_t cycle;
+  int32_t movement, left, done, match;
+  s_rng rng;
+  size_t k;
+  int i, j, v;
+
+  if (get32(&b) != STATE_MAGIC || get32(&b) != STATE_VERSION ||
+      get32(&b) != c->num_robots)
+    return (0);
+  cycle = get64(&b);
+  movement = get32(&b);
+  left = get32(&b);
+  done = get32(&b);
+  match = get32(&b);
+  get(&b, &rng, sizeof(rng));
+  if (movement < 1 || movement > MOTION_CYCLES)
+    return (0);
+  if (apply) {
+    c->cycle = cycle;
+    c->movement = movement;
+    c->left = left;
+    c->done = done;
+    c->match = match;
+    a->rng = rng;
+  }
+
+  for (i = 0; i < c->num_robots; i++) {
+    for (j = 0; j < MIS_ROBOT; j++) {
+      for (k = 0; k < NELEMS(missile_ints); k++) {
+	v = get32(&b);
+	if (apply)
+	  INT_AT(&a->missiles[i][j], missile_ints[k]) = v;
+      }
+    }
+  }
+  for (i = 0; i < c->num_robots; i++) {
+    if (!load_robot(&b, &a->robots[i], apply))
+      return (0);
+  }
+
+  return (!b.bad && b.len == size);
+}
+
+
+/* crow_load_state - continue from a state crow_save_state() saved of a */
+/*                   battlefield of the same robots and options; 0, and */
+/*                   the battlefield unchanged, if it is not one */
+int crow_load_state(crow_t *c, const void *buf, size_t size)
+{
+  if (!restore(c, buf, size, 0))
+    return (0);
+  return (restore(c, buf, size, 1));
+}
+
+
+/* copy_robot - the state of robot r into 'to', another instance of its */
+/*              program with a stack as large, see prog_share(); only */
+/*              the stack in use is copied, its pointers moved over */
+static void copy_robot(s_robot *to, const s_robot *r)
+{
+  long *external = to->external, *base = to->stackbase, *end = to->stackend;
+  struct lane *lane = to->lane;
+  uintptr_t lo = (uintptr_t) (r->stackbase - 1), hi = (uintptr_t) r->stackend;
+  uintptr_t delta = (uintptr_t) base - (uintptr_t) r->stackbase;
+  uintptr_t v;
+  long i, n;
+  int st[3];
+
+  *to = *r;
+  to->external = external;
+  to->stackbase = base;
+  to->stackend = end;
+  to->lane = lane;
+  policy_state(r, st);
+  policy_restore(to, st);
+
+  /* the externals and the stack are one block, see prog_attach() */
+  memcpy(external, r->external, (r->stackptr + 1 - r->external) * sizeof(long));
+  to->local = base + (r->local - r->stackbase);
+  to->stackptr = base + (r->stackptr - r->stackbase);
+
+  /* return entries into the stack move with it, those into the code */
+  /* stay, as the code is shared */
+  n = r->stackend - r->retptr;
+  to->retptr = end - n;
+  for (i = 0; i < n; i++) {
+    v = (uintptr_t) r->retptr[i];
+    if (v >= lo && v <= hi)
+      v += delta;
+    to->retptr[i] = (long) v;
+  }
+}
+
+
+/* crow_fork - a branch of the match of a battlefield from where it */
+/*             stands, drawing its random numbers from seed; into 'to', */
+/*             an earlier fork of c or of one of its forks, or a new */
+/*             battlefield if NULL.  The code of the robots is shared, */
+/*             only their state is copied.  NULL if 'to' runs other code */
+crow_t *crow_fork(const crow_t *c, crow_t *to, uint64_t seed)
+{
+  const s_robot *r;
+  crow_t *t = to;
+  int i;
+
+  if (t) {
+    if (t == c || t->num_robots != c->num_robots)
+      return (NULL);
+    for (i = 0; i < c->num_robots; i++) {
+      r = &c->arena.robots[i];
+      if (t->arena.robots[i].prog != r->prog ||
+	  t->arena.robots[i].stackend - t->arena.robots[i].stackbase !=
+	  r->stackend - r->stackbase)
+	return (NULL);
+    }
+  } else {
+    t = calloc(1, sizeof(crow_t));
+    if (!t)
+      return (NULL);
+    for (i = 0; i < c->num_robots; i++)
+      prog_share(&t->arena.robots[i], &c->arena.robots[i]);
+  }
+
+  /* all but the robots, which come first in the arena, and the arena, */
+  /* which comes first in a battlefield */
+  memcpy(&t->arena.missiles, &c->arena.missiles,
+	 sizeof(s_arena) - offsetof(s_arena, missiles));
+  if (c->arena.cur_robot)
+    t->arena.cur_robot = t->arena.robots + (c->arena.cur_robot - c->arena.robots);
+  memcpy(&t->num_robots, &c->num_robots,
+	 sizeof(crow_t) - offsetof(crow_t, num_robots));
+
+  for (i = 0; i < c->num_robots; i++)
+    copy_robot(&t->arena.robots[i], &c->arena.robots[i]);
+  reseed(&t->arena, seed, t->match);
+
+  return (t);
+}
+
+
+/* crow_batch_open - k battlefields of the same robots, compiled once; */
+/*                   their steps are spread over up to 'threads' threads */
+crow_batch_t *crow_batch_open(char *const files[], int n, int k, int threads,
+			      const crow_options_t *opt)
+{
+  crow_batch_t *b;
+  crow_t *c;
+  int i, j;
+
+  if (k < 1 || threads < 1)
+    return (NULL);
+  c = crow_open(files, n, opt);
+  if (!c)
+    return (NULL);
+
+  b = calloc(1, sizeof(crow_batch_t));
+  if (b) {
+    b->env = calloc(k, sizeof(crow_t));
+    b->ended = calloc(k, sizeof(int));
+    b->pool = pool_new(threads < k ? threads : k);
+  }
+  if (!b || !b->env || !b->ended || !b->pool) {
+    if (b) {
+      if (b->pool)
+	pool_free(b->pool);
+      free(b->env);
+      free(b->ended);
+      free(b);
+    }
+    crow_close(c);
+    return (NULL);
+  }
+  b->k = k;
+
+  /* the programs are shared, each battlefield has stacks of its own */
+  for (i = 0; i < k; i++) {
+    b->env[i] = *c;
+    for (j = 0; j < c->num_robots; j++)
+      prog_share(&b->env[i].arena.robots[j], &c->arena.robots[j]);
+  }
+  crow_close(c);
+
+  crow_batch_reset(b, 0);
+  return (b);
+}
+
+
+/* crow_batch_close - release all battlefields of a batch */
+void crow_batch_close(crow_batch_t *b)
+{
+  int i;
+
+  if (!b)
+    return;
+
+  for (i = 0; i < b->k; i++)
+    detach(&b->env[i]);
+  pool_free(b->pool);
+  free(b->env);
+  free(b->ended);
+  free(b);
+}
+
+
+/* crow_batch_reset - start the first matches of a series by seed, */
+/*                    battlefield i plays match i + 1 */
+void crow_batch_reset(crow_batch_t *b, uint64_t seed)
+{
+  int i;
+
+  b->seed = seed;
+  for (i = 0; i < b->k; i++)
+    restart(&b->env[i], seed, i + 1);
+}
+
+
+/* batch_task - one motion update of battlefield t, starting its next */
+/*              match first if the last one is over */
+static void batch_task(void *ctx, int w, int t)
+{
+  crow_batch_t *b = ctx;
+  crow_t *c = &b->env[t];
+
+  (void)w;
+  if (c->done)
+    restart(c, b->seed, c->match + b->k);
+  crow_step(c, c->movement);
+  b->ended[t] = c->done;
+  crow_observe(c, &b->obs[t]);
+}
+
+
+/* batch_done - count the matches that ended; calls are serialized */
+static void batch_done(void *ctx, int t)
+{
+  crow_batch_t *b = ctx;
+
+  b->ended_total += b->ended[t];
+}
+
+
+/* crow_batch_step - one motion update of every battlefield of a batch, */
+/*                   observed in obs[0 .. k-1]; a match that ended shows */
+/*                   done, and the next step starts the battlefield's next */
+/*                   match, k further on; returns the matches that ended */
+int crow_batch_step(crow_batch_t *b, crow_obs_t *obs)
+{
+  b->obs = obs;
+  b->ended_total = 0;
+  pool_exec(b->pool, b->k, batch_task, batch_done, b);
+
+  return (b->ended_total);
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: nil
+ *  c-file-style: "gnu"
+ * End:
+ */
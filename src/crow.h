@@ -0,0 +1,214 @@
+/* crow.h - the CROBOTS simulator as a library, libcrow
+ *
+ * Copyright (C) 2026 The CROW authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * One crow_t is one battlefield with its robots, compiled once by
+ * crow_open() and played any number of times:
+ *
+ *	crow_t *c = crow_open(files, 2, NULL);
+ *	crow_obs_t obs;
+ *
+ *	crow_reset(c, seed);
+ *	while (crow_step(c, 15))
+ *	  crow_observe(c, &obs);
+ *	crow_close(c);
+ *
+ * Stepping and observing do no I/O and allocate nothing, and battlefields
+ * are independent, so each thread may step battlefields of its own.  The
+ * exception is a battlefield with policy robots (.shm): stepping it waits
+ * on their policy, yielding and sleeping up to 30 seconds, and warns on
+ * stderr of one that does not answer.
+ * crow_open() compiles with the settings of its options only, and writes
+ * nothing unless they give a log.  The same seed plays the same match as
+ * 'crobots -S seed -m 1'.
+ *
+ * crow_save_state() saves a match as it stands, robots, stacks, missiles
+ * and random numbers, to a buffer of plain integers, and returns its
+ * size; called with a buffer too small, say NULL and 0, it only returns
+ * the size.  crow_load_state() continues that match on any battlefield
+ * opened with the same robots and options, the same battlefield or
+ * others, as many times as needed, and plays it out exactly as the
+ * battlefield saved would have.
+ *
+ * crow_fork() branches a match in memory, for many continuations of one
+ * position: the branch shares the compiled robots, copies the stacks in
+ * use, robots and missiles, and draws its random numbers from a seed of
+ * its own.  Forking into an earlier fork reuses its memory:
+ *
+ *	crow_t *b = NULL;
+ *
+ *	for (seed = 1; seed <= 1000; seed++) {
+ *	  b = crow_fork(c, b, seed);
+ *	  while (crow_step(b, 15))
+ *	    ;
+ *	}
+ *	crow_close(b);
+ *
+ * A crow_batch_t is k battlefields of the same robots, advanced together
+ * one motion update (MOTION_CYCLES cycles) per crow_batch_step() on a
+ * pool of threads, and observed into one array of k crow_obs_t.
+ * Battlefield i plays matches i + 1, i + 1 + k ... of 'crobots -S seed',
+ * starting the next one by itself once a match is over.
+ *
+ * A robot file ending in .shm is not compiled but names the channel of
+ * an external policy, another process on the same machine that decides
+ * for the robot.  crobots creates the file if missing and both sides map
+ * it shared, so it is best kept on a memory file system like /dev/shm.
+ * Each robot running the policy, clones and battlefields of -j or of a
+ * batch included, has a lane of the channel, taken in the order they
+ * are set up.  Every decision interval (-p, 'decide') the robot posts a
+ * crow_decision_t up its lane, waits for the crow_action_t answering it
+ * and carries that out at once; in between it costs the simulator no
+ * more than any robot.  Both directions are rings of CROW_SLOTS, with a
+ * single writer each: the writer fills slot head % CROW_SLOTS, then
+ * stores head + 1; the reader loads head, copies the slot out, then
+ * stores tail + 1.  Stores are release and loads acquire, as C11 atomics
+ * or the __atomic builtins do them.
+ */
+#ifndef CROBOTS_CROW_H_
+#define CROBOTS_CROW_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define CROW_MAXROBOTS 4	/* robots on a battlefield */
+#define CROW_MISSILES  2	/* missiles in flight per robot */
+
+/* missile states */
+#define CROW_AVAIL     0
+#define CROW_FLYING    1
+#define CROW_EXPLODING 2
+
+typedef struct crow crow_t;
+typedef struct crow_batch crow_batch_t;
+
+/* settings of a battlefield, zero for the defaults of crobots */
+typedef struct crow_options {
+  int battlefield;		/* meters, a power of 2 (1024), -b */
+  int max_instr;		/* code space of a robot (1000), -k */
+  int stack_size;		/* data stack of a robot (500), -K */
+  int optimize;			/* level of the compiler (0), -O */
+  int burst;			/* cycles per robot turn (1), -B */
+  int jit;			/* run robots as native code, in bursts over 1, -J */
+  long limit;			/* cycles per match (500000), -l */
+  int decide;			/* cycles between decisions of policies (15), -p */
+  FILE *log;			/* compiler listing and errors, or NULL */
+} crow_options_t;
+
+typedef struct crow_robot {
+  int status;			/* 1 active, 0 dead */
+  int x, y;			/* position, in 1/10 meter */
+  int heading, d_heading;	/* degrees, current and desired */
+  int speed, d_speed;		/* percent, current and desired */
+  int damage;			/* percent */
+  int scan;			/* last scan direction */
+  int reload;			/* motion updates until the cannon reloads */
+} crow_robot_t;
+
+typedef struct crow_missile {
+  int stat;			/* CROW_AVAIL, CROW_FLYING or CROW_EXPLODING */
+  int x, y;			/* position, in 1/10 meter */
+  int heading;			/* degrees */
+  int range;			/* distance to fly, in 1/10 meter */
+  int dist;			/* distance flown, in 1/10 meter */
+} crow_missile_t;
+
+typedef struct crow_obs {
+  long cycle;			/* cycles played, as reported by crobots */
+  int robots;			/* robots on the battlefield */
+  int alive;			/* robots still active */
+  int done;			/* the match is over */
+  int match;			/* number of the match, as 'crobots -M' */
+  crow_robot_t robot[CROW_MAXROBOTS];
+  crow_missile_t missile[CROW_MAXROBOTS][CROW_MISSILES];
+} crow_obs_t;
+
+/* the channel of an external policy, the layout of a .shm file */
+#define CROW_MAGIC     0x776f7263	/* "crow" */
+#define CROW_VERSION   1
+#define CROW_LANES     256		/* robots a channel can drive */
+#define CROW_SLOTS     8		/* entries of a ring, a power of 2 */
+
+/* parts of an action, or'ed */
+#define CROW_DRIVE     1
+#define CROW_SCAN      2
+#define CROW_CANNON    4
+
+typedef struct crow_decision {
+  uint32_t seq;			/* number of the decision on the lane, from 1 */
+  int self;			/* index of the deciding robot in obs.robot[] */
+  int step;			/* decision of the match, 0 for the first */
+  int scan;			/* result of the last scan, distance or 0 */
+  int fired;			/* the last shot left the cannon */
+  crow_obs_t obs;		/* the battlefield, obs.cycle into the match */
+} crow_decision_t;
+
+typedef struct crow_action {
+  uint32_t seq;			/* of the decision answered, else ignored */
+  int act;			/* CROW_DRIVE, CROW_SCAN, CROW_CANNON */
+  int drive_dir, speed;		/* drive(drive_dir, speed) */
+  int scan_dir, res;		/* scan(scan_dir, res), done first */
+  int cannon_dir, range;	/* cannon(cannon_dir, range), done second */
+} crow_action_t;
+
+typedef struct crow_ring {	/* indices, each on a cache line of its own */
+  volatile uint32_t head;	/* entries written */
+  char pad1[60];
+  volatile uint32_t tail;	/* entries read */
+  char pad2[60];
+} crow_ring_t;
+
+typedef struct crow_lane {
+  crow_ring_t up;		/* decisions, written by crobots */
+  crow_ring_t down;		/* actions, written by the policy */
+  crow_decision_t decision[CROW_SLOTS];
+  crow_action_t action[CROW_SLOTS];
+} crow_lane_t;
+
+typedef struct crow_channel {
+  volatile uint32_t magic;	/* CROW_MAGIC once set up, stored last */
+  uint32_t version;		/* CROW_VERSION */
+  uint32_t lanes;		/* CROW_LANES */
+  uint32_t slots;		/* CROW_SLOTS */
+  char pad[48];
+  crow_lane_t lane[CROW_LANES];
+} crow_channel_t;
+
+crow_t     *crow_open   (char *const files[], int n, const crow_options_t *opt);
+void        crow_close  (crow_t *c);
+
+void        crow_reset  (crow_t *c, uint64_t seed);
+int         crow_step   (crow_t *c, long cycles);
+void        crow_observe(const crow_t *c, crow_obs_t *obs);
+
+crow_t     *crow_fork   (const crow_t *c, crow_t *to, uint64_t seed);
+
+size_t      crow_save_state(const crow_t *c, void *buf, size_t size);
+int         crow_load_state(crow_t *c, const void *buf, size_t size);
+
+int         crow_robots (const crow_t *c);
+const char *crow_name   (const crow_t *c, int i);
+
+crow_batch_t *crow_batch_open (char *const files[], int n, int k, int threads,
+			       const crow_options_t *opt);
+void          crow_batch_close(crow_batch_t *b);
+
+void          crow_batch_reset(crow_batch_t *b, uint64_t seed);
+int           crow_batch_step (crow_batch_t *b, crow_obs_t *obs);
+
+#endif /* CROBOTS_CROW_H_ */
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: nil
+ *  c-file-style: "gnu"
+ * End:
+ */
@@ -19,30 +19,31 @@
 #include "crobots.h"
 #include "screen.h"
 #include "display.h"
+#include "motion.h"
 
 /* update_disp - update all robots and missiles */
 
-void update_disp(void)
+void update_disp(s_arena *a)
 {
   register int i, j;
 
   /* plot each live robot and update status */
   for (i = 0; i < MAXROBOTS; i++) {
-    if (robots[i].status != DEAD) {
-      plot_robot(i);
-      robot_stat(i);
+    if (a->robots[i].status != DEAD) {
+      plot_robot(a, i);
+      robot_stat(a, i);
     }
     /* plot each missile */
     for (j = 0; j < MIS_ROBOT; j++) {
-      switch (missiles[i][j].stat) {
+      switch (a->missiles[i][j].stat) {
 	case AVAIL:
 	  break;
 	case FLYING:
-	  plot_miss(i,j);
+	  plot_miss(a, i,j);
 	  break;
 	case EXPLODING:
-	  plot_exp(i,j);
-	  count_miss(i,j);
+	  plot_exp(a, i,j);
+	  count_miss(a, i,j);
 	  break;
 	default:
 	  break;
@@ -51,17 +52,6 @@ void update_disp(void)
   }
 }
 
-
-/* count_miss - update the explosion counter */
-
-void count_miss(int i, int j) 
-{
-  if (missiles[i][j].count <= 0)
-    missiles[i][j].stat = AVAIL;
-  else
-    missiles[i][j].count--;
-}
-
 /**
  * Local Variables:
  *  indent-tabs-mode: nil
@@ -19,8 +19,9 @@
 #ifndef CROBOTS_DISPLAY_H_
 #define CROBOTS_DISPLAY_H_
 
-void update_disp(void);
-void count_miss(int i, int j);
+#include "crobots.h"
+
+void update_disp(s_arena *a);
 
 #endif /* CROBOTS_DISPLAY_H_ */
 
@@ -16,10 +16,19 @@
 #include "compiler.h"
 #include "grammar.h"
 
+%}
 
-extern int yylex (void);
+%define api.pure full
+%parse-param {void *scanner} {s_comp *cc}
+%lex-param {void *scanner}
 
-%}
+%code requires {
+#include "compiler.h"
+}
+
+%code {
+int yylex(YYSTYPE *lvalp, void *scanner);
+}
 
 %token IDENTIFIER 
 %token CONSTANT 
@@ -79,23 +88,23 @@ extern int yylex (void);
 primary_expr
 	: identifier
 		{ /* printf("IDENTIFIER\n"); */
-		if ((work = findvar(last_ident,var_tab)) == -1) {
-		  if ((work = findvar(last_ident,ext_tab)) == -1) {
-		    if (findvar(last_ident,func_tab) == -1) {
+		if ((cc->work = findvar(cc->last_ident,cc->var_tab)) == -1) {
+		  if ((cc->work = findvar(cc->last_ident,cc->ext_tab)) == -1) {
+		    if (findvar(cc->last_ident,cc->func_tab) == -1) {
 		      /* printf("\n***undeclared %s***\n",last_ident); */
-		      undeclared++;
+		      cc->undeclared++;
 		    }
-		    work = allocvar(last_ident,var_tab);
+		    cc->work = allocvar(cc, cc->last_ident,cc->var_tab);
 		  }
 		  else
-		    work |= EXTERNAL;
+		    cc->work |= EXTERNAL;
 		}
-		if (!efetch(work))
+		if (!efetch(cc, cc->work))
 		  return(1);
 		}
 	| CONSTANT
 		{ /*printf("CONSTANT\n"); */
-		 if (!econst(kk))
+		 if (!econst(cc, cc->kk))
 		   return(1);
 		}
 	| '(' expr ')'
@@ -105,55 +114,55 @@ postfix_expr
 	: primary_expr
 	| fcall_start argument_expr_list ')'
 		{ /* printf("FCALL\n"); */
-		popid(func_ident,func_stack,&func_off); /* note ptr to off */
-		if ((work = findvar(func_ident,func_tab)) == -1) {
+		popid(cc, &cc->func_ident,&cc->func_stack);
+		if ((cc->work = findvar(cc->func_ident,cc->func_tab)) == -1) {
 		  /* printf("\n***declared %s***\n",func_ident); */
-		  undeclared--; /*function name mistakenly undeclared*/
-		  work = allocvar(func_ident,func_tab);
+		  cc->undeclared--; /*function name mistakenly undeclared*/
+		  cc->work = allocvar(cc, cc->func_ident,cc->func_tab);
 		}
-		if(!efcall(work))
+		if(!efcall(cc, cc->work))
 		  return(1);
 		}
 	| fcall_start ')'
 		{ /* printf("FCALL\n"); */
-		popid(func_ident,func_stack,&func_off); /* note ptr to off */
-		if ((work = findvar(func_ident,func_tab)) == -1) {
+		popid(cc, &cc->func_ident,&cc->func_stack);
+		if ((cc->work = findvar(cc->func_ident,cc->func_tab)) == -1) {
 		  /* printf("\n***declared %s***\n",func_ident); */
-		  undeclared--; /*function name mistakenly undeclared*/
-		  work = allocvar(func_ident,func_tab);
+		  cc->undeclared--; /*function name mistakenly undeclared*/
+		  cc->work = allocvar(cc, cc->func_ident,cc->func_tab);
 		}
-		if (!efcall(work))
+		if (!efcall(cc, cc->work))
 		  return(1);
 		}
 	| postfix_expr INC_OP
 		{ /* printf("POSTFIX-INC\n"); */
 		/* this is wrong!  same as infix increment */
-		postfix++;
-		if (!econst(1L))
+		cc->postfix++;
+		if (!econst(cc, 1L))
 		  return(1);
-		if ((work = findvar(last_ident,var_tab)) == -1) {
-		  if ((work = findvar(last_ident,ext_tab)) == -1) {
-		    work = allocvar(last_ident,var_tab);
+		if ((cc->work = findvar(cc->last_ident,cc->var_tab)) == -1) {
+		  if ((cc->work = findvar(cc->last_ident,cc->ext_tab)) == -1) {
+		    cc->work = allocvar(cc, cc->last_ident,cc->var_tab);
 		  }
 		  else
-		    work |= EXTERNAL;
+		    cc->work |= EXTERNAL;
 		}
-		if(!estore(work,ADD_ASSIGN))
+		if(!estore(cc, cc->work,ADD_ASSIGN))
 		  return(1);
 		}
 	| postfix_expr DEC_OP
 		{ /* printf("POSTFIX-DEC\n"); */
 		/* this is wrong!  same as infix decrement */
-		postfix++;
-		if (!econst(1L))
+		cc->postfix++;
+		if (!econst(cc, 1L))
 		  return(1);
-		if ((work = findvar(last_ident,var_tab)) == -1) {
-		  if ((work = findvar(last_ident,ext_tab)) == -1)
-		    work = allocvar(last_ident,var_tab);
+		if ((cc->work = findvar(cc->last_ident,cc->var_tab)) == -1) {
+		  if ((cc->work = findvar(cc->last_ident,cc->ext_tab)) == -1)
+		    cc->work = allocvar(cc, cc->last_ident,cc->var_tab);
 		  else
-		    work |= EXTERNAL;
+		    cc->work |= EXTERNAL;
 		}
-		if (!estore(work,SUB_ASSIGN))
+		if (!estore(cc, cc->work,SUB_ASSIGN))
 		  return(1);
 		}
 	;
@@ -161,8 +170,8 @@ postfix_expr
 fcall_start
 	: postfix_expr '('
 		{ /* printf("FCALL-START\n"); */
-		stackid(last_ident,func_stack,&func_off); /* note ptr to off */
-		if (!eframe())
+		stackid(cc, cc->last_ident,&cc->func_stack);
+		if (!eframe(cc))
 		  return(1);
 		}
 	;
@@ -176,49 +185,49 @@ unary_expr
 	: postfix_expr
 	| INC_OP unary_expr
 		{ /* printf("INFIX-INC\n"); */
-		if (!econst(1L))
+		if (!econst(cc, 1L))
 		  return(1);
-		if ((work = findvar(last_ident,var_tab)) == -1) {
-		  if ((work = findvar(last_ident,ext_tab)) == -1)
-		    work = allocvar(last_ident,var_tab);
+		if ((cc->work = findvar(cc->last_ident,cc->var_tab)) == -1) {
+		  if ((cc->work = findvar(cc->last_ident,cc->ext_tab)) == -1)
+		    cc->work = allocvar(cc, cc->last_ident,cc->var_tab);
 		  else
-		    work |= EXTERNAL;
+		    cc->work |= EXTERNAL;
 		}
-		if (!estore(work,ADD_ASSIGN))
+		if (!estore(cc, cc->work,ADD_ASSIGN))
 		  return(1);
 		}
 	| DEC_OP unary_expr
 		{ /* printf("INFIX-DEC\n"); */
-		if (!econst(1L))
+		if (!econst(cc, 1L))
 		  return(1);
-		if ((work = findvar(last_ident,var_tab)) == -1) {
-		  if ((work = findvar(last_ident,ext_tab)) == -1)
-		    work = allocvar(last_ident,var_tab);
+		if ((cc->work = findvar(cc->last_ident,cc->var_tab)) == -1) {
+		  if ((cc->work = findvar(cc->last_ident,cc->ext_tab)) == -1)
+		    cc->work = allocvar(cc, cc->last_ident,cc->var_tab);
 		  else
-		    work |= EXTERNAL;
+		    cc->work |= EXTERNAL;
 		}
-		if (!estore(work,SUB_ASSIGN))
+		if (!estore(cc, cc->work,SUB_ASSIGN))
 		  return(1);
 		}
 	| unary_operator cast_expr
 		{ /* printf("UNARY-OP\n"); */
 		/* note special tokens defined only to pass to interpreter */
-		un_op = *(op_stack + op_off);
-		op_off--;
-		if (un_op == '-') {
-		  if (!econst(0L))
+		cc->un_op = *(cc->op_stack + cc->op_off);
+		cc->op_off--;
+		if (cc->un_op == '-') {
+		  if (!econst(cc, 0L))
 		    return(1);
-		  if (!ebinop(U_NEGATIVE))
+		  if (!ebinop(cc, U_NEGATIVE))
 		    return(1);
-		} else if (un_op == '!') {
-		  if (!econst(0L))
+		} else if (cc->un_op == '!') {
+		  if (!econst(cc, 0L))
 		    return(1);
-		  if (!ebinop(U_NOT))
+		  if (!ebinop(cc, U_NOT))
 		    return(1);
-		} else if (un_op == '~') {
-		  if (!econst(0L))
+		} else if (cc->un_op == '~') {
+		  if (!econst(cc, 0L))
 		    return(1);
-		  if (!ebinop(U_ONES))
+		  if (!ebinop(cc, U_ONES))
 		    return(1);
 		}
 		}
@@ -227,18 +236,15 @@ unary_expr
 unary_operator
 	: '-'
 		{ /* printf("UNARY-OP\n"); */
-		op_off++;
-		*(op_stack + op_off) = '-';
+		pushop(cc, '-');
 		}
 	| '!'
 		{ 
-		op_off++;
-		*(op_stack + op_off) = '!';
+		pushop(cc, '!');
 		}
 	| '~'
 		{ 
-		op_off++;
-		*(op_stack + op_off) = '~';
+		pushop(cc, '~');
 		}
 	;
 
@@ -251,17 +257,17 @@ multiplicative_expr
 	: cast_expr
 	| multiplicative_expr '*' cast_expr
 		{ /* printf("MULTIPLY\n"); */
-		if (!ebinop('*'))
+		if (!ebinop(cc, '*'))
 		  return(1);
 		}
 	| multiplicative_expr '/' cast_expr
 		{ /*printf("DIVIDE\n"); */
-		if (!ebinop('/'))
+		if (!ebinop(cc, '/'))
 		  return(1);
 		}
 	| multiplicative_expr '%' cast_expr
 		{ /* printf("MOD\n"); */
-		if (!ebinop('%'))
+		if (!ebinop(cc, '%'))
 		  return(1);
 		}
 	;
@@ -270,12 +276,12 @@ additive_expr
 	: multiplicative_expr
 	| additive_expr '+' multiplicative_expr
 		{ /* printf("ADD\n"); */
-		if (!ebinop('+'))
+		if (!ebinop(cc, '+'))
 		  return(1);
 		}
 	| additive_expr '-' multiplicative_expr
 		{ /* printf("SUBTRACT\n"); */
-		if (!ebinop('-'))
+		if (!ebinop(cc, '-'))
 		  return(1);
 		}
 	;
@@ -284,12 +290,12 @@ shift_expr
 	: additive_expr
 	| shift_expr LEFT_OP additive_expr
 		{ /* printf("SHIFT-LEFT\n"); */
-		if (!ebinop(LEFT_OP))
+		if (!ebinop(cc, LEFT_OP))
 		  return(1);
 		}
 	| shift_expr RIGHT_OP additive_expr
 		{ /* printf("SHIFT-RIGHT\n"); */
-		if (!ebinop(RIGHT_OP))
+		if (!ebinop(cc, RIGHT_OP))
 		  return(1);
 		}
 	;
@@ -298,22 +304,22 @@ relational_expr
 	: shift_expr
 	| relational_expr '<' shift_expr
 		{ /* printf("LESS-THAN\n"); */
-		if (!ebinop('<'))
+		if (!ebinop(cc, '<'))
 		  return(1);
 		}
 	| relational_expr '>' shift_expr
 		{ /* printf("GREATER-THAN\n"); */
-		if (!ebinop('>'))
+		if (!ebinop(cc, '>'))
 		  return(1);
 		}
 	| relational_expr LE_OP shift_expr
 		{ /*printf("LESS-EQUAL\n"); */
-		if (!ebinop(LE_OP))
+		if (!ebinop(cc, LE_OP))
 		  return(1);
 		}
 	| relational_expr GE_OP shift_expr
 		{ /* printf("GREATER-EQUAL\n"); */
-		if (!ebinop(GE_OP))
+		if (!ebinop(cc, GE_OP))
 		  return(1);
 		}
 	;
@@ -322,12 +328,12 @@ equality_expr
 	: relational_expr
 	| equality_expr EQ_OP relational_expr
 		{ /* printf("EQUAL\n"); */
-		if (!ebinop(EQ_OP))
+		if (!ebinop(cc, EQ_OP))
 		  return(1);
 		}
 	| equality_expr NE_OP relational_expr
 		{ /* printf("NOT-EQUAL\n"); */
-		if (!ebinop(NE_OP))
+		if (!ebinop(cc, NE_OP))
 		  return(1);
 		}
 	;
@@ -336,7 +342,7 @@ and_expr
 	: equality_expr
 	| and_expr '&' equality_expr
 		{ /* printf("AND\n"); */
-		if (!ebinop('&'))
+		if (!ebinop(cc, '&'))
 		  return(1);
 		}
 	;
@@ -345,7 +351,7 @@ exclusive_or_expr
 	: and_expr
 	| exclusive_or_expr '^' and_expr
 		{ /* printf("EXCLUSIVE-OR\n"); */
-		if (!ebinop('^'))
+		if (!ebinop(cc, '^'))
 		  return(1);
 		}
 	;
@@ -354,7 +360,7 @@ inclusive_or_expr
 	: exclusive_or_expr
 	| inclusive_or_expr '|' exclusive_or_expr
 		{ /* printf("INCLUSIVE-OR\n"); */
-		if (!ebinop('|'))
+		if (!ebinop(cc, '|'))
 		  return(1);
 		}
 	;
@@ -363,7 +369,7 @@ logical_and_expr
 	: inclusive_or_expr
 	| logical_and_expr AND_OP inclusive_or_expr
 		{ /* printf("LOGICAL-AND\n"); */
-		if (!ebinop(AND_OP))
+		if (!ebinop(cc, AND_OP))
 		  return(1);
 		}
 	;
@@ -372,7 +378,7 @@ logical_or_expr
 	: logical_and_expr
 	| logical_or_expr OR_OP logical_and_expr
 		{ /* printf("LOGICAL-OR\n"); */
-		if (!ebinop(OR_OP))
+		if (!ebinop(cc, OR_OP))
 		  return(1);
 		}
 	;
@@ -386,51 +392,50 @@ assignment_expr
 	| assignment_lval assignment_expr
 		{ /* printf("ASSIGNMENT\n"); */
 		/* func_ident used as temp storage */
-		popid(func_ident,var_stack,&var_off); /* note ptr to off */
-		if ((work = findvar(func_ident,var_tab)) == -1) {
-		  if ((work = findvar(func_ident,ext_tab)) == -1)
-		    work = allocvar(func_ident,var_tab);
+		popid(cc, &cc->func_ident,&cc->var_stack);
+		if ((cc->work = findvar(cc->func_ident,cc->var_tab)) == -1) {
+		  if ((cc->work = findvar(cc->func_ident,cc->ext_tab)) == -1)
+		    cc->work = allocvar(cc, cc->func_ident,cc->var_tab);
 		  else
-		    work |= EXTERNAL;
+		    cc->work |= EXTERNAL;
 		}
-		if (!estore((short int)work,*(op_stack + op_off)))
+		if (!estore(cc, (short int)cc->work,*(cc->op_stack + cc->op_off)))
 		  return(1);
-		op_off--;
+		cc->op_off--;
 		}
 	;
 
 assignment_lval
 	: unary_expr assignment_operator
 		{ /* printf("ASSIGNMENT-LVAL\n"); */
-		stackid(last_ident,var_stack,&var_off); /* note ptr to off */
-		op_off++;
-		*(op_stack + op_off) = work;
+		stackid(cc, cc->last_ident,&cc->var_stack);
+		pushop(cc, cc->work);
 		}
 	;
 
 assignment_operator
 	: '='
-		{ work =  '=';}
+		{ cc->work =  '=';}
 	| MUL_ASSIGN
-		{ work = MUL_ASSIGN;}
+		{ cc->work = MUL_ASSIGN;}
 	| DIV_ASSIGN
-		{ work = DIV_ASSIGN;}
+		{ cc->work = DIV_ASSIGN;}
 	| MOD_ASSIGN
-		{ work = MOD_ASSIGN;}
+		{ cc->work = MOD_ASSIGN;}
 	| ADD_ASSIGN
-		{ work = ADD_ASSIGN;}
+		{ cc->work = ADD_ASSIGN;}
 	| SUB_ASSIGN
-		{ work = SUB_ASSIGN;}
+		{ cc->work = SUB_ASSIGN;}
 	| LEFT_ASSIGN
-		{ work = LEFT_ASSIGN;}
+		{ cc->work = LEFT_ASSIGN;}
 	| RIGHT_ASSIGN
-		{ work = RIGHT_ASSIGN;}
+		{ cc->work = RIGHT_ASSIGN;}
 	| AND_ASSIGN
-		{ work = AND_ASSIGN;}
+		{ cc->work = AND_ASSIGN;}
 	| XOR_ASSIGN
-		{ work = XOR_ASSIGN;}
+		{ cc->work = XOR_ASSIGN;}
 	| OR_ASSIGN
-		{ work = OR_ASSIGN;}
+		{ cc->work = OR_ASSIGN;}
 	;
 
 expr
@@ -458,9 +463,10 @@ init_declarator
 	: declarator
 	| declarator '=' initializer
 		{ /* printf("INITIALIZER\n"); */
-		fprintf(f_out,"\n**Warning** unsupported initializer\n");
+		if (cc->out)
+		  fprintf(cc->out,"\n**Warning** unsupported initializer\n");
 		/* get rid of constant placed on stack */
-		if (!echop())
+		if (!echop(cc))
 		  return(1);
 		}
 	;
@@ -483,23 +489,23 @@ declarator
 declarator2
 	: identifier
 		{ /* printf("VARIABLE-DECLARE\n"); */
-		if (in_func) {
-		  if (findvar(last_ident,var_tab) == -1)
-		    allocvar(last_ident,var_tab);
+		if (cc->in_func) {
+		  if (findvar(cc->last_ident,cc->var_tab) == -1)
+		    allocvar(cc, cc->last_ident,cc->var_tab);
 		}
 		else {
-		  if (findvar(last_ident,ext_tab) == -1)
-		    allocvar(last_ident,ext_tab);
+		  if (findvar(cc->last_ident,cc->ext_tab) == -1)
+		    allocvar(cc, cc->last_ident,cc->ext_tab);
 		}
 		}
 	| func_start ')'
 		{ /* printf("FUNCTION-DECLARE\n"); */
-		if (new_func() == -1)
+		if (new_func(cc) == -1)
 		  return (1); /* exit the parser */
 		}
 	| func_start parameter_declaration_list ')'
 		{ /* printf("FUNCTION-DECLARE\n"); */
-		if (new_func() == -1)
+		if (new_func(cc) == -1)
 		  return (1); /* exit the parser */
 		}
 	;
@@ -507,7 +513,7 @@ declarator2
 func_start
 	: declarator2 '('
 		{ /* printf("FUNCTION-DEF-START\n"); */
-		strcpy(func_ident,last_ident);
+		setid(&cc->func_ident,cc->last_ident);
 		}
 	;
 
@@ -519,8 +525,8 @@ type_specifier_list
 parameter_identifier
 	: identifier
 		{ /* printf("PARAMETER-DECLARE\n"); */
-		allocvar(last_ident,var_tab);
-		num_parm++;
+		allocvar(cc, cc->last_ident,cc->var_tab);
+		cc->num_parm++;
 		}
 	;
 
@@ -600,7 +606,7 @@ expression_statement
 	: ';'
 	| expr ';'
 		{ /* printf("CHOP\n"); */
-		if (!echop())
+		if (!echop(cc))
 		  return(1);
 		}
 	;
@@ -613,22 +619,22 @@ selection_statement
 selection1_statement
 	: if_clause statement
 		{ /* printf("IF-THEN\n"); */
-		else_part();
-		close_if();
+		else_part(cc);
+		close_if(cc);
 		}
 	;
 
 selection2_statement
 	: if_clause statement else_clause statement
 		{ /* printf("IF-THEN-ELSE\n"); */
-		close_if();
+		close_if(cc);
 		}
 	;
 
 if_clause
 	: IF '(' expr ')'
 		{ /* printf("IF-CLAUSE\n"); */
-		if (!new_if())
+		if (!new_if(cc))
 		  return (1); /* exit parser */
 		}
 	;
@@ -636,21 +642,21 @@ if_clause
 else_clause
 	: ELSE
 		{ /* printf("ELSE-CLAUSE\n"); */
-		else_part();
+		else_part(cc);
 		}
 	;
 
 iteration_statement
 	: while_clause statement
 		{ /* printf("WHILE\n"); */
-		close_while();
+		close_while(cc);
 		}
 	;
 
 while_token
 	: WHILE
 		{ /* printf("WHILE-TOKEN\n"); */
-		if (!new_while())
+		if (!new_while(cc))
 		  return (1);  /* exit the parser */
 		}
 	;
@@ -658,7 +664,7 @@ while_token
 while_clause
 	: while_token '(' expr ')'
 		{ /* printf("WHILE-CLAUSE\n"); */
-		while_expr();
+		while_expr(cc);
 		}
 	;
 
@@ -668,19 +674,20 @@ jump_statement
 		/* breaks can be handled by building a instruct chain */
 		/* as part of the while_nest structures and patching them */
 		/* on while_close.  maybe later */
-		fprintf(f_out,"\n**Warning** unsupported break\n");
+		if (cc->out)
+		  fprintf(cc->out,"\n**Warning** unsupported break\n");
 		}
 	| RETURN ';'
 		{ /* printf("RETURN-NOEXPR\n"); */
 		/* all functions must return a value */
-		if (!econst(1L))
+		if (!econst(cc, 1L))
 		  return(1);
-		if (!eretsub())
+		if (!eretsub(cc))
 		  return(1);
 		}
 	| RETURN expr ';'
 		{ /* printf("RETURN\n"); */
-		if (!eretsub())
+		if (!eretsub(cc))
 		  return(1);
 		}
 	;
@@ -694,11 +701,11 @@ external_definition
 	: function_definition
 		{ /* printf("FUNCTION-DEFINITION\n"); */
 		/* all functions must return a value */
-		if (!econst(1L))
+		if (!econst(cc, 1L))
 		  return(1);
-		if (!eretsub())
+		if (!eretsub(cc))
 		  return(1);
-		end_func();
+		end_func(cc);
 		}
 	| declaration
 		{ /* printf("EXTERNAL-DECLARE\n"); */
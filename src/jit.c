@@ -0,0 +1,894 @@
+/* jit.c - native code generation for robot instructions
+ *
+ * Copyright (C) 2026 The CROW authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * The code of a program is translated into one x86-64 routine, each
+ * function straight-line code with a label per instruction: instructions
+ * fall through to the next, branches and calls jump to their targets, and
+ * returns jump through the table of labels.  jit_burst() enters it at the
+ * robot's ip with the cycles of the burst, which stay in a register:
+ *
+ *	rbx  robot		r12  stack pointer	r14  cycles left
+ *	rbp  externals		r13  local pool		r15  arena
+ *
+ * Every instruction takes its cycle on entry, and one owed by a
+ * superinstruction after it, so the routine yields after exactly as many
+ * cycles as the interpreter would run, with the same ip and stall.
+ *
+ * Only the common case is generated.  Whenever an instruction could fail
+ * (stack collision or underflow, end of main), the routine returns before
+ * doing any of it and the interpreter runs that instruction with its full
+ * semantics.  Intrinsics are called through jit_icall(), which finishes
+ * the call the way the interpreter does.
+ */
+
+#include "config.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "crobots.h"
+#include "compiler.h"
+#include "cpu.h"
+#include "jit.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define JIT_X86_64 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef JIT_X86_64
+
+#define FRAG_MAX 256		/* upper bound of code bytes per instruction */
+#define STUB_MAX 32		/* and of its ways out */
+
+/* registers */
+#define RAX 0
+#define RCX 1
+#define RDX 2
+#define RBX 3
+#define RSP 4
+#define RBP 5
+#define RSI 6
+#define RDI 7
+#define R12 12
+#define R13 13
+#define R14 14
+#define R15 15
+
+/* what the native code keeps in registers, see above */
+#define ROBOT RBX
+#define EXT   RBP
+#define SP    R12
+#define LP    R13
+#define LEFT  R14
+#define ARENA R15
+
+/* condition codes */
+#define CC_B  0x2
+#define CC_A  0x7
+#define CC_AE 0x3
+#define CC_E  0x4
+#define CC_NE 0x5
+#define CC_BE 0x6
+#define CC_S  0x8
+#define CC_L  0xc
+#define CC_GE 0xd
+#define CC_LE 0xe
+#define CC_G  0xf
+
+/* robot fields used by native code */
+#define R_IP    offsetof(s_robot, ip)
+#define R_SP    offsetof(s_robot, stackptr)
+#define R_RET   offsetof(s_robot, retptr)
+#define R_BASE  offsetof(s_robot, stackbase)
+#define R_END   offsetof(s_robot, stackend)
+#define R_LOCAL offsetof(s_robot, local)
+#define R_EXT   offsetof(s_robot, external)
+#define R_STALL offsetof(s_robot, stall)
+
+#define INSTR_SIZE ((int) sizeof(s_instr))
+
+/* targets of jumps, patched once all code is laid out */
+#define TO_LABEL 0		/* instruction i */
+#define TO_YIELD 1		/* out of cycles at instruction i */
+#define TO_SLOW  2		/* instruction i left to the interpreter */
+#define TO_KEEP  3		/* out at the ip the robot was restarted at */
+#define TO_OUT   4		/* out of cycles, ip in rax */
+#define TO_BACK  5		/* to the interpreter, ip in rax */
+
+struct fix {
+  unsigned char *at;		/* rel32 field */
+  int to, i;
+};
+
+struct buf {
+  unsigned char *p;		/* next byte */
+  struct fix *fix;		/* jumps to patch */
+  int nfix, room;
+  char *slow;			/* instructions with a slow path */
+};
+
+static void byte(struct buf *b, int c)
+{
+  *b->p++ = (unsigned char) c;
+}
+
+static void dword(struct buf *b, long v)
+{
+  int i;
+
+  for (i = 0; i < 4; i++)
+    byte(b, (int) (v >> (i * 8)) & 0xff);
+}
+
+static void qword(struct buf *b, unsigned long v)
+{
+  int i;
+
+  for (i = 0; i < 8; i++)
+    byte(b, (int) (v >> (i * 8)) & 0xff);
+}
+
+/* rex prefix of a 64 bit operation on reg and base */
+static void rex(struct buf *b, int reg, int base)
+{
+  byte(b, 0x48 | ((reg >> 1) & 4) | (base >> 3));
+}
+
+/* modrm of [base + disp] */
+static void mem(struct buf *b, int reg, int base, long disp)
+{
+  int mod = disp == 0 && (base & 7) != RBP ? 0x00 :
+	    disp >= -128 && disp < 128 ? 0x40 : 0x80;
+
+  byte(b, mod | ((reg & 7) << 3) | (base & 7));
+  if ((base & 7) == RSP)
+    byte(b, 0x24);			/* sib, no index */
+  if (mod == 0x40)
+    byte(b, (int) disp & 0xff);
+  else if (mod == 0x80)
+    dword(b, disp);
+}
+
+/* opcode reg, [base + disp], 64 bit */
+static void insn(struct buf *b, int opcode, int reg, int base, long disp)
+{
+  rex(b, reg, base);
+  byte(b, opcode);
+  mem(b, reg, base, disp);
+}
+
+/* mov reg, [base + disp] */
+static void load(struct buf *b, int reg, int base, long disp)
+{
+  insn(b, 0x8b, reg, base, disp);
+}
+
+/* mov [base + disp], reg */
+static void store(struct buf *b, int base, long disp, int reg)
+{
+  insn(b, 0x89, reg, base, disp);
+}
+
+/* lea reg, [base + disp] */
+static void lea(struct buf *b, int reg, int base, long disp)
+{
+  insn(b, 0x8d, reg, base, disp);
+}
+
+/* cmp reg, [base + disp] */
+static void cmpmem(struct buf *b, int reg, int base, long disp)
+{
+  insn(b, 0x3b, reg, base, disp);
+}
+
+/* mov qword [base + disp], imm32 */
+static void storei(struct buf *b, int base, long disp, long v)
+{
+  insn(b, 0xc7, 0, base, disp);
+  dword(b, v);
+}
+
+/* two register alu operation, op dst, src */
+static void alu(struct buf *b, int opcode, int dst, int src)
+{
+  rex(b, src, dst);
+  byte(b, opcode);
+  byte(b, 0xc0 | ((src & 7) << 3) | (dst & 7));
+}
+
+/* mov reg, imm */
+static void movi(struct buf *b, int reg, unsigned long v)
+{
+  if ((long) v == (int) v) {
+    rex(b, 0, reg);
+    byte(b, 0xc7); byte(b, 0xc0 | (reg & 7));
+    dword(b, (long) v);
+  } else {
+    rex(b, 0, reg);
+    byte(b, 0xb8 + (reg & 7));
+    qword(b, v);
+  }
+}
+
+/* add reg, imm, or sub with a negative imm */
+static void addi(struct buf *b, int reg, long v)
+{
+  int ext = v < 0 ? 5 : 0;
+
+  if (v < 0)
+    v = -v;
+  rex(b, 0, reg);
+  if (v < 128) {
+    byte(b, 0x83); byte(b, 0xc0 | (ext << 3) | (reg & 7)); byte(b, (int) v);
+  } else {
+    byte(b, 0x81); byte(b, 0xc0 | (ext << 3) | (reg & 7)); dword(b, v);
+  }
+}
+
+/* setcc al; movzx eax, al */
+static void setcc(struct buf *b, int cc)
+{
+  byte(b, 0x0f); byte(b, 0x90 + cc); byte(b, 0xc0);
+  byte(b, 0x0f); byte(b, 0xb6); byte(b, 0xc0);
+}
+
+/* a rel32 field to patch in jit_compile(), once its target is known */
+static void fixup(struct buf *b, int to, int i)
+{
+  if (b->nfix == b->room) {
+    b->room = b->room ? 2 * b->room : 256;
+    b->fix = realloc(b->fix, b->room * sizeof(struct fix));
+  }
+  b->fix[b->nfix].at = b->p;
+  b->fix[b->nfix].to = to;
+  b->fix[b->nfix].i = i;
+  b->nfix++;
+  dword(b, 0);
+}
+
+/* patch - point a rel32 field at its target */
+static void patch(unsigned char *at, unsigned char *to)
+{
+  int rel = (int) (to - (at + 4));
+
+  memcpy(at, &rel, 4);
+}
+
+/* jcc to a target */
+static void jcc(struct buf *b, int cc, int to, int i)
+{
+  byte(b, 0x0f); byte(b, 0x80 + cc);
+  fixup(b, to, i);
+  if (to == TO_SLOW)
+    b->slow[i] = 1;
+}
+
+/* jmp to a target */
+static void jmp(struct buf *b, int to, int i)
+{
+  byte(b, 0xe9);
+  fixup(b, to, i);
+  if (to == TO_SLOW)
+    b->slow[i] = 1;
+}
+
+/* the stack must take n more pushes, or the interpreter runs i */
+static void need_push(struct buf *b, int i, int n)
+{
+  lea(b, RSI, SP, n * 8);
+  cmpmem(b, RSI, ROBOT, R_RET);		/* collision into return pointers */
+  jcc(b, CC_AE, TO_SLOW, i);
+}
+
+/* the stack must hold n entries, or the interpreter runs i */
+static void need_pop(struct buf *b, int i, int n)
+{
+  lea(b, RSI, SP, -n * 8);
+  cmpmem(b, RSI, ROBOT, R_BASE);
+  jcc(b, CC_B, TO_SLOW, i);
+}
+
+/* address of a variable, as base and displacement */
+static int var(short int v, long *disp)
+{
+  if (v & EXTERNAL) {
+    *disp = (long) (v & (short int)~EXTERNAL) * 8;
+    return (EXT);
+  }
+  *disp = (long) v * 8;
+  return (LP);
+}
+
+/* reg = variable */
+static void fetch(struct buf *b, int reg, short int v)
+{
+  long disp;
+  int base = var(v, &disp);
+
+  load(b, reg, base, disp);
+}
+
+/* variable = reg */
+static void assign(struct buf *b, short int v, int reg)
+{
+  long disp;
+  int base = var(v, &disp);
+
+  store(b, base, disp, reg);
+}
+
+/* rax = rax op rcx, as operate() does; clobbers rdx */
+static void op(struct buf *b, int code)
+{
+  switch (code) {
+    case OP_ASSIGN:
+      alu(b, 0x89, RAX, RCX);
+      break;
+    case OP_ADD:
+      alu(b, 0x01, RAX, RCX);
+      break;
+    case OP_SUB:
+      alu(b, 0x29, RAX, RCX);
+      break;
+    case OP_MUL:
+      byte(b, 0x48); byte(b, 0x0f); byte(b, 0xaf); byte(b, 0xc1);
+      break;
+    case OP_DIV:
+      alu(b, 0x85, RCX, RCX);
+      byte(b, 0x74); byte(b, 0x07);			/* jz to zero */
+      byte(b, 0x48); byte(b, 0x99);			/* cqo */
+      byte(b, 0x48); byte(b, 0xf7); byte(b, 0xf9);	/* idiv rcx */
+      byte(b, 0xeb); byte(b, 0x02);			/* jmp over zero */
+      byte(b, 0x31); byte(b, 0xc0);			/* xor eax, eax */
+      break;
+    case OP_MOD:
+      byte(b, 0x48); byte(b, 0x99);
+      byte(b, 0x48); byte(b, 0xf7); byte(b, 0xf9);
+      alu(b, 0x89, RAX, RDX);
+      break;
+    case OP_AND:
+      alu(b, 0x21, RAX, RCX);
+      break;
+    case OP_OR:
+      alu(b, 0x09, RAX, RCX);
+      break;
+    case OP_XOR:
+      alu(b, 0x31, RAX, RCX);
+      break;
+    case OP_SHL:
+      byte(b, 0x48); byte(b, 0xd3); byte(b, 0xe0);
+      break;
+    case OP_SHR:
+      byte(b, 0x48); byte(b, 0xd3); byte(b, 0xf8);
+      break;
+    case OP_LT:
+      alu(b, 0x39, RAX, RCX); setcc(b, CC_L);
+      break;
+    case OP_GT:
+      alu(b, 0x39, RAX, RCX); setcc(b, CC_G);
+      break;
+    case OP_LE:
+      alu(b, 0x39, RAX, RCX); setcc(b, CC_LE);
+      break;
+    case OP_GE:
+      alu(b, 0x39, RAX, RCX); setcc(b, CC_GE);
+      break;
+    case OP_EQ:
+      alu(b, 0x39, RAX, RCX); setcc(b, CC_E);
+      break;
+    case OP_NE:
+      alu(b, 0x39, RAX, RCX); setcc(b, CC_NE);
+      break;
+    case OP_LAND:
+      alu(b, 0x85, RAX, RAX);
+      byte(b, 0x0f); byte(b, 0x95); byte(b, 0xc2);	/* setne dl */
+      alu(b, 0x85, RCX, RCX);
+      setcc(b, CC_NE);
+      byte(b, 0x21); byte(b, 0xd0);			/* and eax, edx */
+      break;
+    case OP_LOR:
+      alu(b, 0x09, RAX, RCX); setcc(b, CC_NE);
+      break;
+    case OP_NEG:
+      byte(b, 0x48); byte(b, 0xf7); byte(b, 0xd8);
+      break;
+    case OP_NOT:
+      alu(b, 0x85, RAX, RAX); setcc(b, CC_E);
+      break;
+    case OP_COMP:
+      byte(b, 0x48); byte(b, 0xf7); byte(b, 0xd0);
+      break;
+    default:
+      break;			/* leaves x */
+  }
+}
+
+/* the cycles a superinstruction owes, taken from those left; if they */
+/* run out, the rest is owed as a stall */
+static void owe(struct buf *b, int n)
+{
+  addi(b, LEFT, -n);
+  byte(b, 0x79); byte(b, 0x0d);				/* jns over */
+  byte(b, 0x49); byte(b, 0xf7); byte(b, 0xde);		/* neg r14 */
+  byte(b, 0x44); byte(b, 0x89); byte(b, 0xb3);		/* mov [rbx + stall], r14d */
+  dword(b, R_STALL);
+  byte(b, 0x45); byte(b, 0x31); byte(b, 0xf6);		/* xor r14d, r14d */
+}
+
+/* zero n slots from [base + disp] */
+static void zero(struct buf *b, int base, long disp, int n)
+{
+  int k;
+
+  if (n <= 6) {
+    for (k = 0; k < n; k++)
+      storei(b, base, disp + k * 8, 0);
+    return;
+  }
+  lea(b, RDI, base, disp);
+  movi(b, RCX, n);
+  byte(b, 0x31); byte(b, 0xc0);				/* xor eax, eax */
+  byte(b, 0xf3); byte(b, 0x48); byte(b, 0xab);		/* rep stosq */
+}
+
+/* jit_icall - call an intrinsic and finish the call, as the interpreter */
+/*             does; 1 if the robot was restarted */
+static int jit_icall(s_arena *a, long k)
+{
+  register s_robot *r = a->cur_robot;
+  long value;
+
+  (*intrinsics[k].f)(a);
+  value = pop(a);
+  r->stackptr = *(long **) r->retptr++;
+  pop(a);
+  push(a, value);
+
+  if (!a->r_flag)
+    return (0);
+  robot_go(r);
+  a->r_flag = 0;
+  return (1);
+}
+
+/* emit - generate instruction i of a program, of len instructions */
+static void emit(struct buf *b, s_program *p, int i, int len, void **entry)
+{
+  s_instr *ip = p->code + i;
+  s_func *f;
+  int t, k;
+
+  /* the cycle of the instruction, if there is one left */
+  byte(b, 0x49); byte(b, 0xff); byte(b, 0xce);		/* dec r14 */
+  jcc(b, CC_S, TO_YIELD, i);
+
+  switch (i < len ? ip->ins_type : NOP) {
+
+    case FETCH:
+      need_push(b, i, 1);
+      fetch(b, RAX, I_VAR(ip));
+      store(b, SP, 8, RAX);
+      addi(b, SP, 8);
+      break;
+
+    case CONST:
+      need_push(b, i, 1);
+      if (I_K(p, ip) == (int) I_K(p, ip)) {
+	storei(b, SP, 8, I_K(p, ip));
+      } else {
+	movi(b, RAX, (unsigned long) I_K(p, ip));
+	store(b, SP, 8, RAX);
+      }
+      addi(b, SP, 8);
+      break;
+
+    case STORE_OP ... STORE_OP + NOPS - 1:
+    case BINOP_OP ... BINOP_OP + NOPS - 1:
+      need_pop(b, i, 2);
+      load(b, RAX, SP, -8);
+      load(b, RCX, SP, 0);
+      op(b, I_OP(ip));
+      store(b, SP, -8, RAX);
+      addi(b, SP, -8);
+      if (IS_STORE(ip->ins_type))
+	assign(b, I_VAR(ip), RAX);
+      break;
+
+    case ICALL:
+      movi(b, RAX, (unsigned long) (ip + 1));
+      store(b, ROBOT, R_IP, RAX);		/* where to go on, if restarted */
+      store(b, ROBOT, R_SP, SP);
+      alu(b, 0x89, RDI, ARENA);
+      movi(b, RSI, ip->arg);
+      movi(b, RAX, (unsigned long) jit_icall);
+      byte(b, 0xff); byte(b, 0xd0);		/* call rax */
+      load(b, SP, ROBOT, R_SP);
+      byte(b, 0x85); byte(b, 0xc0);		/* test eax, eax */
+      jcc(b, CC_NE, TO_KEEP, i);
+      break;
+
+    case UCALL:
+      f = I_FN(p, ip);
+      t = f->first - p->code;
+      if (t < 0 || t > len) {
+	jmp(b, TO_SLOW, i);
+	return;
+      }
+      k = f->var_count - f->par_count + 1;	/* locals above the arguments */
+      need_push(b, i, (k > 0 ? k : 0) + 2);
+
+      load(b, RSI, ROBOT, R_RET);		/* return ip and local pool */
+      addi(b, RSI, -16);
+      store(b, ROBOT, R_RET, RSI);
+      movi(b, RAX, (unsigned long) (ip + 1));
+      store(b, RSI, 8, RAX);
+      store(b, RSI, 0, LP);
+
+      lea(b, LP, SP, -(long) (f->par_count - 1) * 8);
+      if (k > 0)
+	zero(b, LP, (long) f->par_count * 8, k);
+      lea(b, SP, LP, (long) f->var_count * 8);
+      jmp(b, TO_LABEL, t);
+      return;
+
+    case RETSUB:
+      load(b, RCX, ROBOT, R_RET);
+      cmpmem(b, RCX, ROBOT, R_END);		/* end of main */
+      jcc(b, CC_E, TO_SLOW, i);
+      cmpmem(b, SP, ROBOT, R_BASE);		/* return value */
+      jcc(b, CC_E, TO_SLOW, i);
+      load(b, RDX, RCX, 16);			/* stack of the caller */
+      cmpmem(b, RDX, ROBOT, R_BASE);
+      jcc(b, CC_E, TO_SLOW, i);
+      lea(b, RAX, RCX, 24);
+      alu(b, 0x39, RAX, RDX);
+      jcc(b, CC_E, TO_SLOW, i);
+      load(b, RAX, RCX, 8);			/* return ip, as an offset */
+      movi(b, RSI, (unsigned long) p->code);
+      alu(b, 0x29, RAX, RSI);
+      rex(b, 0, RAX); byte(b, 0x3d); dword(b, (long) len * INSTR_SIZE);	/* cmp rax, imm */
+      jcc(b, CC_A, TO_SLOW, i);
+      byte(b, 0xa8); byte(b, INSTR_SIZE - 1);	/* test al, imm */
+      jcc(b, CC_NE, TO_SLOW, i);
+
+      load(b, RSI, SP, 0);
+      load(b, LP, RCX, 0);
+      addi(b, RCX, 24);
+      store(b, ROBOT, R_RET, RCX);
+      alu(b, 0x89, SP, RDX);
+      store(b, SP, 0, RSI);
+      movi(b, RDX, (unsigned long) entry);
+      byte(b, 0xff); byte(b, 0x24);		/* jmp [rdx + rax * 8 / size] */
+      byte(b, (INSTR_SIZE == 8 ? 0x00 : INSTR_SIZE == 4 ? 0x40 : 0x80) | (RAX << 3) | RDX);
+      return;
+
+    case BRANCH:
+      t = I_BR(ip) - p->code;
+      if (t < 0 || t > len) {
+	jmp(b, TO_SLOW, i);
+	return;
+      }
+      need_pop(b, i, 1);
+      load(b, RAX, SP, 0);
+      addi(b, SP, -8);
+      alu(b, 0x85, RAX, RAX);
+      jcc(b, CC_E, TO_LABEL, t);
+      break;
+
+    case CHOP:
+      need_pop(b, i, 1);
+      addi(b, SP, -8);
+      break;
+
+    case ENTER:
+      need_push(b, i, ip->arg);
+      zero(b, SP, 8, ip->arg);
+      addi(b, SP, (long) ip->arg * 8);
+      break;
+
+    case LEAVE:
+      lea(b, RSI, SP, -(long) ip->arg * 8);
+      cmpmem(b, RSI, ROBOT, R_BASE);
+      jcc(b, CC_BE, TO_SLOW, i);
+      load(b, RAX, SP, 0);
+      store(b, RSI, 0, RAX);
+      alu(b, 0x89, SP, RSI);
+      break;
+
+    case FRAME:
+      load(b, RSI, ROBOT, R_RET);
+      addi(b, RSI, -8);
+      alu(b, 0x39, RSI, SP);			/* collision into stack */
+      jcc(b, CC_E, TO_SLOW, i);
+      store(b, RSI, 0, SP);
+      store(b, ROBOT, R_RET, RSI);
+      break;
+
+    case FCOP:
+    case FFOP:
+      need_push(b, i, 2);
+      if (ip->ins_type == FCOP)
+	movi(b, RCX, (unsigned long) I_K(p, ip + 1));
+      else
+	fetch(b, RCX, I_VAR(ip + 1));
+      fetch(b, RAX, I_VAR(ip));
+      op(b, I_OP(ip + 2));
+      store(b, SP, 8, RAX);
+      addi(b, SP, 8);
+      owe(b, 2);
+      jmp(b, TO_LABEL, i + 3);
+      return;
+
+    case JUMP:
+      t = I_BR(ip + 1) - p->code;
+      if (t < 0 || t > len) {
+	jmp(b, TO_SLOW, i);
+	return;
+      }
+      need_push(b, i, 1);
+      owe(b, 1);
+      jmp(b, TO_LABEL, t);
+      return;
+
+    case OPBR:
+      t = I_BR(ip + 1) - p->code;
+      if (t < 0 || t > len) {
+	jmp(b, TO_SLOW, i);
+	return;
+      }
+      need_pop(b, i, 2);
+      load(b, RAX, SP, -8);
+      load(b, RCX, SP, 0);
+      op(b, ip->arg);
+      addi(b, SP, -16);
+      owe(b, 1);
+      alu(b, 0x85, RAX, RAX);
+      jcc(b, CC_E, TO_LABEL, t);
+      jmp(b, TO_LABEL, i + 2);
+      return;
+
+    case NOP:
+      if (i == len) {			/* past the end of the code */
+	jmp(b, TO_SLOW, i);
+	return;
+      }
+      break;
+
+    default:
+      break;			/* no-ops, missing functions */
+  }
+}
+
+/* leave - store the robot's stack and pool back, and return rax */
+static void leave(struct buf *b)
+{
+  store(b, ROBOT, R_SP, SP);
+  store(b, ROBOT, R_LOCAL, LP);
+  addi(b, RSP, 8);
+  byte(b, 0x41); byte(b, 0x5f);		/* pop r15 */
+  byte(b, 0x41); byte(b, 0x5e);		/* pop r14 */
+  byte(b, 0x41); byte(b, 0x5d);		/* pop r13 */
+  byte(b, 0x41); byte(b, 0x5c);		/* pop r12 */
+  byte(b, 0x5d);			/* pop rbp */
+  byte(b, 0x5b);			/* pop rbx */
+  byte(b, 0xc3);
+}
+
+
+/* jit_compile - translate the code of a program, after link_code() and */
+/*               fuse_code(); returns 0 if the interpreter must be used */
+int jit_compile(s_program *p)
+{
+  struct jit *j;
+  struct buf b;
+  unsigned char **label, **yield, **slow, *end, *out, *back, *keep, *to;
+  unsigned long used, page;
+  int len, i, ok = 1;
+
+  for (len = 0; p->code[len].ins_type != NOP; len++)
+    ;
+
+  j = calloc(1, sizeof(struct jit));
+  j->len = len;
+  j->entry = calloc(len + 1, sizeof(j->entry[0]));
+  j->size = (unsigned long) (len + 1) * (FRAG_MAX + STUB_MAX) + 2 * FRAG_MAX;
+  j->mem = mmap(NULL, j->size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (j->mem == MAP_FAILED) {
+    free(j->entry);
+    free(j);
+    return (0);
+  }
+
+  memset(&b, 0, sizeof(b));
+  b.p = j->mem;
+  b.slow = calloc(len + 1, 1);
+  end = (unsigned char *) j->mem + j->size;
+  label = calloc(len + 1, sizeof(label[0]));
+  yield = calloc(len + 1, sizeof(yield[0]));
+  slow = calloc(len + 1, sizeof(slow[0]));
+
+  /* the way in: save what the routine uses, load the robot, and go to */
+  /* the instruction 'at' */
+  j->run = (long (*)(s_robot *, s_arena *, long, void *)) b.p;
+  byte(&b, 0x53);			/* push rbx */
+  byte(&b, 0x55);			/* push rbp */
+  byte(&b, 0x41); byte(&b, 0x54);	/* push r12 */
+  byte(&b, 0x41); byte(&b, 0x55);	/* push r13 */
+  byte(&b, 0x41); byte(&b, 0x56);	/* push r14 */
+  byte(&b, 0x41); byte(&b, 0x57);	/* push r15 */
+  addi(&b, RSP, -8);			/* calls need the stack aligned */
+  alu(&b, 0x89, ROBOT, RDI);
+  alu(&b, 0x89, ARENA, RSI);
+  alu(&b, 0x89, LEFT, RDX);
+  load(&b, SP, ROBOT, R_SP);
+  load(&b, LP, ROBOT, R_LOCAL);
+  load(&b, EXT, ROBOT, R_EXT);
+  byte(&b, 0xff); byte(&b, 0xe1);	/* jmp rcx */
+
+  /* the code, then the ways out of each instruction */
+  for (i = 0; i <= len && ok; i++) {
+    label[i] = b.p;
+    j->entry[i] = b.p;
+    emit(&b, p, i, len, j->entry);
+    ok = end - b.p >= (long) (len - i) * FRAG_MAX + (long) (len + 1) * STUB_MAX +
+		      FRAG_MAX;
+  }
+  for (i = 0; i <= len && ok; i++) {
+    yield[i] = b.p;
+    movi(&b, RAX, (unsigned long) (p->code + i));
+    jmp(&b, TO_OUT, i);
+    if (b.slow[i]) {
+      slow[i] = b.p;
+      movi(&b, RAX, (unsigned long) (p->code + i));
+      jmp(&b, TO_BACK, i);
+    }
+  }
+
+  /* out of cycles: at the ip in rax, none left */
+  out = b.p;
+  store(&b, ROBOT, R_IP, RAX);
+  byte(&b, 0x31); byte(&b, 0xc0);	/* xor eax, eax */
+  leave(&b);
+
+  /* left to the interpreter: at the ip in rax, the cycles left negated */
+  back = b.p;
+  store(&b, ROBOT, R_IP, RAX);
+  lea(&b, RAX, LEFT, 1);
+  byte(&b, 0x48); byte(&b, 0xf7); byte(&b, 0xd8);	/* neg rax */
+  leave(&b);
+
+  /* restarted, at the ip and pool the robot has, the cycles left */
+  keep = b.p;
+  load(&b, LP, ROBOT, R_LOCAL);
+  alu(&b, 0x89, RAX, LEFT);
+  leave(&b);
+
+  for (i = 0; i < b.nfix && ok; i++) {
+    switch (b.fix[i].to) {
+      case TO_LABEL: to = label[b.fix[i].i]; break;
+      case TO_YIELD: to = yield[b.fix[i].i]; break;
+      case TO_SLOW:  to = slow[b.fix[i].i]; break;
+      case TO_OUT:   to = out; break;
+      case TO_BACK:  to = back; break;
+      default:       to = keep; break;
+    }
+    patch(b.fix[i].at, to);
+  }
+
+  used = b.p - (unsigned char *) j->mem;
+  free(b.fix);
+  free(b.slow);
+  free(label);
+  free(yield);
+  free(slow);
+
+  /* give back what the code did not use */
+  page = (unsigned long) sysconf(_SC_PAGESIZE);
+  used = (used + page - 1) & ~(page - 1);
+  if (ok && used < j->size) {
+    munmap((char *) j->mem + used, j->size - used);
+    j->size = used;
+  }
+
+  /* never writable and executable at the same time */
+  if (!ok || mprotect(j->mem, j->size, PROT_READ | PROT_EXEC) != 0) {
+    munmap(j->mem, j->size);
+    free(j->entry);
+    free(j);
+    return (0);
+  }
+
+  p->jit = j;
+  return (1);
+}
+
+
+/* jit_free - release the native code of a program */
+void jit_free(s_program *p)
+{
+  if (!p->jit)
+    return;
+
+  munmap(p->jit->mem, p->jit->size);
+  free(p->jit->entry);
+  free(p->jit);
+  p->jit = NULL;
+}
+
+
+/* jit_burst - run n cycles of the current robot, in native code if it */
+/*             has any and n is more than one, or else by burst() */
+void jit_burst(s_arena *a, int n)
+{
+  register s_robot *r = a->cur_robot;
+  struct jit *j = r->prog->jit;
+  long left = n, i;
+
+  if (!j || n == 1) {		/* a lone cycle does not pay the entry */
+    burst(a, n);
+    return;
+  }
+
+  while (left > 0) {
+    if (r->stall > 0) {		/* owed by a superinstruction */
+      i = r->stall < left ? r->stall : left;
+      r->stall -= i;
+      left -= i;
+      continue;
+    }
+
+    i = r->ip - r->prog->code;
+    if (i < 0 || i > j->len) {
+      burst(a, left);
+      return;
+    }
+
+    left = j->run(r, a, left, j->entry[i]);
+    if (left < 0) {		/* an instruction that could fail */
+      cycle(a);
+      left = -left - 1;
+    }
+  }
+}
+
+#else  /* !JIT_X86_64 */
+
+/* jit_compile - no code generator for this host, use the interpreter */
+int jit_compile(s_program *p)
+{
+  (void)p;
+  return (0);
+}
+
+void jit_free(s_program *p)
+{
+  (void)p;
+}
+
+/* jit_burst - run n cycles of the current robot, interpreted */
+void jit_burst(s_arena *a, int n)
+{
+  burst(a, n);
+}
+
+#endif /* JIT_X86_64 */
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: nil
+ *  c-file-style: "gnu"
+ * End:
+ */
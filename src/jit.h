@@ -0,0 +1,37 @@
+/* jit.h - native code generation for robot instructions
+ *
+ * Copyright (C) 2026 The CROW authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef CROBOTS_JIT_H_
+#define CROBOTS_JIT_H_
+
+#include "crobots.h"
+
+/* native code of one program, entered at any instruction; runs up to n */
+/* cycles and returns those left, negated if the instruction at the ip */
+/* of the robot is left to the interpreter */
+struct jit {
+  long (*run)(s_robot *r, s_arena *a, long n, void *at);
+  void **entry;			/* native code by instruction offset */
+  int len;			/* instructions, the last entry past them */
+  void *mem;			/* executable region */
+  unsigned long size;		/* size of region in bytes */
+};
+
+int  jit_compile(s_program *p);
+void jit_free(s_program *p);
+void jit_burst(s_arena *a, int n);
+
+#endif /* CROBOTS_JIT_H_ */
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: nil
+ *  c-file-style: "gnu"
+ * End:
+ */
@@ -46,7 +46,7 @@
 /* c_scan - radar scanning function - note degrees instead of radians */
 /*          expects two agruments on stack, degree and resoultion */
 
-void c_scan(void)
+void c_scan(s_arena *a)
 {
   register int i;
   long degree;
@@ -57,7 +57,7 @@ void c_scan(void)
   long d, dd, d1, d2;
 
   /* get degree of scan resolution, up to limit */
-  res = pop();
+  res = pop(a);
   if (res < 0L)
     res = 0L;
   else
@@ -65,41 +65,41 @@ void c_scan(void)
     res = RES_LIMIT;
 
   /* get scan direction */
-  degree = pop();
+  degree = pop(a);
   if (degree < 0L)
     degree = -degree;
   if (degree >= 360L)
     degree %= 360L;
 
 
-  cur_robot->scan = (int) degree;	/* record scan for display */
+  a->cur_robot->scan = (int) degree;	/* record scan for display */
 
   /* Log action */
-  if (g_config.log_actions && cur_robot->action_buffer.count < MAX_ACTIONS_PER_SNAPSHOT) {
-    int idx = cur_robot->action_buffer.count++;
-    cur_robot->action_buffer.actions[idx].type = ACTION_SCAN;
-    cur_robot->action_buffer.actions[idx].param1 = (int)degree;
-    cur_robot->action_buffer.actions[idx].param2 = (int)res;
+  if (a->config.log_actions && a->cur_robot->action_buffer.count < MAX_ACTIONS_PER_SNAPSHOT) {
+    int idx = a->cur_robot->action_buffer.count++;
+    a->cur_robot->action_buffer.actions[idx].type = ACTION_SCAN;
+    a->cur_robot->action_buffer.actions[idx].param1 = (int)degree;
+    a->cur_robot->action_buffer.actions[idx].param2 = (int)res;
   }
 
   /* check other robots for +/- resolution */
   for (i = 0; i < MAXROBOTS; i++) {
-    if (cur_robot == &robots[i] || robots[i].status == DEAD)
+    if (a->cur_robot == &a->robots[i] || a->robots[i].status == DEAD)
       continue;  /* skip current or dead robots */
     /* find relative degree angle */
-    x = (cur_robot->x / CLICK) - (robots[i].x / CLICK);
-    y = (cur_robot->y / CLICK) - (robots[i].y / CLICK);
+    x = (a->cur_robot->x / CLICK) - (a->robots[i].x / CLICK);
+    y = (a->cur_robot->y / CLICK) - (a->robots[i].y / CLICK);
     if ((int)(x + 0.5) == 0)
       /* avoid division by zero */
-      d = (robots[i].y > cur_robot->y) ? 90 : 270;
+      d = (a->robots[i].y > a->cur_robot->y) ? 90 : 270;
     else {
-      if (robots[i].y < cur_robot->y) {
-        if (robots[i].x > cur_robot->x)
+      if (a->robots[i].y < a->cur_robot->y) {
+        if (a->robots[i].x > a->cur_robot->x)
           d = 360.0 + (RAD_DEG * atan(y / x)); /* relative quadrant 4 */
         else
           d = 180.0 + (RAD_DEG * atan(y / x)); /* relative quadrant 3 */
       } else {
-        if (robots[i].x > cur_robot->x)
+        if (a->robots[i].x > a->cur_robot->x)
           d = RAD_DEG * atan(y / x);           /* relative quadrant 1 */
         else
           d = 180.0 + (RAD_DEG * atan(y / x)); /* relative quadrant 2 */
@@ -131,31 +131,31 @@ void c_scan(void)
     }
   }
 
-  push((long) close_dist);
+  push(a, (long) close_dist);
 
 }
 
 /* c_cannon - fire a shot */
 /*            expects two agruments on stack, degree distance */
 
-void c_cannon(void)
+void c_cannon(s_arena *a)
 {
   long degree;
   long distance;
   register int i;
   register int r;
 
-  r = cur_robot - &robots[0];
+  r = a->cur_robot - &a->robots[0];
 
-  distance = pop();
-  if (distance > MIS_RANGE)
-    distance = MIS_RANGE;
+  distance = pop(a);
+  if (distance > MIS_RANGE(a))
+    distance = MIS_RANGE(a);
   else
   if (distance < 0L) {
-    push(1L);
+    push(a, 1L);
     return;
   }
-  degree = pop();
+  degree = pop(a);
   if (degree < 0L)
     degree = -degree;
   if (degree >= 360L)
@@ -163,48 +163,48 @@ void c_cannon(void)
 
   if (r_debug)
     printf("\ncannon: degree %ld, distance %ld; reload %d\n",degree,distance,
-           cur_robot->reload);
+           a->cur_robot->reload);
 
   /* see if cannon is reloading */
-  if (cur_robot->reload > 0) {
+  if (a->cur_robot->reload > 0) {
     /* cannot fire until reload cycle complete */
     if (r_debug)
-      printf("reloading: %d\n",cur_robot->reload);
-    push(0L);
+      printf("reloading: %d\n",a->cur_robot->reload);
+    push(a, 0L);
     return;
   }
 
   /* fire cannon, if one of two missiles are available */
   for (i = 0; i < MIS_ROBOT; i++) {
-    if (missiles[r][i].stat == AVAIL) {
+    if (a->missiles[r][i].stat == AVAIL) {
       /* fire */
       if (r_debug)
         printf("cannon fired\n");
-      cur_robot->reload = RELOAD;
-      missiles[r][i].stat = FLYING;
-      missiles[r][i].beg_x  = cur_robot->x;
-      missiles[r][i].beg_y  = cur_robot->y;
-      missiles[r][i].cur_x  = cur_robot->x;
-      missiles[r][i].cur_y  = cur_robot->y;
-      missiles[r][i].head = (int) degree;
-      missiles[r][i].rang = (int) (distance * CLICK);
-      missiles[r][i].curr_dist = 0;
-      missiles[r][i].count = EXP_COUNT;
+      a->cur_robot->reload = RELOAD;
+      a->missiles[r][i].stat = FLYING;
+      a->missiles[r][i].beg_x  = a->cur_robot->x;
+      a->missiles[r][i].beg_y  = a->cur_robot->y;
+      a->missiles[r][i].cur_x  = a->cur_robot->x;
+      a->missiles[r][i].cur_y  = a->cur_robot->y;
+      a->missiles[r][i].head = (int) degree;
+      a->missiles[r][i].rang = (int) (distance * CLICK);
+      a->missiles[r][i].curr_dist = 0;
+      a->missiles[r][i].count = EXP_COUNT;
 
       /* Log action */
-      if (g_config.log_actions && cur_robot->action_buffer.count < MAX_ACTIONS_PER_SNAPSHOT) {
-        int idx = cur_robot->action_buffer.count++;
-        cur_robot->action_buffer.actions[idx].type = ACTION_CANNON;
-        cur_robot->action_buffer.actions[idx].param1 = (int)degree;
-        cur_robot->action_buffer.actions[idx].param2 = (int)distance;
+      if (a->config.log_actions && a->cur_robot->action_buffer.count < MAX_ACTIONS_PER_SNAPSHOT) {
+        int idx = a->cur_robot->action_buffer.count++;
+        a->cur_robot->action_buffer.actions[idx].type = ACTION_CANNON;
+        a->cur_robot->action_buffer.actions[idx].param1 = (int)degree;
+        a->cur_robot->action_buffer.actions[idx].param2 = (int)distance;
       }
 
-      push(1L);
+      push(a, 1L);
       return;
     }
   }
 
-  push(0L);
+  push(a, 0L);
 
 }
 
@@ -212,18 +212,18 @@ void c_cannon(void)
 /* c_drive - start the propulsion system */
 /*           expect two agruments, degrees & speed */
 
-void c_drive(void)
+void c_drive(s_arena *a)
 {
   long degree;
   long speed;
 
-  speed = pop();
+  speed = pop(a);
   if (speed < 0L)
     speed = 0L;
   else
   if (speed > 100L)
     speed = 100L;
-  degree = pop();
+  degree = pop(a);
   if (degree < 0L)
     degree = -degree;
   if (degree >= 360L)
@@ -233,137 +233,136 @@ void c_drive(void)
     printf("\ndrive: degree %ld, speed %ld\n",degree,speed);
 
   /* update desired speed and heading */
-  cur_robot->d_heading = (int) degree;
-  cur_robot->d_speed = (int) speed;
+  a->cur_robot->d_heading = (int) degree;
+  a->cur_robot->d_speed = (int) speed;
 
   /* Log action */
-  if (g_config.log_actions && cur_robot->action_buffer.count < MAX_ACTIONS_PER_SNAPSHOT) {
-    int idx = cur_robot->action_buffer.count++;
-    cur_robot->action_buffer.actions[idx].type = ACTION_DRIVE;
-    cur_robot->action_buffer.actions[idx].param1 = (int)degree;
-    cur_robot->action_buffer.actions[idx].param2 = (int)speed;
+  if (a->config.log_actions && a->cur_robot->action_buffer.count < MAX_ACTIONS_PER_SNAPSHOT) {
+    int idx = a->cur_robot->action_buffer.count++;
+    a->cur_robot->action_buffer.actions[idx].type = ACTION_DRIVE;
+    a->cur_robot->action_buffer.actions[idx].param1 = (int)degree;
+    a->cur_robot->action_buffer.actions[idx].param2 = (int)speed;
   }
 
-  push(1L);
+  push(a, 1L);
 }
 
 
 /* c_damage - report on damage sustained */
 
-void c_damage(void)
+void c_damage(s_arena *a)
 {
-  push((long) cur_robot->damage);
+  push(a, (long) a->cur_robot->damage);
 }
 
 
 /* c_speed - report current speed */
 
-void c_speed(void)
+void c_speed(s_arena *a)
 {
-  push((long) cur_robot->speed);
+  push(a, (long) a->cur_robot->speed);
 }
 
 
 /* c_loc_x - report current x location */
 
-void c_loc_x(void)
+void c_loc_x(s_arena *a)
 {
-  push((long) cur_robot->x / CLICK);
+  push(a, (long) a->cur_robot->x / CLICK);
 }
 
 
 /* c_loc_y - report current y location */
 
-void c_loc_y(void)
+void c_loc_y(s_arena *a)
 {
-  push((long) cur_robot->y / CLICK);
+  push(a, (long) a->cur_robot->y / CLICK);
 }
 
 
 /* c_rand - return a random number between 0 and limit */
 /*          expect one argument, limit */
 
-void c_rand(void)
+void c_rand(s_arena *a)
 {
-  int rand();
   long limit;
 
-  limit = pop();
+  limit = pop(a);
 
   if (limit <= 0L)
-    push(0L);
+    push(a, 0L);
   else
-    push((long) ((long)(rand()) % limit));
+    push(a, rng_rand(&a->cur_robot->rng) % limit);
 }
 
 
 /* c_sin - return sin(degrees) * SCALE */
 /*         expect one agrument, degrees */
 
-void c_sin(void)
+void c_sin(s_arena *a)
 {
   long degree;
   long lsin();
 
-  degree = pop() % 360L;
+  degree = pop(a) % 360L;
   degree = (long) lsin(degree);
 
-  push(degree);
+  push(a, degree);
 }
 
 
 /* c_cos - return cos(degrees) * SCALE */
 /*         expect one agrument, degrees */
 
-void c_cos(void)
+void c_cos(s_arena *a)
 {
   long degree;
   long lcos();
 
-  degree = pop() % 360L;
+  degree = pop(a) % 360L;
   degree = (long) lcos(degree);
 
-  push(degree);
+  push(a, degree);
 }
 
 
 /* c_tan - return tan(degrees) * SCALE */
 /*         expect one agrument, degrees */
 
-void c_tan(void)
+void c_tan(s_arena *a)
 {
   long degree;
 
-  degree = pop() % 360L;
+  degree = pop(a) % 360L;
   degree = (long) (tan((double) degree / RAD_DEG) * SCALE);
 
-  push(degree);
+  push(a, degree);
 }
 
 
 /* c_atan - return atan(x) */
 /*          expect one agrument, ratio * SCALE */
 
-void c_atan(void)
+void c_atan(s_arena *a)
 {
   long degree;
   long ratio;
 
-  ratio = pop();
+  ratio = pop(a);
   degree = (long) (atan((double) ratio / SCALE) * RAD_DEG);
 
-  push(degree);
+  push(a, degree);
 }
 
 
 /* c_sqrt - return sqrt(x) */
 /*          expect one agrument, x */
 
-void c_sqrt(void)
+void c_sqrt(s_arena *a)
 {
   long x;
 
-  x = pop();
+  x = pop(a);
 
   /* ensure x is positive */
   if (x < 0L)
@@ -371,23 +370,23 @@ void c_sqrt(void)
 
   x = (long) (sqrt((double) x));
 
-  push(x);
+  push(a, x);
 }
 
 
 /* c_batsiz - return the battlefield size in meters */
 
-void c_batsiz(void)
+void c_batsiz(s_arena *a)
 {
-  push((long) g_config.battlefield_size);
+  push(a, (long) a->config.battlefield_size);
 }
 
 
 /* c_canrng - return the cannon range in meters */
 
-void c_canrng(void)
+void c_canrng(s_arena *a)
 {
-  push((long) g_config.mis_range);
+  push(a, (long) a->config.mis_range);
 }
 
 /**
@@ -19,23 +19,25 @@
 #ifndef CROBOTS_LIBRARY_H_
 #define CROBOTS_LIBRARY_H_
 
+#include "crobots.h"
+
 /* declare the intrinsic functions, all must push a long value on the stack */
 /* these functions don't return a long, but declared long for notation */
-void c_scan  (void);  /* scan(degree,res);  >0 = robot distance, 0 = nothing */
-void c_cannon(void);  /* cannon(degree,dist); fire cannon */
-void c_drive (void);  /* drive(degree,speed); speed 0-100 in % */
-void c_damage(void);  /* damage(); = current damage in % */
-void c_speed (void);  /* speed(); = current speed */
-void c_loc_x (void);  /* loc_x(); = current x location */
-void c_loc_y (void);  /* loc_y(); = current y location */
-void c_rand  (void);  /* rand(limit); = 0 -- limit (2**15)-1 */
-void c_sin   (void);  /* sin(degree); = sin * 100000 */
-void c_cos   (void);  /* cos(degree); = cos * 100000 */
-void c_tan   (void);  /* tan(degree); = tan * 100000 */
-void c_atan  (void);  /* atan(ratio); = degree */
-void c_sqrt  (void);  /* sqrt(x); = square root */
-void c_batsiz(void);  /* batsiz(); = battlefield size in meters */
-void c_canrng(void);  /* canrng(); = cannon range in meters */
+void c_scan  (s_arena *a);  /* scan(degree,res);  >0 = robot distance, 0 = nothing */
+void c_cannon(s_arena *a);  /* cannon(degree,dist); fire cannon */
+void c_drive (s_arena *a);  /* drive(degree,speed); speed 0-100 in % */
+void c_damage(s_arena *a);  /* damage(); = current damage in % */
+void c_speed (s_arena *a);  /* speed(); = current speed */
+void c_loc_x (s_arena *a);  /* loc_x(); = current x location */
+void c_loc_y (s_arena *a);  /* loc_y(); = current y location */
+void c_rand  (s_arena *a);  /* rand(limit); = 0 -- limit (2**15)-1 */
+void c_sin   (s_arena *a);  /* sin(degree); = sin * 100000 */
+void c_cos   (s_arena *a);  /* cos(degree); = cos * 100000 */
+void c_tan   (s_arena *a);  /* tan(degree); = tan * 100000 */
+void c_atan  (s_arena *a);  /* atan(ratio); = degree */
+void c_sqrt  (s_arena *a);  /* sqrt(x); = square root */
+void c_batsiz(s_arena *a);  /* batsiz(); = battlefield size in meters */
+void c_canrng(s_arena *a);  /* canrng(); = cannon range in meters */
 
 #endif /* CROBOTS_LIBRARY_H_ */
 
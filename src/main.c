@@ -30,58 +30,68 @@
 
 /* crobots includes */
 #include "crobots.h"
+#include "aot.h"
+#include "cache.h"
 #include "compiler.h"
 #include "display.h"
 #include "grammar.h"
 #include "cpu.h"
+#include "jit.h"
 #include "motion.h"
+#include "policy.h"
+#include "pool.h"
+#include "program.h"
+#include "rng.h"
 #include "screen.h"
 #include "snapshot.h"
 
-s_missile missiles[MAXROBOTS][MIS_ROBOT];
+static s_arena arena;		/* robots, missiles and state of play */
 
-s_robot *cur_robot,		/* current robot */
-        robots[MAXROBOTS];	/* all robots */
+int r_interactive,		/* enable classic 'Press <enter> to continue */
+    r_stats,			/* show robot stats on exit */
+    r_jit,			/* run robots as native code */
+    r_optimize,			/* optimization level of the compiler, -O */
+    r_burst = 1,		/* cycles per robot turn in match play */
+    r_workers = 1;		/* threads for match play */
 
-int r_debug,			/* debug switch */
-    r_flag,			/* global flag for push/pop errors */
-    r_interactive,		/* enable classic 'Press <enter> to continue */
-    r_stats;			/* show robot stats on exit */
+static char *r_cache;		/* directory of compiled robots, -D */
+static uint64_t r_seed;		/* random numbers of all matches, -S */
+static int r_first = 1;		/* number of the first match, -M */
+
+/* runs n cycles of cur_robot, burst(), jit_burst() or aot_burst() */
+static void (*run)(s_arena *a, int n) = burst;
 
 FILE *f_in;			/* the compiler input source file */
 FILE *f_out;			/* the compiler diagnostic file, assumed opened */
 FILE *f_snapshot = NULL;	/* snapshot output file */
 int r_snapshot = 0;		/* snapshot mode flag */
 
-/* Global configuration structure */
 config_t g_config = {
     .battlefield_size = 1024,
     .snapshot_grid_size = 128,
     .max_x = 1024,
     .max_y = 1024,
     .mis_range = 716,
+    .decide = MOTION_CYCLES,
     .snapshot_interval = 30,
     .log_actions = 1,
     .log_rewards = 1,
     .show_ascii = 0
 };
 
-/* Damage tracker for reward calculation */
-s_damage_tracker damage_tracker;
 
 /* SIGINT handler */
 void catch_int(int);
 
 /* high level functions */
-int comp(char *f[], int n);
-void play(char *f[], int n);
-void match(int m, long l, char *f[], int n);
-void debug(char *f);
-void init_robot(int i);
-void clone_robot(int i);
-void free_robot(int i);
-void robot_stats(void);
-void rand_pos(int n);
+int comp(s_arena *a, char *f[], int n);
+void play(s_arena *a, char *f[], int n);
+void match(s_arena *a, int m, long l, char *f[], int n);
+void debug(s_arena *a, char *f);
+void clone_robot(s_arena *a, int i);
+void free_robot(s_arena *a, int i);
+void robot_stats(s_arena *a);
+static void seed_match(s_arena *a, int k);
 
 /* Check if a number is a power of 2 */
 static int is_power_of_2(int n)
@@ -99,6 +109,10 @@ static void init_config(void)
     /* Default instruction limit if not set via CLI */
     if (g_config.max_instr == 0)
         g_config.max_instr = 1000;
+
+    /* Default data stack if not set via CLI */
+    if (g_config.stack_size == 0)
+        g_config.stack_size = DATASPACE;
 }
 
 static int usage(int rc)
@@ -108,28 +122,54 @@ static int usage(int rc)
 	 "\n"
 	 "Options:\n"
 	 "  -a 0|1    Enable/disable action logging (default 1)\n"
+	 "  -B NUM    Burst scheduling in match play, each robot runs NUM cycles\n"
+	 "            in a row, up to the next motion update (range 1-%d).  The\n"
+	 "            default, 1, interleaves robots one instruction at a time\n"
 	 "  -b SIZE   Battlefield size (SIZE×SIZE meters, must be power of 2,\n"
 	 "            range 64-16384, default 1024)\n"
+	 "  -C        Compile one program to a shared object, named by '-o' or\n"
+	 "            after the program.  Shared objects (.so) are loaded in\n"
+	 "            place of robot source files and run natively, in bursts\n"
+	 "            of '-B' over 1 only; single cycles are interpreted\n"
 	 "  -c        Compile only, produce virtual machine assembler code and\n"
 	 "            symbol tables\n"
+	 "  -D DIR    Cache compiled robots in DIR, by hash of their source and\n"
+	 "            of '-k' and '-O', to load them again without compiling\n"
 	 "  -d        Compile one program, then invoke machine level single step\n"
 	 "            tracing (debugger)\n"
 	 "  -g SIZE   Snapshot grid size (SIZE×SIZE, must be power of 2,\n"
 	 "            range 16-1024, default 128)\n"
 	 "  -h        This help text\n"
 	 "  -i        Interactive mode, show code output and 'Press <enter> ..'\n"
+	 "  -J        Compile robots to native code, where supported (x86-64).\n"
+	 "            Native code runs in bursts of '-B' over 1 only; single\n"
+	 "            cycles are interpreted\n"
+	 "  -j NUM    Play matches on NUM threads (range 1-%d), with the same\n"
+	 "            output as on one\n"
+	 "  -K SIZE   Data stack of each robot, in entries for its locals and\n"
+	 "            expressions (range 100-1000000, default %d)\n"
 	 "  -k SIZE   Max robot instruction limit (range 256-8000, default 1000)\n"
 	 "  -m NUM    Run a series of matches, were NUM is the number of matches.\n"
 	 "            If '-m' is not specified, the default is to run one match\n"
 	 "            and display the realtime battlefield\n"
+	 "  -M NUM    Number of the first match (default 1), with '-S' to play\n"
+	 "            again any match of a series\n"
 	 "  -l NUM    Limit the number of machine CPU cycles per match when '-m'\n"
 	 "            is specified.  The default cycle limit is 500,000\n"
+	 "  -O LEVEL  Optimize the code of robots, 1 folds constants and drops\n"
+	 "            dead code, so robots take fewer cycles, 2 also inlines\n"
+	 "            small functions; 0 (default) runs the code as the classic\n"
+	 "            compiler made it\n"
 	 "  -o FILE   Output game state snapshots to FILE. Writes ASCII battlefield\n"
 	 "            and structured data each update cycle. Works with -m for batch\n"
 	 "            recording. Headless mode when combined with -m.\n"
+	 "  -p CYCLES Decision interval of robots driven by an external policy\n"
+	 "            (range 1-100000, default %d), see robot.shm below\n"
 	 "  -r 0|1    Enable/disable reward logging (default 1)\n"
 	 "  -u CYCLES Snapshot interval in CPU cycles (range 1-1000, default 30).\n"
 	 "            Lower values produce more snapshots, higher values produce fewer\n"
+	 "  -S SEED   Seed of the random numbers, default from the time of day.\n"
+	 "            Match play with the same seed plays the same matches\n"
 	 "  -s        Show robot stats on exit\n"
 	 "  -v        Show program version and exit\n"
 	 "  -x 0|1    Enable/disable ASCII battlefield visualization (default 0)\n"
@@ -140,35 +180,62 @@ static int usage(int rc)
 	 "            will be \"cloned\" into another, so that two robots (running\n"
 	 "            the same program) will compete.  Any file name may be used,\n"
 	 "            but for consistency use '.r' as the extension\n"
+	 "  name.shm  A robot driven by another process, a policy, over the\n"
+	 "            shared memory channel of the file, see crow.h\n"
 	 "  [>file]   Use DOS 2.0+ redirection to get a compile listing (with '-c')\n"
 	 "            or to record matches (with '-m option)\n"
-	 "\n"
-	 );
+	 "\n",
+	 MOTION_CYCLES, MAX_WORKERS, DATASPACE, MOTION_CYCLES);
 
   return rc;
 }
 
 
+/* so_name - default shared object for a robot, robot.r -> robot.so */
+static char *so_name(char *f)
+{
+  char *so, *dot;
+
+  so = malloc(strlen(f) + 4);
+  strcpy(so, f);
+  dot = strrchr(so, '.');
+  if (dot && !strchr(dot, '/'))
+    *dot = '\0';
+  strcat(so, ".so");
+
+  return so;
+}
+
+
 int main(int argc,char *argv[])
 {
   long limit = CYCLE_LIMIT;
   int matches = 0;
   int comp_only = 0;
+  int aot_only = 0;
+  char *out_file = NULL;
   int debug_only = 0;
   int ignored = 0;
   int i, c;
   int num_robots = 0;
-  unsigned seed;
-  long cur_time;
+  int seeded = 0;
+  s_arena *a = &arena;
 
   setlinebuf(stdout);
 
-  while ((c = getopt(argc, argv, "a:b:cdg:hik:l:m:o:r:su:vx:")) != EOF) {
+  while ((c = getopt(argc, argv, "a:B:b:CcD:dg:hiJj:K:k:l:M:m:O:o:p:r:S:su:vx:")) != EOF) {
       switch (c) {
         case 'a':		/* action logging */
           g_config.log_actions = atoi(optarg);
           break;
 
+        case 'B':		/* burst scheduling */
+          r_burst = atoi(optarg);
+          if (r_burst < 1 || r_burst > MOTION_CYCLES) {
+            errx(1, "Burst size must be in range 1-%d cycles, got %d", MOTION_CYCLES, r_burst);
+          }
+          break;
+
         case 'b':		/* battlefield size */
         {
           int size = atoi(optarg);
@@ -182,11 +249,19 @@ int main(int argc,char *argv[])
         }
           break;
 
+        case 'C':		/* compile to a shared object */
+          aot_only = 1;
+          break;
+
         case 'c':		/* compile only flag */
           comp_only = 1;
           r_debug = 1;          /* turns on full compile info */
           break;
 
+        case 'D':		/* cache of compiled robots */
+          r_cache = optarg;
+          break;
+
         case 'd':		/* debug one robot */
           debug_only = 1;
           r_debug = 1;          /* turns on full compile info */
@@ -212,6 +287,28 @@ int main(int argc,char *argv[])
 	  r_interactive = 1;
 	  break;
 
+	case 'J':		/* native code */
+	  r_jit = 1;
+	  run = jit_burst;
+	  break;
+
+	case 'j':		/* worker threads */
+	  r_workers = atoi(optarg);
+	  if (r_workers < 1 || r_workers > MAX_WORKERS) {
+	    errx(1, "Worker threads must be in range 1-%d, got %d", MAX_WORKERS, r_workers);
+	  }
+	  break;
+
+	case 'K':		/* data stack entries */
+	{
+	  int size = atoi(optarg);
+	  if (size < 100 || size > 1000000) {
+	    errx(1, "Stack size must be in range 100-1000000, got %d", size);
+	  }
+	  g_config.stack_size = size;
+	}
+	  break;
+
 	case 'k':		/* max instruction limit */
 	{
 	  int size = atoi(optarg);
@@ -226,22 +323,47 @@ int main(int argc,char *argv[])
 	  limit = atol(optarg);
 	  break;
 
+	case 'M':		/* first match number */
+	  r_first = atoi(optarg);
+	  if (r_first < 1) {
+	    errx(1, "First match must be 1 or more, got %d", r_first);
+	  }
+	  break;
+
         case 'm':		/* run multiple matches */
 	  matches = atoi(optarg);
 	  break;
 
-	case 'o':		/* snapshot output file */
-	  r_snapshot = 1;
-	  f_snapshot = fopen(optarg, "w");
-	  if (!f_snapshot) {
-	    err(1, "Failed to open snapshot file '%s'", optarg);
+	case 'O':		/* optimization level */
+	  r_optimize = atoi(optarg);
+	  if (r_optimize < 0 || r_optimize > 2) {
+	    errx(1, "Optimization level must be 0 to 2, got %d", r_optimize);
 	  }
 	  break;
 
+	case 'o':		/* snapshot output file, or shared object with -C */
+	  out_file = optarg;
+	  break;
+
+	case 'p':		/* decision interval of policies */
+	{
+	  int interval = atoi(optarg);
+	  if (interval < 1 || interval > 100000) {
+	    errx(1, "Decision interval must be in range 1-100000 cycles, got %d", interval);
+	  }
+	  g_config.decide = interval;
+	}
+	  break;
+
 	case 'r':		/* reward logging */
 	  g_config.log_rewards = atoi(optarg);
 	  break;
 
+	case 'S':		/* random seed */
+	  r_seed = strtoull(optarg, NULL, 0);
+	  seeded = 1;
+	  break;
+
         case 's':
 	  r_stats= 1;
 	  break;
@@ -272,6 +394,15 @@ int main(int argc,char *argv[])
 
   /* Initialize config with derived values */
   init_config();
+  a->config = g_config;
+
+  if (out_file && !aot_only) {
+    r_snapshot = 1;
+    f_snapshot = fopen(out_file, "w");
+    if (!f_snapshot) {
+      err(1, "Failed to open snapshot file '%s'", out_file);
+    }
+  }
 
   /* print version, copyright notice, GPL notice */
   if (r_interactive) {
@@ -288,48 +419,65 @@ int main(int argc,char *argv[])
 
   /* init robots */
   for (i = 0; i < MAXROBOTS; i++) {
-    init_robot(i);
-    robots[i].name[0] = '\0';
+    init_robot(a, i);
+    a->robots[i].name[0] = '\0';
   }
 
-  /* seed the random number generator */
-  cur_time = time(NULL);
-  seed = (unsigned) (cur_time & 0x0000ffffL);
-  srand(seed);
+  /* seed the random number generator, unless -S */
+  if (!seeded)
+    r_seed = (uint64_t) (time(NULL) & 0x0000ffffL);
+  seed_match(a, r_first);
 
   /* now, figure out what to do */
   f_out = stdout;		/* override below */
 
+  /* compile the first robot listed to a shared object */
+  if (aot_only) {
+    if (policy_file(argv[optind]))
+      errx(1, "'%s' is a policy, nothing to compile", argv[optind]);
+    if (!comp(a, &argv[optind], 1))
+      return 1;
+    if (!aot_build(a->robots[0].prog, out_file ? out_file : so_name(argv[optind])))
+      return 1;
+    return 0;
+  }
+
   /* compile only */
   if (comp_only) {
-    comp(&argv[optind], argc - optind);
+    comp(a, &argv[optind], argc - optind);
     return 0;
   }
 
   /* debug the first robot listed */
   if (debug_only) {
     /* trace only first source */
-    debug(argv[optind]);
+    debug(a, argv[optind]);
     return 0;
   }
 
   /* run a series of matches */
   if (matches != 0)
-    match(matches, limit, &argv[optind], argc - optind);
+    match(a, matches, limit, &argv[optind], argc - optind);
   else
-    play(&argv[optind], argc - optind);
+    play(a, &argv[optind], argc - optind);
 
   if (r_stats)
-    robot_stats();
+    robot_stats(a);
 
   return 0;
 }
 
 
 /* comp - only compile the files with full info */
-int comp(char *f[], int n)
+int comp(s_arena *a, char *f[], int n)
 {
+  s_compopt copt = { f_out, r_debug, g_config.max_instr, r_optimize,
+		     g_config.stack_size };
+  s_comp cc;
+  uint64_t key = 0;
   int num = 0;
+  int cached;
+  int error;
   char *s;
   int i;
 
@@ -339,36 +487,70 @@ int comp(char *f[], int n)
       continue;
     }
 
-    f_in = fopen(f[i], "r");
-    if (!f_in) {
-      warnx("robot '%s' not found, skipping ...", f[i]);
-      continue;
-    }
-
     s = strrchr(f[i],'/');
     if (s)
       s++;
     else
       s = f[i];
 
-    fprintf(f_out, "Compiling %-20s", s);
+    /* a policy robot, its channel made if need be */
+    if (policy_file(f[i])) {
+      fprintf(f_out, "Loading   %-20s (policy)\n", s);
+      error = !policy_load(&a->robots[num], f[i], g_config.stack_size);
+      goto loaded;
+    }
 
-    /* compile the robot */
-    r_flag = 0;
-    cur_robot = &robots[num];
+    f_in = fopen(f[i], "r");
+    if (!f_in) {
+      warnx("robot '%s' not found, skipping ...", f[i]);
+      continue;
+    }
 
-    init_comp();	/* initialize the compiler */
-    yyin = f_in;
-    yyparse();		/* start compiling */
-    yylex_destroy();
-    reset_comp();	/* reset compiler and complete robot */
-    fclose(f_in);
+    /* the listing of -c and -d needs the compiler */
+    cached = r_cache && !aot_file(f[i]);
+    if (cached)
+      key = cache_key(f_in, g_config.max_instr, r_optimize);
+
+    /* load a robot compiled by -C */
+    if (aot_file(f[i])) {
+      fclose(f_in);
+      fprintf(f_out, "Loading   %-20s\n", s);
+      error = !aot_load(&a->robots[num], f[i], g_config.stack_size);
+    } else if (cached && !r_debug && cache_load(&a->robots[num], r_cache, key, f_out,
+					     g_config.stack_size)) {
+      fclose(f_in);
+      fprintf(f_out, "Loading   %-20s (cached)\n", s);
+      error = 0;
+    } else {
+      fprintf(f_out, "Compiling %-20s", s);
+
+      /* compile the robot */
+      init_comp(&cc, &a->robots[num], f_in, &copt);
+      yyparse(cc.scanner, &cc);	/* start compiling */
+      reset_comp(&cc);	/* reset compiler and complete robot */
+      fclose(f_in);
+      error = cc.error;
+      if (!error)
+	optimize_comp(&cc);
+      if (!error && cached && !cache_save(a->robots[num].prog, r_cache, key,
+					  cc.undeclared, cc.postfix))
+	warnx("cannot cache robot '%s' in '%s'", s, r_cache);
+    }
 
-    /* check r_flag for compile errors */
-    if (r_flag) {
-      free_robot(num);
+    /* check for compile errors */
+  loaded:
+    if (error) {
+      free_robot(a, num);
     } else {
-      strcpy(robots[num].name, s);
+      link_code(a->robots[num].prog);
+      fuse_code(a->robots[num].prog, f_out);
+      verify_code(a->robots[num].prog, f_out);
+      thread_code();
+      if (aot_bind(a->robots[num].prog))
+	run = aot_burst;
+      else if (r_jit && !jit_compile(a->robots[num].prog))
+	warnx("no native code for robot '%s', interpreting ...", s);
+      strcpy(a->robots[num].name, s);
       num++;
     }
 
@@ -383,18 +565,18 @@ int comp(char *f[], int n)
 }
 
 /* prepare - prepare for battle */
-int prepare(char *f[], int n)
+int prepare(s_arena *a, char *f[], int n)
 {
   int num = 0;
 
-  num = comp(f, n);
+  num = comp(a, f, n);
   switch (num) {
   default:
     break;
 
   case 1:		   /* if only one robot, make it fight itself */
     warnx("only one robot, cloning another from %s.", f[0]);
-    clone_robot(0);
+    clone_robot(a, 0);
     num++;
     break;
 
@@ -407,7 +589,7 @@ int prepare(char *f[], int n)
 }
 
 /* play - watch the robots compete */
-void play(char *f[], int n)
+void play(s_arena *a, char *f[], int n)
 {
   int num_robots = 0;
   int robotsleft;
@@ -416,9 +598,9 @@ void play(char *f[], int n)
   int i, j, k;
   long c = 0L;
 
-  num_robots = prepare(f, n);
+  num_robots = prepare(a, f, n);
   for (i = 0; i < num_robots; i++)
-      robot_go(&robots[i]);
+      robot_go(&a->robots[i]);
 
   puts("\nStarting ...");
   if (r_interactive) {
@@ -431,53 +613,54 @@ void play(char *f[], int n)
   if (signal(SIGINT,SIG_IGN) != SIG_IGN)
     signal(SIGINT,catch_int);
 
-  rand_pos(num_robots);
+  rand_pos(a, num_robots);
+  a->show = robot_stat;
 
   /* Initialize snapshot if requested */
   if (r_snapshot) {
-    init_snapshot(f_snapshot);
+    init_snapshot(a, f_snapshot);
   }
 
   if (!r_snapshot) {
-    init_disp();
-    update_disp();
+    init_disp(a);
+    update_disp(a);
   }
   movement = MOTION_CYCLES;
-  display = g_config.snapshot_interval;
+  display = a->config.snapshot_interval;
   robotsleft = num_robots;
 
   /* multi-tasker; give each robot one cycle per loop */
   while (robotsleft > 1) {
     robotsleft = 0;
     for (i = 0; i < num_robots; i++) {
-      if (robots[i].status == ACTIVE) {
+      if (a->robots[i].status == ACTIVE) {
 	robotsleft++;
-        cur_robot = &robots[i];
+        a->cur_robot = &a->robots[i];
 	/* TODO simulate fixed virtual Mhz */
 	usleep(CYCLE_DELAY);
-	cycle();
+	run(a, 1);
       }
     }
 
     /* is it time to update motion? */
     if (--movement <= 0) {
       movement = MOTION_CYCLES;
-      move_robots(1);
-      move_miss(1);
+      move_robots(a, 1);
+      move_miss(a, 1);
     }
 
     /* is it time to update display */
     if (--display <= 0) {
-      display = g_config.snapshot_interval;
-      c += g_config.snapshot_interval;
+      display = a->config.snapshot_interval;
+      c += a->config.snapshot_interval;
 
       if (!r_snapshot) {
         show_cycle(c);
-        update_disp();
+        update_disp(a);
       }
 
       if (r_snapshot) {
-        output_snapshot(c);
+        output_snapshot(a, c);
       }
     }
   }
@@ -487,7 +670,7 @@ void play(char *f[], int n)
     k = 0;
     for (i = 0; i < num_robots; i++) {
       for (j = 0; j < MIS_ROBOT; j++) {
-	if (missiles[i][j].stat == FLYING)
+	if (a->missiles[i][j].stat == FLYING)
 	  k = 1;
       }
     }
@@ -495,16 +678,16 @@ void play(char *f[], int n)
     if (!k)
       break;
 
-    move_robots(1);
-    move_miss(1);
+    move_robots(a, 1);
+    move_miss(a, 1);
 
     if (!r_snapshot) {
-      update_disp();
+      update_disp(a);
     }
 
     if (r_snapshot) {
       c += MOTION_CYCLES;
-      output_snapshot(c);
+      output_snapshot(a, c);
     }
   }
 
@@ -513,323 +696,473 @@ void play(char *f[], int n)
   }
 
   if (r_snapshot) {
-    close_snapshot();
+    close_snapshot(a);
   }
 
   for (i = 0; i < MAXROBOTS; i++) {
-    if (robots[i].status == ACTIVE)
+    if (a->robots[i].status == ACTIVE)
       break;
   }
 
   if (i == MAXROBOTS)
     puts("\nIt's a draw");
   else
-    printf("\nThe winner is: %s (%d)\n", robots[i].name, i + 1);
+    printf("\nThe winner is: %s (%d)\n", a->robots[i].name, i + 1);
 }
 
 
-/* match - run a series of matches */
-void match(int m, long l, char *f[], int n)
+/* the outcome of one match, kept until its turn to be reported, so */
+/* output is in match order whatever the order the matches end in */
+typedef struct {
+  char *out;			/* match report, for stdout */
+  size_t out_len;
+  char *snap;			/* snapshots, for f_snapshot */
+  size_t snap_len;
+  int status[MAXROBOTS];	/* robots still active at the end */
+} s_result;
+
+/* match play, shared by the workers */
+typedef struct {
+  s_arena *arena;		/* one by worker */
+  s_result *result;		/* one by match */
+  int workers;
+  int num_robots;
+  long limit;			/* cycles per match */
+  s_arena *names;		/* the compiled robots, for their names */
+  int n;			/* robot files */
+  int wins[MAXROBOTS];
+  int ties[MAXROBOTS];
+} s_match;
+
+
+/* seed_match - the random numbers of match k: one stream for the match */
+/*              and one for each robot, all from the seed of the run */
+static void seed_match(s_arena *a, int k)
+{
+  uint64_t stream = (uint64_t) k * (MAXROBOTS + 1);
+  int i;
+
+  rng_seed(&a->rng, r_seed, stream);
+  for (i = 0; i < MAXROBOTS; i++)
+    rng_seed(&a->robots[i].rng, r_seed, stream + i + 1);
+}
+
+
+/* fork_arena - a copy of an arena with stacks and externals of its own, */
+/*              sharing the programs of the robots */
+static void fork_arena(s_arena *to, s_arena *a, int num_robots)
+{
+  int i;
+
+  *to = *a;
+  for (i = 0; i < num_robots; i++)
+    prog_share(&to->robots[i], &a->robots[i]);
+}
+
+
+/* free_arena - release what fork_arena() allocated */
+static void free_arena(s_arena *a, int num_robots)
+{
+  int i;
+
+  for (i = 0; i < num_robots; i++)
+    prog_detach(&a->robots[i]);
+}
+
+
+/* one_match - play a match, report to out and snapshots to snap, if any */
+static void one_match(s_arena *a, int m_count, int num_robots, long l,
+		      FILE *out, FILE *snap)
 {
-  int num_robots = 0;
   int robotsleft;
-  int m_count;
   int movement;
   int display;
   int i, j, k;
-  int wins[MAXROBOTS] = { 0 };
-  int ties[MAXROBOTS] = { 0 };
+  int burst_len, alive;
   long c;
 
-  f_out = fopen("/dev/null","w");
-  num_robots = prepare(f, n);
-  fclose(f_out);
-
-  puts("\nMatch play starting.");
-  if (r_interactive) {
-    fputs("Press <enter> to continue ...", stdout);
-    getchar();
-    fputs("\e[1A\e[K", stdout);
-  }
-
-  for (m_count = 1; m_count <= m; m_count++) {
-    /* Initialize snapshot if requested */
-    if (r_snapshot) {
-      if (m_count > 1) {
-        fprintf(f_snapshot, "\n\n");
-        fprintf(f_snapshot, "╔════════════════════════════════════════════════════╗\n");
-        fprintf(f_snapshot, "║              MATCH %6d                         ║\n", m_count);
-        fprintf(f_snapshot, "╚════════════════════════════════════════════════════╝\n");
-        fprintf(f_snapshot, "\n");
-      }
-      init_snapshot(f_snapshot);
+  /* Initialize snapshot if requested */
+  if (snap) {
+    if (m_count > r_first) {
+      fprintf(snap, "\n\n");
+      fprintf(snap, "╔════════════════════════════════════════════════════╗\n");
+      fprintf(snap, "║              MATCH %6d                         ║\n", m_count);
+      fprintf(snap, "╚════════════════════════════════════════════════════╝\n");
+      fprintf(snap, "\n");
     }
+    init_snapshot(a, snap);
+  }
 
-    printf("\nMatch %6d: ",m_count);
+  fprintf(out, "\nMatch %6d: ",m_count);
 
-    for (i = 0; i < num_robots; i++) {
-      init_robot(i);
-      robot_go(&robots[i]);
-      robots[i].status = ACTIVE;
-    }
+  for (i = 0; i < num_robots; i++) {
+    init_robot(a, i);
+    robot_go(&a->robots[i]);
+    a->robots[i].status = ACTIVE;
+  }
 
-    rand_pos(num_robots);
-    movement = MOTION_CYCLES;
-    display = g_config.snapshot_interval;  /* Snapshot display counter */
-    robotsleft = num_robots;
-    c = 0L;
-    while (robotsleft > 1 && c < l) {
-      robotsleft = 0;
+  rand_pos(a, num_robots);
+  movement = MOTION_CYCLES;
+  display = a->config.snapshot_interval;  /* Snapshot display counter */
+  robotsleft = num_robots;
+  c = 0L;
+  while (robotsleft > 1 && c < l) {
+    robotsleft = 0;
 
-      for (i = 0; i < num_robots; i++) {
-	if (robots[i].status == ACTIVE) {
-	  robotsleft++;
-	  cur_robot = &robots[i];
-	  cycle();
-	}
-      }
+    /* robots only see each other move at motion updates, so a burst */
+    /* that stops there finds the same world as single steps would */
+    burst_len = r_burst < movement ? r_burst : movement;
 
-      if (--movement == 0) {
-	c += MOTION_CYCLES;
-	movement = MOTION_CYCLES;
-	move_robots(0);
-	move_miss(0);
-
-	for (i = 0; i < num_robots; i++) {
-	  for (j = 0; j < MIS_ROBOT; j++) {
-	    if (missiles[i][j].stat == EXPLODING)
-	      count_miss(i,j);
-	  }
-	}
+    /* the match ends after a single cycle of the last robot standing */
+    if (burst_len > 1) {
+      for (alive = 0, i = 0; i < num_robots; i++)
+	alive += a->robots[i].status == ACTIVE;
+      if (alive < 2)
+	burst_len = 1;
+    }
 
-	/* Output snapshot every g_config.snapshot_interval */
-	if (r_snapshot) {
-	  display -= MOTION_CYCLES;
-	  if (display <= 0) {
-	    display = g_config.snapshot_interval;
-	    output_snapshot(c);
-	  }
-	}
+    for (i = 0; i < num_robots; i++) {
+      if (a->robots[i].status == ACTIVE) {
+	robotsleft++;
+	a->cur_robot = &a->robots[i];
+	run(a, burst_len);
       }
     }
 
-    /* allow any flying missiles to explode */
-    while (1) {
-      k = 0;
+    movement -= burst_len;
+    if (movement == 0) {
+      c += MOTION_CYCLES;
+      movement = MOTION_CYCLES;
+      move_robots(a, 0);
+      move_miss(a, 0);
+
       for (i = 0; i < num_robots; i++) {
 	for (j = 0; j < MIS_ROBOT; j++) {
-	  if (missiles[i][j].stat == FLYING) {
-	    k = 1;
-	  }
+	  if (a->missiles[i][j].stat == EXPLODING)
+	    count_miss(a, i,j);
 	}
       }
-      if (k) {
-	move_robots(0);
-	move_miss(0);
 
-	if (r_snapshot) {
-	  c += MOTION_CYCLES;
-	  output_snapshot(c);
+      /* Output snapshot every a->config.snapshot_interval */
+      if (snap) {
+	display -= MOTION_CYCLES;
+	if (display <= 0) {
+	  display = a->config.snapshot_interval;
+	  output_snapshot(a, c);
 	}
       }
-      else
-	break;
     }
+  }
 
-    if (r_snapshot) {
-      close_snapshot();
-    }
-
-    printf(" cycles = %ld:\n  Survivors:\n",c);
-
+  /* allow any flying missiles to explode */
+  while (1) {
     k = 0;
     for (i = 0; i < num_robots; i++) {
-      if (robots[i].status == ACTIVE) {
-	printf("   (%d)%14s: damage=%% %d  ",i+1,robots[i].name,
-		robots[i].damage);
-	if (i == 1)
-	  printf("\n");
-	else
-	  printf("\t");
-	k++;
+      for (j = 0; j < MIS_ROBOT; j++) {
+	if (a->missiles[i][j].stat == FLYING) {
+	  k = 1;
+	}
       }
     }
+    if (k) {
+      move_robots(a, 0);
+      move_miss(a, 0);
 
-    if (k == 0) {
-      puts("mutual destruction");
-    } else {
-      puts("");
+      if (snap) {
+	c += MOTION_CYCLES;
+	output_snapshot(a, c);
+      }
     }
+    else
+      break;
+  }
 
-    puts("  Cumulative score:");
-    for (i = 0; i < n; i++) {
-      if (robots[i].status == ACTIVE) {
-	if (k == 1)
-	  wins[i]++;
-	else
-	  ties[i]++;
-      }
-      printf("   (%d)%14s: wins=%d ties=%d  ",i+1,robots[i].name,
-	      wins[i],ties[i]);
+  if (snap) {
+    close_snapshot(a);
+  }
+
+  fprintf(out, " cycles = %ld:\n  Survivors:\n",c);
+
+  k = 0;
+  for (i = 0; i < num_robots; i++) {
+    if (a->robots[i].status == ACTIVE) {
+      fprintf(out, "   (%d)%14s: damage=%% %d  ",i+1,a->robots[i].name,
+	      a->robots[i].damage);
       if (i == 1)
-	printf("\n");
+	fprintf(out, "\n");
       else
-	printf("\t");
+	fprintf(out, "\t");
+      k++;
     }
-    printf("\n");
   }
 
-  puts("\nMatch play finished.\n");
+  if (k == 0) {
+    fputs("mutual destruction\n", out);
+  } else {
+    fputs("\n", out);
+  }
 }
 
 
-/* debug - compile and run the robot in debug mode */
-void debug(char *f)
+/* match_task - play match r_first + t on worker w */
+static void match_task(void *ctx, int w, int t)
 {
-  int c = 1; 
+  s_match *mp = ctx;
+  s_arena *a = &mp->arena[w];
+  s_result *res = &mp->result[t];
+  FILE *out = stdout, *snap = r_snapshot ? f_snapshot : NULL;
+  int i;
 
-  if (!comp(&f, 1))
-    exit(1);
+  /* buffer all output of a match played out of turn */
+  if (mp->workers > 1) {
+    out = open_memstream(&res->out, &res->out_len);
+    if (!out)
+      err(1, "Failed to buffer match %d", t + 1);
+    if (snap && !(snap = open_memstream(&res->snap, &res->snap_len)))
+      err(1, "Failed to buffer snapshots of match %d", t + 1);
+  }
 
-  robot_go(&robots[0]);
+  /* every match has its own random numbers, whichever worker plays it */
+  seed_match(a, r_first + t);
+  one_match(a, r_first + t, mp->num_robots, mp->limit, out, snap);
 
-  /* randomly place robot */
-  robots[0].x = rand() % MAX_X * 100;
-  robots[0].y = rand() % MAX_Y * 100;
+  for (i = 0; i < MAXROBOTS; i++)
+    res->status[i] = a->robots[i].status;
 
-  /* setup a dummy robot at the center */
-  robots[1].x = MAX_X / 2 * 100;
-  robots[1].y = MAX_Y / 2 * 100;
-  robots[1].status = ACTIVE;
+  if (mp->workers > 1) {
+    fclose(out);
+    if (snap)
+      fclose(snap);
+  }
+}
 
-  cur_robot = &robots[0];
 
-  puts("\nReady to debug, use `d' to dump robot info, `q' to quit.");
+/* match_done - report match r_first + t, and the cumulative score after it */
+static void match_done(void *ctx, int t)
+{
+  s_match *mp = ctx;
+  s_result *res = &mp->result[t];
+  int i, k;
 
-  while (c) {  
-    cycle();
+  if (res->out) {
+    fwrite(res->out, 1, res->out_len, stdout);
+    free(res->out);
+  }
+  if (res->snap) {
+    fwrite(res->snap, 1, res->snap_len, f_snapshot);
+    free(res->snap);
+  }
 
-    /* r_flag set by hitting 'q' in cycle()'s debug mode */
-    if (r_flag)
-      c = 0;
+  for (k = 0, i = 0; i < mp->num_robots; i++)
+    k += res->status[i] == ACTIVE;
 
-    move_robots(0);
-    move_miss(0);
+  puts("  Cumulative score:");
+  for (i = 0; i < mp->n; i++) {
+    if (res->status[i] == ACTIVE) {
+      if (k == 1)
+	mp->wins[i]++;
+      else
+	mp->ties[i]++;
+    }
+    printf("   (%d)%14s: wins=%d ties=%d  ",i+1,mp->names->robots[i].name,
+	    mp->wins[i],mp->ties[i]);
+    if (i == 1)
+      printf("\n");
+    else
+      printf("\t");
   }
+  printf("\n");
 }
 
 
-/* rand_pos - randomize the starting robot postions */
-/*           dependent on MAXROBOTS <= 4 */
-/*            put robots in separate quadrant */
-void rand_pos(int n)
+/* match - run a series of matches */
+void match(s_arena *a, int m, long l, char *f[], int n)
 {
-  int i, k;
-  int quad[4];
+  s_match mp;
+  int w;
+
+  f_out = fopen("/dev/null","w");
+  mp.num_robots = prepare(a, f, n);
+  fclose(f_out);
 
-  for (i = 0; i < 4; i++) {
-    quad[i] = 0;
+  printf("\nMatch play starting, seed %llu.\n", (unsigned long long) r_seed);
+  if (r_interactive) {
+    fputs("Press <enter> to continue ...", stdout);
+    getchar();
+    fputs("\e[1A\e[K", stdout);
   }
 
-  /* get a new quadrant */
-  for (i = 0; i < n; i++) {
-    k = rand() % 4;
-    if (quad[k] == 0)
-      quad[k] = 1;
-    else {
-      while (quad[k] != 0) {
-	if (++k == 4)
-	  k = 0;
-      }
-      quad[k] = 1;
-    }
-    robots[i].org_x = robots[i].x =
-       (rand() % (MAX_X * CLICK / 2)) + ((MAX_X * CLICK / 2) * (k%2));
-    robots[i].org_y = robots[i].y =
-       (rand() % (MAX_Y * CLICK / 2)) + ((MAX_Y * CLICK / 2) * (k<2));
+  mp.workers = r_workers < m ? r_workers : m;
+  mp.limit = l;
+  mp.names = a;
+  mp.n = n;
+  memset(mp.wins, 0, sizeof(mp.wins));
+  memset(mp.ties, 0, sizeof(mp.ties));
+  mp.result = calloc(m, sizeof(s_result));
+
+  /* a single worker plays in place, more get arenas of their own */
+  if (mp.workers <= 1) {
+    mp.workers = 1;
+    mp.arena = a;
+  } else {
+    mp.arena = calloc(mp.workers, sizeof(s_arena));
+    for (w = 0; w < mp.workers; w++)
+      fork_arena(&mp.arena[w], a, mp.num_robots);
+  }
+
+  pool_run(mp.workers, m, match_task, match_done, &mp);
+
+  if (mp.arena != a) {
+    for (w = 0; w < mp.workers; w++)
+      free_arena(&mp.arena[w], mp.num_robots);
+    free(mp.arena);
   }
+  free(mp.result);
+
+  puts("\nMatch play finished.\n");
 }
 
 
-/* init a robot */
-void init_robot(int i)
+/* dump - show the variables and state of the robot being debugged */
+static void dump(s_arena *a)
 {
-  register int j;
-
-  robots[i].status = DEAD;
-  robots[i].x = 0;
-  robots[i].y = 0;
-  robots[i].org_x = 0;
-  robots[i].org_y = 0;
-  robots[i].range = 0;
-  robots[i].last_x = -1;
-  robots[i].last_y = -1;
-  robots[i].speed = 0;
-  robots[i].last_speed = -1;
-  robots[i].accel = 0;
-  robots[i].d_speed = 0;
-  robots[i].heading = 0;
-  robots[i].last_heading = -1;
-  robots[i].d_heading = 0;
-  robots[i].damage = 0;
-  robots[i].last_damage = -1;
-  robots[i].scan = 0;
-  robots[i].last_scan = -1;
-  robots[i].reload = 0;
-  for (j = 0; j < MIS_ROBOT; j++) {
-    missiles[i][j].stat = AVAIL;
-    missiles[i][j].last_xx = -1;
-    missiles[i][j].last_yy = -1;
-  }
-  robots[i].action_buffer.count = 0;
+  s_robot *cur_robot = a->cur_robot;
+  s_missile *m = a->missiles[cur_robot - &a->robots[0]];
+
+  printf("\nexternals");
+  dumpvar(cur_robot->external,cur_robot->prog->ext_count);
+  printf("\nlocal stack");
+  dumpvar(cur_robot->local,cur_robot->stackptr - cur_robot->local + 1);
+  printf("\n\nx...........%7d",cur_robot->x);
+  printf("\ty...........%7d",cur_robot->y);
+  printf("\norg_x.......%7d",cur_robot->org_x);
+  printf("\torg_y.......%7d",cur_robot->org_y);
+  printf("\nrange.......%7d",cur_robot->range);
+  printf("\tspeed.......%7d",cur_robot->speed);
+  printf("\nd_speed.....%7d",cur_robot->d_speed);
+  printf("\theading.....%7d",cur_robot->heading);
+  printf("\nd_heading...%7d",cur_robot->d_heading);
+  printf("\tdamage......%7d",cur_robot->damage);
+  printf("\nmiss[0]stat.%7d",m[0].stat);
+  printf("\tmiss[1]stat.%7d",m[1].stat);
+  printf("\nmiss[0]head.%7d",m[0].head);
+  printf("\tmiss[1]head.%7d",m[1].head);
+  printf("\nmiss[0]x....%7d",m[0].cur_x);
+  printf("\tmiss[1]y....%7d",m[1].cur_y);
+  printf("\nmiss[0]dist.%7d",m[0].curr_dist);
+  printf("\tmiss[1]dist.%7d",m[1].curr_dist);
+  printf("\n\n");
 }
 
 
-/* clone_robot - create a clone when there is only one */
-void clone_robot(int i)
+/* debug - compile and run the robot in debug mode */
+/* single steps with trace_cycle(), or runs untraced up to a breakpoint */
+void debug(s_arena *a, char *f)
 {
-  if (i + 1 >= MAXROBOTS)
-    errx(1, "Robot overflow\n");
+  s_robot *r;
+  char line[80];
+  char *brk;
+  long n;
+  int len, step = 1;
 
-  robots[i + 1] = robots[i];
-  robots[i + 1].external = (long *) malloc(robots[i].ext_count * sizeof(long));
-  robots[i + 1].stackbase = (long *) malloc(DATASPACE * sizeof(long));
-  robots[i + 1].stackend = robots[i + 1].stackbase + DATASPACE;
-}
+  if (!comp(a, &f, 1))
+    exit(1);
 
+  r = &a->robots[0];
+  robot_go(r);
 
-/* free_robot - frees any allocated storage in a robot */
-void free_robot(int i) 
-{
-  s_func *temp;
+  /* randomly place robot */
+  r->x = rng_rand(&a->rng) % MAX_X(a) * 100;
+  r->y = rng_rand(&a->rng) % MAX_Y(a) * 100;
+
+  /* setup a dummy robot at the center */
+  a->robots[1].x = MAX_X(a) / 2 * 100;
+  a->robots[1].y = MAX_Y(a) / 2 * 100;
+  a->robots[1].status = ACTIVE;
 
-  if (robots[i].funcs)
-    free(robots[i].funcs);
+  a->cur_robot = r;
 
-  if (robots[i].code)
-    free(robots[i].code);
+  for (len = 0; r->prog->code[len].ins_type != NOP; len++)
+    ;
+  brk = calloc(len + 1, 1);
 
-  if (robots[i].external)
-    free(robots[i].external);
+  puts("\nReady to debug, use `d' to dump robot info, `b N' to set or clear a"
+       "\nbreakpoint at instruction N, `c' to continue to one, `q' to quit.");
 
-  if (robots[i].stackbase)
-    free(robots[i].stackbase);
+  for (;;) {
+    if (!step && r->stall == 0 && brk[r->ip - r->prog->code]) {
+      printf("\nbreakpoint at %ld\n", (long) (r->ip - r->prog->code));
+      step = 1;
+    }
+
+    if (!step) {
+      cycle(a);
+    } else {
+      trace_cycle(a);
+      printf("\t\t\t\ttos %ld: * %ld\n",
+	     (long)r->stackptr,*r->stackptr);
+
+      for (;;) {
+	printf("d,h,b,c,q,<cr>: ");
+	if (!fgets(line, sizeof(line), stdin) || line[0] == 'q') {
+	  free(brk);
+	  return;
+	}
+	if (line[0] == 'd') {
+	  dump(a);
+	  continue;
+	}
+	if (line[0] == 'b') {
+	  n = strtol(line + 1, NULL, 10);
+	  if (n < 0 || n >= len) {
+	    printf("no instruction %ld\n", n);
+	  } else {
+	    brk[n] = !brk[n];
+	    printf("breakpoint at %ld %s\n", n, brk[n] ? "set" : "cleared");
+	  }
+	  continue;
+	}
+	if (line[0] == 'h')		/* induce damage */
+	  r->damage += 10;
+	else if (line[0] == 'c')
+	  step = 0;
+	break;
+      }
+    }
 
-  while (robots[i].code_list) {
-    temp = robots[i].code_list;
-    robots[i].code_list = temp->nextfunc;
-    free(temp);
+    move_robots(a, 0);
+    move_miss(a, 0);
   }
 }
 
 
+/* clone_robot - create a clone when there is only one */
+void clone_robot(s_arena *a, int i)
+{
+  if (i + 1 >= MAXROBOTS)
+    errx(1, "Robot overflow\n");
+
+  a->robots[i + 1] = a->robots[i];
+  prog_share(&a->robots[i + 1], &a->robots[i]);
+}
+
+
+/* free_robot - frees any allocated storage in a robot, and its program */
+/*              unless other robots still run it */
+void free_robot(s_arena *a, int i)
+{
+  prog_detach(&a->robots[i]);
+}
+
+
 /* robot_stats - dump robot stats, optionally showed at exit */
-void robot_stats(void)
+void robot_stats(s_arena *a)
 {
+  s_robot *cur_robot;
   int i;
 
   for (i = 0; i < MAXROBOTS; i++) {
-    cur_robot = &robots[i];
+    cur_robot = &a->robots[i];
     printf("\nrobot: %d",i);
     printf("\tstatus......%d",cur_robot->status);
     printf("\nx...........%5d",cur_robot->x);
@@ -842,14 +1175,14 @@ void robot_stats(void)
     printf("\theading.....%5d",cur_robot->heading);
     printf("\nd_heading...%5d",cur_robot->d_heading);
     printf("\tdamage......%5d",cur_robot->damage);
-    printf("\nmiss[0]stat.%5d",missiles[cur_robot-&robots[0]][0].stat);
-    printf("\tmiss[1]stat.%5d",missiles[cur_robot-&robots[0]][1].stat);
-    printf("\nmiss[0]head.%5d",missiles[cur_robot-&robots[0]][0].head);
-    printf("\tmiss[1]head.%5d",missiles[cur_robot-&robots[0]][1].head);
-    printf("\nmiss[0]x....%5d",missiles[cur_robot-&robots[0]][0].cur_x);
-    printf("\tmiss[1]y....%5d",missiles[cur_robot-&robots[0]][1].cur_y);
-    printf("\nmiss[0]dist.%5d",missiles[cur_robot-&robots[0]][0].curr_dist);
-    printf("\tmiss[1]dist.%5d",missiles[cur_robot-&robots[0]][1].curr_dist);
+    printf("\nmiss[0]stat.%5d",a->missiles[cur_robot-a->robots][0].stat);
+    printf("\tmiss[1]stat.%5d",a->missiles[cur_robot-a->robots][1].stat);
+    printf("\nmiss[0]head.%5d",a->missiles[cur_robot-a->robots][0].head);
+    printf("\tmiss[1]head.%5d",a->missiles[cur_robot-a->robots][1].head);
+    printf("\nmiss[0]x....%5d",a->missiles[cur_robot-a->robots][0].cur_x);
+    printf("\tmiss[1]y....%5d",a->missiles[cur_robot-a->robots][1].cur_y);
+    printf("\nmiss[0]dist.%5d",a->missiles[cur_robot-a->robots][0].curr_dist);
+    printf("\tmiss[1]dist.%5d",a->missiles[cur_robot-a->robots][1].curr_dist);
     printf("\n\n");
   }
 }
@@ -864,7 +1197,7 @@ void catch_int(int signo)
 
   warnx("Aborted.");
   if (r_stats)
-    robot_stats();
+    robot_stats(&arena);
 
   exit(0);
 }
@@ -20,24 +20,23 @@
 #include <math.h>
 #include "crobots.h"
 #include "motion.h"
-#include "screen.h"
+#include "rng.h"
 
 /* define long absolute value function */
 #define labs(l) ((long) l < 0L ? -l : l)
 
-/* External damage tracker */
-extern s_damage_tracker damage_tracker;
-
-void reset_damage_tracker(void) {
-    damage_tracker.count = 0;
+void reset_damage_tracker(s_arena *a) {
+    a->damage_tracker.count = 0;
 }
 
-static void log_damage(int victim, int attacker, int amount) {
-    if (g_config.log_rewards && damage_tracker.count < MAX_DAMAGE_EVENTS) {
-        damage_tracker.events[damage_tracker.count].victim = victim;
-        damage_tracker.events[damage_tracker.count].attacker = attacker;
-        damage_tracker.events[damage_tracker.count].amount = amount;
-        damage_tracker.count++;
+static void log_damage(s_arena *a, int victim, int attacker, int amount) {
+    s_damage_tracker *t = &a->damage_tracker;
+
+    if (a->config.log_rewards && t->count < MAX_DAMAGE_EVENTS) {
+        t->events[t->count].victim = victim;
+        t->events[t->count].attacker = attacker;
+        t->events[t->count].amount = amount;
+        t->count++;
     }
 }
 
@@ -200,8 +199,9 @@ struct {
 /* move_robots - update the postion of all robots */
 /*               parm 'displ' controls call to field display */
 
-void move_robots(int displ)
+void move_robots(s_arena *a, int displ)
 {
+  register s_robot *robots = a->robots;
   register int i, n;
   long lsin(), lcos();
 
@@ -213,8 +213,8 @@ void move_robots(int displ)
     if (robots[i].damage >= 100) {
       robots[i].damage = 100;
       robots[i].status = DEAD;
-      if (displ)
-	robot_stat(i);
+      if (displ && a->show)
+	a->show(a, i);
     }
 
     /* update cannon reloader */
@@ -268,12 +268,12 @@ void move_robots(int displ)
 	  robots[i].speed = 0;
 	  robots[i].d_speed = 0;
 	  robots[i].damage += COLLISION;
-	  log_damage(i, -1, COLLISION);  /* -1 = collision/wall */
+	  log_damage(a, i, -1, COLLISION);  /* -1 = collision/wall */
 	  /* ...and colliding robot */
 	  robots[n].speed = 0;
 	  robots[n].d_speed = 0;
 	  robots[n].damage += COLLISION;
-	  log_damage(n, -1, COLLISION);  /* -1 = collision/wall */
+	  log_damage(a, n, -1, COLLISION);  /* -1 = collision/wall */
 	}
       }
 
@@ -283,14 +283,14 @@ void move_robots(int displ)
 	robots[i].speed = 0;
 	robots[i].d_speed = 0;
 	robots[i].damage += COLLISION;
-	log_damage(i, -1, COLLISION);
+	log_damage(a, i, -1, COLLISION);
       } else {
-	if (robots[i].x > MAX_X * CLICK) {
-	  robots[i].x = (MAX_X * CLICK) - 1;
+	if (robots[i].x > MAX_X(a) * CLICK) {
+	  robots[i].x = (MAX_X(a) * CLICK) - 1;
 	  robots[i].speed = 0;
 	  robots[i].d_speed = 0;
 	  robots[i].damage += COLLISION;
-	  log_damage(i, -1, COLLISION);
+	  log_damage(a, i, -1, COLLISION);
 	}
       }
       if (robots[i].y < 0) {
@@ -298,14 +298,14 @@ void move_robots(int displ)
 	robots[i].speed = 0;
 	robots[i].d_speed = 0;
 	robots[i].damage += COLLISION;
-	log_damage(i, -1, COLLISION);
+	log_damage(a, i, -1, COLLISION);
       } else {
-	if (robots[i].y > MAX_Y * CLICK) {
-	  robots[i].y = (MAX_Y * CLICK) - 1;
+	if (robots[i].y > MAX_Y(a) * CLICK) {
+	  robots[i].y = (MAX_Y(a) * CLICK) - 1;
 	  robots[i].speed = 0;
 	  robots[i].d_speed = 0;
 	  robots[i].damage += COLLISION;
-	  log_damage(i, -1, COLLISION);
+	  log_damage(a, i, -1, COLLISION);
 	}
       }
     }
@@ -317,8 +317,10 @@ void move_robots(int displ)
 /* move_miss - updates all missile positions */
 /*             parm 'displ' control display */
 
-void move_miss(int displ)
+void move_miss(s_arena *a, int displ)
 {
+  register s_robot *robots = a->robots;
+  s_missile (*missiles)[MIS_ROBOT] = a->missiles;
   register int r, i;
   int n, j;
   int d, x, y;
@@ -328,8 +330,8 @@ void move_miss(int displ)
     if (robots[r].damage >= 100) {
       robots[r].damage = 100;
       robots[r].status = DEAD;
-      if (displ)
-	robot_stat(r);
+      if (displ && a->show)
+	a->show(a, r);
     }
 
     /* update flying missiles, even ones fired by dead robots before they died*/
@@ -354,17 +356,17 @@ void move_miss(int displ)
 	  missiles[r][i].stat = EXPLODING;
 	  x = 1;
 	}
-	if (x >= MAX_X * CLICK) {
+	if (x >= MAX_X(a) * CLICK) {
 	  missiles[r][i].stat = EXPLODING;
-	  x = (MAX_X * CLICK) -1;
+	  x = (MAX_X(a) * CLICK) -1;
 	}
 	if (y < 0 ) {
 	  missiles[r][i].stat = EXPLODING;
 	  y = 1;
 	}
-	if (y > MAX_Y * CLICK) {
+	if (y > MAX_Y(a) * CLICK) {
 	  missiles[r][i].stat = EXPLODING;
-	  y = (MAX_Y * CLICK) -1;
+	  y = (MAX_Y(a) * CLICK) -1;
 	}
 
 	/* check for missiles reaching target range */
@@ -385,7 +387,7 @@ void move_miss(int displ)
 	    for (j = 0; j < 3; j++) {
 	      if (d < exp_dam[j].dist) {
 		robots[n].damage += exp_dam[j].dam;
-		log_damage(n, r, exp_dam[j].dam);  /* r = missile owner */
+		log_damage(a, n, r, exp_dam[j].dam);  /* r = missile owner */
 		break;
 	      }
 	    }
@@ -393,8 +395,8 @@ void move_miss(int displ)
             if (robots[n].damage >= 100) {
 	      robots[n].damage = 100;
 	      robots[n].status = DEAD;
-	      if (displ)
-		robot_stat(n);
+	      if (displ && a->show)
+		a->show(a, n);
 	    }
 	  }
 	}
@@ -403,6 +405,85 @@ void move_miss(int displ)
   }
 }
 
+
+/* count_miss - update the explosion counter */
+
+void count_miss(s_arena *a, int i, int j)
+{
+  if (a->missiles[i][j].count <= 0)
+    a->missiles[i][j].stat = AVAIL;
+  else
+    a->missiles[i][j].count--;
+}
+
+
+/* rand_pos - randomize the starting robot postions */
+/*           dependent on MAXROBOTS <= 4 */
+/*            put robots in separate quadrant */
+void rand_pos(s_arena *a, int n)
+{
+  int i, k;
+  int quad[4];
+
+  for (i = 0; i < 4; i++) {
+    quad[i] = 0;
+  }
+
+  /* get a new quadrant */
+  for (i = 0; i < n; i++) {
+    k = rng_rand(&a->rng) % 4;
+    if (quad[k] == 0)
+      quad[k] = 1;
+    else {
+      while (quad[k] != 0) {
+	if (++k == 4)
+	  k = 0;
+      }
+      quad[k] = 1;
+    }
+    a->robots[i].org_x = a->robots[i].x =
+       (rng_rand(&a->rng) % (MAX_X(a) * CLICK / 2)) + ((MAX_X(a) * CLICK / 2) * (k%2));
+    a->robots[i].org_y = a->robots[i].y =
+       (rng_rand(&a->rng) % (MAX_Y(a) * CLICK / 2)) + ((MAX_Y(a) * CLICK / 2) * (k<2));
+  }
+}
+
+
+/* init a robot */
+void init_robot(s_arena *a, int i)
+{
+  register int j;
+
+  a->robots[i].status = DEAD;
+  a->robots[i].x = 0;
+  a->robots[i].y = 0;
+  a->robots[i].org_x = 0;
+  a->robots[i].org_y = 0;
+  a->robots[i].range = 0;
+  a->robots[i].last_x = -1;
+  a->robots[i].last_y = -1;
+  a->robots[i].speed = 0;
+  a->robots[i].last_speed = -1;
+  a->robots[i].accel = 0;
+  a->robots[i].d_speed = 0;
+  a->robots[i].heading = 0;
+  a->robots[i].last_heading = -1;
+  a->robots[i].d_heading = 0;
+  a->robots[i].damage = 0;
+  a->robots[i].last_damage = -1;
+  a->robots[i].scan = 0;
+  a->robots[i].last_scan = -1;
+  a->robots[i].reload = 0;
+  a->robots[i].stall = 0;
+  a->robots[i].clock = 0;
+  for (j = 0; j < MIS_ROBOT; j++) {
+    a->missiles[i][j].stat = AVAIL;
+    a->missiles[i][j].last_xx = -1;
+    a->missiles[i][j].last_yy = -1;
+  }
+  a->robots[i].action_buffer.count = 0;
+}
+
 /**
  * Local Variables:
  *  indent-tabs-mode: nil
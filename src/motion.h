@@ -19,11 +19,17 @@
 #ifndef CROBOTS_MOTION_H_
 #define CROBOTS_MOTION_H_
 
+#include "crobots.h"
+
 /* sin look up */
 long lsin(int deg);
 
-void move_robots(int displ);
-void move_miss(int displ);
+void move_robots(s_arena *a, int displ);
+void move_miss(s_arena *a, int displ);
+void count_miss(s_arena *a, int i, int j);
+
+void init_robot(s_arena *a, int i);
+void rand_pos(s_arena *a, int n);
 
 #endif /* CROBOTS_MOTION_H_ */
 
@@ -0,0 +1,429 @@
+/* policy.c - robots driven by an external policy over shared memory
+ *
+ * Copyright (C) 2026 The CROW authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * A policy robot has no source.  policy_load() gives it a program of
+ * its own, the one the compiler would make of
+ *
+ *	main() { while (1) policy(); }
+ *
+ * where policy() is c_policy(), an intrinsic robots cannot name.  So the
+ * robot is scheduled, traced, burst and run as native code like any
+ * other, and takes cycles like any other.  c_policy() counts them, and
+ * once a decision interval (-p) has gone by, posts the battlefield up
+ * the lane of the robot and waits for the action coming down, see the
+ * layout of the channel in crow.h.  Waiting spins a while, then yields,
+ * then naps; a policy silent for POLICY_TIMEOUT seconds is given up,
+ * and its robot stands still from then on.
+ */
+
+#include "config.h"
+
+#include <err.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#include "crobots.h"
+#include "compiler.h"
+#include "cpu.h"
+#include "library.h"
+#include "policy.h"
+#include "program.h"
+#include "symtab.h"
+
+#define POLICY_LOOP    6	/* cycles of one turn of the loop of main() */
+#define POLICY_SPIN    2000	/* checks before yielding */
+#define POLICY_YIELD   2000	/* yields before napping */
+#define POLICY_NAP     50000L	/* nanoseconds of a nap */
+#define POLICY_TIMEOUT 30	/* seconds without an answer before giving up */
+
+/* a channel, shared by the robots running its program */
+struct policy {
+  crow_channel_t *ch;		/* mapped from the file */
+  char taken[CROW_LANES];	/* lanes of robots, see policy_attach() */
+};
+
+/* the lane of one robot */
+struct lane {
+  struct policy *policy;
+  int index;			/* in the channel */
+  int step;			/* decisions in the match */
+  int scan, fired;		/* results of the last action */
+  int silent;			/* the policy stopped answering */
+};
+
+
+/* policy_file - check whether a robot file names a policy channel */
+int policy_file(char *f)
+{
+  size_t len = strlen(f);
+
+  return (len > 4 && strcmp(f + len - 4, ".shm") == 0);
+}
+
+
+/* observe_arena - the robots and missiles of an arena, those of the */
+/*                 robots loaded; cycle, done and match left 0 */
+void observe_arena(const s_arena *a, crow_obs_t *obs)
+{
+  const s_robot *r;
+  const s_missile *m;
+  int i, j;
+
+  memset(obs, 0, sizeof(*obs));
+  for (i = 0; i < MAXROBOTS && a->robots[i].prog; i++) {
+    r = &a->robots[i];
+    obs->robots++;
+    obs->alive += r->status == ACTIVE;
+    obs->robot[i].status = r->status == ACTIVE;
+    obs->robot[i].x = r->x;
+    obs->robot[i].y = r->y;
+    obs->robot[i].heading = r->heading;
+    obs->robot[i].d_heading = r->d_heading;
+    obs->robot[i].speed = r->speed;
+    obs->robot[i].d_speed = r->d_speed;
+    obs->robot[i].damage = r->damage;
+    obs->robot[i].scan = r->scan;
+    obs->robot[i].reload = r->reload;
+
+    for (j = 0; j < MIS_ROBOT; j++) {
+      m = &a->missiles[i][j];
+      obs->missile[i][j].stat = m->stat;
+      obs->missile[i][j].x = m->cur_x;
+      obs->missile[i][j].y = m->cur_y;
+      obs->missile[i][j].heading = m->head;
+      obs->missile[i][j].range = m->rang;
+      obs->missile[i][j].dist = m->curr_dist;
+    }
+  }
+}
+
+
+#ifdef HAVE_SYS_MMAN_H
+
+/* channel - map the channel of a file, setting it up if new; NULL on */
+/*           failure */
+static crow_channel_t *channel(char *f)
+{
+  crow_channel_t *ch;
+  struct stat st;
+  int fd;
+
+  fd = open(f, O_RDWR | O_CREAT, 0600);
+  if (fd < 0) {
+    warn("cannot open policy channel '%s'", f);
+    return (NULL);
+  }
+  if (fstat(fd, &st) < 0 ||
+      (st.st_size < (off_t) sizeof(crow_channel_t) &&
+       ftruncate(fd, sizeof(crow_channel_t)) < 0)) {
+    warn("cannot size policy channel '%s'", f);
+    close(fd);
+    return (NULL);
+  }
+
+  ch = mmap(NULL, sizeof(crow_channel_t), PROT_READ | PROT_WRITE, MAP_SHARED,
+	    fd, 0);
+  close(fd);
+  if (ch == MAP_FAILED) {
+    warn("cannot map policy channel '%s'", f);
+    return (NULL);
+  }
+
+  if (__atomic_load_n(&ch->magic, __ATOMIC_ACQUIRE) == 0) {
+    ch->version = CROW_VERSION;
+    ch->lanes = CROW_LANES;
+    ch->slots = CROW_SLOTS;
+    __atomic_store_n(&ch->magic, CROW_MAGIC, __ATOMIC_RELEASE);
+  }
+  if (ch->magic != CROW_MAGIC || ch->version != CROW_VERSION ||
+      ch->lanes != CROW_LANES || ch->slots != CROW_SLOTS) {
+    warnx("'%s' is not a policy channel of this version of crobots", f);
+    munmap(ch, sizeof(crow_channel_t));
+    return (NULL);
+  }
+
+  return (ch);
+}
+
+
+/* policy_load - set up a robot driven by the policy of a channel file, */
+/*               in place of init_comp() and the parser, with a stack */
+/*               of 'stack'; 0 on failure */
+int policy_load(s_robot *r, char *f, int stack)
+{
+  static const struct {
+    int type, arg;
+  } loop[POLICY_LOOP] = {
+    { CONST,  0 },		/* the value a call replaces */
+    { FRAME,  0 },
+    { ICALL,  I_POLICY },
+    { CHOP,   0 },
+    { CONST,  0 },		/* while (1) */
+    { BRANCH, -5 }
+  };
+  crow_channel_t *ch;
+  s_program *p;
+  s_func *fn;
+  int i;
+
+  ch = channel(f);
+  if (!ch)
+    return (0);
+
+  p = prog_new();
+  p->code = calloc(POLICY_LOOP + 1, sizeof(s_instr));
+  p->pool = malloc(sizeof(long));
+  p->pool_count = 0;
+  add_const(p, 0L);
+  for (i = 0; i < POLICY_LOOP; i++) {
+    p->code[i].ins_type = loop[i].type;
+    p->code[i].arg = loop[i].arg;
+  }
+  p->code[POLICY_LOOP].ins_type = NOP;
+
+  fn = malloc(sizeof(s_func) + sizeof("main"));
+  fn->nextfunc = NULL;
+  fn->first = p->code;
+  fn->var_count = 0;
+  fn->par_count = 0;
+  strcpy(fn->func_name, "main");
+  p->code_list = fn;
+  p->funcs = sym_new();
+  sym_add(p->funcs, "main");
+
+  p->policy = calloc(1, sizeof(struct policy));
+  p->policy->ch = ch;
+  prog_attach(r, p, stack);
+
+  return (1);
+}
+
+
+/* policy_free - release the channel of a program */
+void policy_free(s_program *p)
+{
+  if (!p->policy)
+    return;
+
+  munmap(p->policy->ch, sizeof(crow_channel_t));
+  free(p->policy);
+  p->policy = NULL;
+}
+
+#else
+
+int policy_load(s_robot *r, char *f, int stack)
+{
+  (void)r;
+  (void)stack;
+  warnx("cannot map '%s', no shared memory on this system", f);
+  return (0);
+}
+
+void policy_free(s_program *p)
+{
+  (void)p;
+}
+
+#endif /* HAVE_SYS_MMAN_H */
+
+
+/* policy_attach - give a new robot of a policy the first free lane, */
+/*                 or none if all are taken, see prog_attach() */
+void policy_attach(s_robot *r)
+{
+  struct policy *p = r->prog->policy;
+  struct lane *l;
+  int i;
+
+  r->lane = NULL;
+  if (!p)
+    return;
+
+  for (i = 0; i < CROW_LANES; i++) {
+    if (!__atomic_exchange_n(&p->taken[i], 1, __ATOMIC_ACQ_REL))
+      break;
+  }
+  if (i == CROW_LANES) {
+    warnx("all %d lanes of the policy taken, robot stands still", CROW_LANES);
+    return;
+  }
+
+  l = calloc(1, sizeof(struct lane));
+  l->policy = p;
+  l->index = i;
+  r->lane = l;
+}
+
+
+/* policy_detach - give the lane of a robot back, see prog_detach() */
+void policy_detach(s_robot *r)
+{
+  struct lane *l = r->lane;
+
+  if (!l)
+    return;
+
+  __atomic_store_n(&l->policy->taken[l->index], 0, __ATOMIC_RELEASE);
+  free(l);
+  r->lane = NULL;
+}
+
+
+/* policy_state - what the lane of a robot knows of its decisions, */
+/*                for saving the robot: step, scan and shot */
+void policy_state(const s_robot *r, int st[3])
+{
+  const struct lane *l = r->lane;
+
+  st[0] = l ? l->step : 0;
+  st[1] = l ? l->scan : 0;
+  st[2] = l ? l->fired : 0;
+}
+
+
+/* policy_restore - set what policy_state() saved */
+void policy_restore(s_robot *r, const int st[3])
+{
+  struct lane *l = r->lane;
+
+  if (!l)
+    return;
+
+  l->step = st[0];
+  l->scan = st[1];
+  l->fired = st[2];
+}
+
+
+/* await - wait until the other side changes an index from v, first */
+/*         spinning, then yielding, then napping; 0 on timeout */
+static int await(volatile uint32_t *p, uint32_t v)
+{
+  struct timespec nap = { 0, POLICY_NAP };
+  struct timespec start, now;
+  long n;
+
+  for (n = 0; __atomic_load_n(p, __ATOMIC_ACQUIRE) == v; n++) {
+    if (n < POLICY_SPIN)
+      continue;
+    if (n < POLICY_SPIN + POLICY_YIELD) {
+      sched_yield();
+      continue;
+    }
+
+    if (n == POLICY_SPIN + POLICY_YIELD)
+      clock_gettime(CLOCK_MONOTONIC, &start);
+    nanosleep(&nap, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (now.tv_sec - start.tv_sec >= POLICY_TIMEOUT)
+      return (0);
+  }
+  return (1);
+}
+
+
+/* exchange - post a decision up a lane and take the action answering */
+/*            it; 0 if the policy does not answer */
+static int exchange(crow_lane_t *s, crow_decision_t *d, crow_action_t *act)
+{
+  uint32_t head = s->up.head;
+  uint32_t tail;
+
+  /* the policy may still be reading old decisions */
+  while (head - __atomic_load_n(&s->up.tail, __ATOMIC_ACQUIRE) >= CROW_SLOTS) {
+    if (!await(&s->up.tail, head - CROW_SLOTS))
+      return (0);
+  }
+  d->seq = head + 1;
+  s->decision[head % CROW_SLOTS] = *d;
+  __atomic_store_n(&s->up.head, head + 1, __ATOMIC_RELEASE);
+
+  /* actions to older decisions, say of an earlier run, are dropped */
+  for (tail = s->down.tail; ; tail++) {
+    if (!await(&s->down.head, tail))
+      return (0);
+    *act = s->action[tail % CROW_SLOTS];
+    __atomic_store_n(&s->down.tail, tail + 1, __ATOMIC_RELEASE);
+    if (act->seq == d->seq)
+      return (1);
+  }
+}
+
+
+/* call - call an intrinsic of the library for the current robot */
+static long call(s_arena *a, void (*f)(s_arena *a), long x, long y)
+{
+  push(a, x);
+  push(a, y);
+  (*f)(a);
+  return (pop(a));
+}
+
+
+/* c_policy - the only thing a policy robot does: once a decision is */
+/*            due, ask the policy and carry out its action */
+void c_policy(s_arena *a)
+{
+  s_robot *r = a->cur_robot;
+  struct lane *l = r->lane;
+  long last = r->clock;
+  crow_decision_t d;
+  crow_action_t act;
+
+  r->clock += POLICY_LOOP;
+  if (!l || l->silent ||
+      (last && last / a->config.decide == r->clock / a->config.decide)) {
+    push(a, 0L);
+    return;
+  }
+
+  if (!last)			/* a new match */
+    l->step = l->scan = l->fired = 0;
+
+  d.self = r - a->robots;
+  d.step = l->step++;
+  d.scan = l->scan;
+  d.fired = l->fired;
+  observe_arena(a, &d.obs);
+  d.obs.cycle = last;
+
+  if (!exchange(&l->policy->ch->lane[l->index], &d, &act)) {
+    warnx("policy of lane %d not answering, robot stands still", l->index);
+    l->silent = 1;
+    push(a, 0L);
+    return;
+  }
+
+  if (act.act & CROW_SCAN)
+    l->scan = call(a, c_scan, act.scan_dir, act.res);
+  if (act.act & CROW_CANNON)
+    l->fired = call(a, c_cannon, act.cannon_dir, act.range);
+  if (act.act & CROW_DRIVE)
+    call(a, c_drive, act.drive_dir, act.speed);
+
+  push(a, 1L);
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: nil
+ *  c-file-style: "gnu"
+ * End:
+ */
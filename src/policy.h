@@ -0,0 +1,37 @@
+/* policy.h - robots driven by an external policy over shared memory
+ *
+ * Copyright (C) 2026 The CROW authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef CROBOTS_POLICY_H_
+#define CROBOTS_POLICY_H_
+
+#include "crobots.h"
+#include "crow.h"
+
+#define I_POLICY 17		/* intrinsics[] of c_policy(), past the names */
+				/* robots may call, see compiler.c */
+
+int  policy_file(char *f);
+int  policy_load(s_robot *r, char *f, int stack);
+void policy_free(s_program *p);
+void policy_attach(s_robot *r);
+void policy_detach(s_robot *r);
+void policy_state(const s_robot *r, int st[3]);
+void policy_restore(s_robot *r, const int st[3]);
+void c_policy(s_arena *a);
+
+void observe_arena(const s_arena *a, crow_obs_t *obs);
+
+#endif /* CROBOTS_POLICY_H_ */
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: nil
+ *  c-file-style: "gnu"
+ * End:
+ */
@@ -0,0 +1,337 @@
+/* pool.c - work stealing pool of threads for independent tasks
+ *
+ * Copyright (C) 2026 The CROW authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * Tasks 0 .. n-1 are dealt out round robin, one queue per worker.  A
+ * worker takes its own tasks from the front of its queue, lowest number
+ * first, and when it runs dry steals from the back of another queue, so
+ * a few long tasks do not leave the other workers idle.  No task creates
+ * new ones, so a worker that finds every queue empty is done.
+ *
+ * Results are reported in task order whatever the order of completion:
+ * the worker that completes the lowest outstanding task reports it, and
+ * any later ones already complete, holding the pool lock while it does.
+ *
+ * The threads of a pool wait between sets of tasks, so a caller handing
+ * out many small sets, a step of a batch of battlefields each, does not
+ * start threads for every one.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pool.h"
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+
+struct deque {
+  pthread_mutex_t lock;
+  int *task;			/* task numbers, head .. tail-1 are queued */
+  int head, tail;
+};
+
+struct worker {
+  struct pool *p;
+  int w;
+};
+
+struct pool {
+  int workers;
+  struct worker *me;		/* one by worker, 0 is the caller */
+  pthread_t *tid;
+  char *started;
+  pthread_mutex_t lock;		/* serializes reporting and hand-offs */
+  pthread_cond_t go;		/* a new set of tasks, or quit */
+  pthread_cond_t idle;		/* the last worker is out of a set */
+  int gen;			/* sets of tasks handed out so far */
+  int busy;			/* workers not done with the current set */
+  int quit;
+
+  /* the current set of tasks */
+  int tasks;
+  pool_task task;
+  pool_done done;
+  void *ctx;
+  struct deque *q;		/* one queue by worker */
+  int room;			/* tasks each queue can hold */
+  char *finished;		/* completed, but not reported yet */
+  int next;			/* next task to report */
+};
+
+
+/* take - the next task of a worker's own queue, or -1 */
+static int take(struct deque *q)
+{
+  int t = -1;
+
+  pthread_mutex_lock(&q->lock);
+  if (q->head < q->tail)
+    t = q->task[q->head++];
+  pthread_mutex_unlock(&q->lock);
+  return (t);
+}
+
+
+/* steal - the last task of another worker's queue, or -1 */
+static int steal(struct deque *q)
+{
+  int t = -1;
+
+  pthread_mutex_lock(&q->lock);
+  if (q->head < q->tail)
+    t = q->task[--q->tail];
+  pthread_mutex_unlock(&q->lock);
+  return (t);
+}
+
+
+/* finish - mark a task complete, and report all that are due */
+static void finish(struct pool *p, int t)
+{
+  pthread_mutex_lock(&p->lock);
+  p->finished[t] = 1;
+  while (p->next < p->tasks && p->finished[p->next])
+    p->done(p->ctx, p->next++);
+  pthread_mutex_unlock(&p->lock);
+}
+
+
+/* work - run tasks until there are none left anywhere */
+static void work(struct worker *me)
+{
+  struct pool *p = me->p;
+  int t, i;
+
+  for (;;) {
+    t = take(&p->q[me->w]);
+    for (i = 1; t < 0 && i < p->workers; i++)
+      t = steal(&p->q[(me->w + i) % p->workers]);
+    if (t < 0)
+      break;
+
+    p->task(p->ctx, me->w, t);
+    finish(p, t);
+  }
+}
+
+
+/* idle - a thread of the pool, working on each set of tasks it is given */
+static void *idle(void *arg)
+{
+  struct worker *me = arg;
+  struct pool *p = me->p;
+  int seen = 0;
+
+  pthread_mutex_lock(&p->lock);
+  for (;;) {
+    while (p->gen == seen && !p->quit)
+      pthread_cond_wait(&p->go, &p->lock);
+    if (p->quit)
+      break;
+    seen = p->gen;
+    pthread_mutex_unlock(&p->lock);
+
+    work(me);
+
+    pthread_mutex_lock(&p->lock);
+    if (--p->busy == 0)
+      pthread_cond_signal(&p->idle);
+  }
+  pthread_mutex_unlock(&p->lock);
+
+  return (NULL);
+}
+
+
+/* pool_new - a pool of up to 'workers' threads, including the caller */
+/*            which is worker 0; they wait for pool_exec(); NULL if out */
+/*            of memory */
+struct pool *pool_new(int workers)
+{
+  struct pool *p;
+  int w;
+
+  if (workers < 1)
+    workers = 1;
+
+  p = calloc(1, sizeof(struct pool));
+  if (!p)
+    return (NULL);
+  p->workers = workers;
+  p->q = calloc(workers, sizeof(struct deque));
+  p->me = calloc(workers, sizeof(struct worker));
+  p->tid = calloc(workers, sizeof(pthread_t));
+  p->started = calloc(workers, 1);
+  if (!p->q || !p->me || !p->tid || !p->started) {
+    free(p->q);
+    free(p->me);
+    free(p->tid);
+    free(p->started);
+    free(p);
+    return (NULL);
+  }
+  pthread_mutex_init(&p->lock, NULL);
+  pthread_cond_init(&p->go, NULL);
+  pthread_cond_init(&p->idle, NULL);
+
+  for (w = 0; w < workers; w++) {
+    pthread_mutex_init(&p->q[w].lock, NULL);
+    p->me[w].p = p;
+    p->me[w].w = w;
+  }
+
+  /* a worker that cannot be started leaves its queue to be stolen */
+  for (w = 1; w < workers; w++)
+    p->started[w] = pthread_create(&p->tid[w], NULL, idle, &p->me[w]) == 0;
+
+  return (p);
+}
+
+
+/* pool_exec - run tasks 0 .. n-1 on the threads of a pool; returns when */
+/*             all tasks are reported */
+int pool_exec(struct pool *p, int tasks, pool_task task, pool_done done, void *ctx)
+{
+  int w, t;
+
+  p->tasks = tasks;
+  p->task = task;
+  p->done = done;
+  p->ctx = ctx;
+  p->next = 0;
+
+  if (tasks / p->workers + 1 > p->room) {
+    p->room = tasks / p->workers + 1;
+    for (w = 0; w < p->workers; w++)
+      p->q[w].task = realloc(p->q[w].task, p->room * sizeof(int));
+  }
+  p->finished = realloc(p->finished, tasks + 1);
+  memset(p->finished, 0, tasks + 1);
+
+  for (w = 0; w < p->workers; w++)
+    p->q[w].head = p->q[w].tail = 0;
+  for (t = 0; t < tasks; t++) {
+    struct deque *q = &p->q[t % p->workers];
+
+    q->task[q->tail++] = t;
+  }
+
+  pthread_mutex_lock(&p->lock);
+  for (p->busy = 0, w = 1; w < p->workers; w++)
+    p->busy += p->started[w];
+  p->gen++;
+  pthread_cond_broadcast(&p->go);
+  pthread_mutex_unlock(&p->lock);
+
+  work(&p->me[0]);
+
+  /* the queues are only reused once every worker is out of them */
+  pthread_mutex_lock(&p->lock);
+  while (p->busy > 0)
+    pthread_cond_wait(&p->idle, &p->lock);
+  pthread_mutex_unlock(&p->lock);
+
+  return (0);
+}
+
+
+/* pool_free - stop the threads of a pool, and release it */
+void pool_free(struct pool *p)
+{
+  int w;
+
+  pthread_mutex_lock(&p->lock);
+  p->quit = 1;
+  pthread_cond_broadcast(&p->go);
+  pthread_mutex_unlock(&p->lock);
+
+  for (w = 1; w < p->workers; w++) {
+    if (p->started[w])
+      pthread_join(p->tid[w], NULL);
+  }
+
+  for (w = 0; w < p->workers; w++) {
+    pthread_mutex_destroy(&p->q[w].lock);
+    free(p->q[w].task);
+  }
+  pthread_cond_destroy(&p->idle);
+  pthread_cond_destroy(&p->go);
+  pthread_mutex_destroy(&p->lock);
+  free(p->finished);
+  free(p->started);
+  free(p->tid);
+  free(p->me);
+  free(p->q);
+  free(p);
+}
+
+#else  /* !HAVE_PTHREAD_H */
+
+struct pool {
+  int workers;
+};
+
+/* pool_new - no threads on this system, all tasks run on worker 0 */
+struct pool *pool_new(int workers)
+{
+  (void)workers;
+  return (calloc(1, sizeof(struct pool)));
+}
+
+
+/* pool_exec - run all tasks on worker 0, in order */
+int pool_exec(struct pool *p, int tasks, pool_task task, pool_done done, void *ctx)
+{
+  int t;
+
+  (void)p;
+  for (t = 0; t < tasks; t++) {
+    task(ctx, 0, t);
+    done(ctx, t);
+  }
+
+  return (0);
+}
+
+
+/* pool_free - release a pool */
+void pool_free(struct pool *p)
+{
+  free(p);
+}
+
+#endif /* HAVE_PTHREAD_H */
+
+
+/* pool_run - run tasks on up to 'workers' threads, including the caller */
+/*            which is worker 0; returns when all tasks are reported */
+int pool_run(int workers, int tasks, pool_task task, pool_done done, void *ctx)
+{
+  struct pool *p;
+
+  if (workers > tasks)
+    workers = tasks;
+
+  p = pool_new(workers);
+  pool_exec(p, tasks, task, done, ctx);
+  pool_free(p);
+
+  return (0);
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: nil
+ *  c-file-style: "gnu"
+ * End:
+ */
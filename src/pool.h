@@ -0,0 +1,34 @@
+/* pool.h - work stealing pool of threads for independent tasks
+ *
+ * Copyright (C) 2026 The CROW authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef CROBOTS_POOL_H_
+#define CROBOTS_POOL_H_
+
+/* runs task t on worker w, tasks on the same worker never overlap */
+typedef void (*pool_task)(void *ctx, int w, int t);
+
+/* reports task t, called once per task in the order 0, 1, 2 ... */
+typedef void (*pool_done)(void *ctx, int t);
+
+struct pool;
+
+struct pool *pool_new(int workers);
+int  pool_exec(struct pool *p, int tasks, pool_task task, pool_done done, void *ctx);
+void pool_free(struct pool *p);
+
+int  pool_run(int workers, int tasks, pool_task task, pool_done done, void *ctx);
+
+#endif /* CROBOTS_POOL_H_ */
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: nil
+ *  c-file-style: "gnu"
+ * End:
+ */
@@ -0,0 +1,131 @@
+/* program.c - compiled robots, shared by the robots that run them
+ *
+ * Copyright (C) 2026 The CROW authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * A program is what the compiler, the cache or a shared object made of
+ * a robot: the code, its constants, the function headers and tables,
+ * the native code of -J or -C, and the channel of a policy robot.  A
+ * robot holds the state of one instance only, its stack, externals,
+ * registers and lane of the channel, and points at its program.  Clones
+ * and the arenas of the workers of -j share the program of the robot
+ * they were made from, counted in refs, so that it is freed with the
+ * last of them.
+ *
+ * A program is changed by link_code(), fuse_code() and the rest only
+ * before it is shared, and is read only from then on; resetting a robot
+ * for a new match never writes to it.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "crobots.h"
+#include "program.h"
+#include "symtab.h"
+#include "jit.h"
+#include "aot.h"
+#include "policy.h"
+
+
+/* prog_new - an empty program, run by no robot yet */
+s_program *prog_new(void)
+{
+  return (calloc(1, sizeof(s_program)));
+}
+
+
+/* prog_free - release a program and all of its code */
+void prog_free(s_program *p)
+{
+  s_func *temp;
+
+  if (!p)
+    return;
+
+  jit_free(p);
+  aot_free(p);
+  policy_free(p);
+
+  if (p->funcs)
+    sym_free(p->funcs);
+  free(p->code);
+  free(p->room);
+  free(p->pool);
+  free(p->callee);
+
+  while (p->code_list) {
+    temp = p->code_list;
+    p->code_list = temp->nextfunc;
+    free(temp);
+  }
+  free(p);
+}
+
+
+/* prog_attach - make a robot an instance of a program, with a stack */
+/*               of 'stack' longs and externals of its own, in one */
+/*               block: the externals, then the stack */
+void prog_attach(s_robot *r, s_program *p, int stack)
+{
+  int n = stack;
+  s_func *f;
+
+  /* room for the locals of main at least, see robot_go() */
+  for (f = p->code_list; f; f = f->nextfunc) {
+    if (strcmp(f->func_name, "main") == 0 && n <= f->var_count)
+      n = f->var_count + 1;
+  }
+
+  __atomic_add_fetch(&p->refs, 1, __ATOMIC_RELAXED);
+  r->prog = p;
+  r->external = (long *) malloc((p->ext_count + n) * sizeof(long));
+  r->stackbase = r->external + p->ext_count;
+  r->stackend = r->stackbase + n;
+  r->status = ACTIVE;
+  policy_attach(r);
+}
+
+
+/* prog_share - make a robot another instance of the program of r, with */
+/*              a stack as large; the state is left to the caller */
+void prog_share(s_robot *to, const s_robot *r)
+{
+  s_program *p = r->prog;
+  int n = r->stackend - r->stackbase;
+
+  __atomic_add_fetch(&p->refs, 1, __ATOMIC_RELAXED);
+  to->prog = p;
+  to->external = (long *) malloc((p->ext_count + n) * sizeof(long));
+  to->stackbase = to->external + p->ext_count;
+  to->stackend = to->stackbase + n;
+  policy_attach(to);
+}
+
+
+/* prog_detach - release the state of a robot, and its program if it */
+/*               was the last robot running it */
+void prog_detach(s_robot *r)
+{
+  free(r->external);		/* and the stack with it */
+  r->external = NULL;
+  r->stackbase = NULL;
+  policy_detach(r);
+
+  if (r->prog && __atomic_sub_fetch(&r->prog->refs, 1, __ATOMIC_ACQ_REL) == 0)
+    prog_free(r->prog);
+  r->prog = NULL;
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: nil
+ *  c-file-style: "gnu"
+ * End:
+ */
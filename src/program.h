@@ -0,0 +1,29 @@
+/* program.h - compiled robots, shared by the robots that run them
+ *
+ * Copyright (C) 2026 The CROW authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef CROBOTS_PROGRAM_H_
+#define CROBOTS_PROGRAM_H_
+
+#include "crobots.h"
+
+s_program *prog_new(void);
+void prog_free(s_program *p);
+
+void prog_attach(s_robot *r, s_program *p, int stack);
+void prog_share(s_robot *to, const s_robot *r);
+void prog_detach(s_robot *r);
+
+#endif /* CROBOTS_PROGRAM_H_ */
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: nil
+ *  c-file-style: "gnu"
+ * End:
+ */
@@ -0,0 +1,83 @@
+/* rng.c - random numbers for matches and robots
+ *
+ * Copyright (C) 2026 The CROW authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * xoshiro256** by David Blackman and Sebastiano Vigna, seeded through
+ * splitmix64.  Every generator is named by a seed and a stream number,
+ * so the numbers of any one match, or any one robot in it, follow from
+ * the seed of the run and do not depend on what else has been played.
+ */
+
+#include "config.h"
+
+#include "rng.h"
+
+#define GOLDEN 0x9e3779b97f4a7c15ULL
+
+/* splitmix64 - next output of a splitmix64 generator at *x */
+static uint64_t splitmix64(uint64_t *x)
+{
+  uint64_t z = (*x += GOLDEN);
+
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return (z ^ (z >> 31));
+}
+
+static inline uint64_t rotl(uint64_t x, int k)
+{
+  return ((x << k) | (x >> (64 - k)));
+}
+
+
+/* rng_seed - start stream 'stream' of seed 'seed'; the state of each */
+/*            stream starts at a hash of both, as splitmix64 steps by */
+/*            GOLDEN and streams started GOLDEN apart would overlap */
+void rng_seed(s_rng *g, uint64_t seed, uint64_t stream)
+{
+  uint64_t x = stream;
+  int i;
+
+  x = seed ^ splitmix64(&x);
+  for (i = 0; i < 4; i++)
+    g->s[i] = splitmix64(&x);
+}
+
+
+/* rng_next - next 64 random bits */
+uint64_t rng_next(s_rng *g)
+{
+  uint64_t *s = g->s;
+  uint64_t r = rotl(s[1] * 5, 7) * 9;
+  uint64_t t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 45);
+
+  return (r);
+}
+
+
+/* rng_rand - next random number in 0 .. 2^31-1, like rand() */
+long rng_rand(s_rng *g)
+{
+  return ((long) (rng_next(g) >> 33));
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: nil
+ *  c-file-style: "gnu"
+ * End:
+ */
@@ -0,0 +1,30 @@
+/* rng.h - random numbers for matches and robots
+ *
+ * Copyright (C) 2026 The CROW authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef CROBOTS_RNG_H_
+#define CROBOTS_RNG_H_
+
+#include <stdint.h>
+
+typedef struct rng {		/* xoshiro256** state, never all zero */
+  uint64_t s[4];
+} s_rng;
+
+void     rng_seed(s_rng *g, uint64_t seed, uint64_t stream);
+uint64_t rng_next(s_rng *g);
+long     rng_rand(s_rng *g);
+
+#endif /* CROBOTS_RNG_H_ */
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: nil
+ *  c-file-style: "gnu"
+ * End:
+ */
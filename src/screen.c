@@ -62,7 +62,7 @@ static int f_height; /* play field height */
 
 
 /* init_disp - initialize display */
-void init_disp(void)
+void init_disp(s_arena *a)
 {
   initscr();
   /* color */
@@ -81,7 +81,7 @@ void init_disp(void)
   crmode();
   noecho();
   nonl();
-  draw_field();
+  draw_field(a);
 }
 
 
@@ -98,7 +98,7 @@ void end_disp(void)
 
 
 /* draw_field - draws the playing field and status boxes */
-void draw_field(void)
+void draw_field(s_arena *a)
 {
   int i;
 
@@ -134,7 +134,7 @@ void draw_field(void)
     attron(COLOR_PAIR(i + 1));
     addch('1' + i);
     attroff(COLOR_PAIR(i + 1));
-    printw(" %-14s", robots[i].name);
+    printw(" %-14s", a->robots[i].name);
   }
   
   move(LINES - 1, COLS - STAT_WID);
@@ -146,32 +146,32 @@ void draw_field(void)
 
 
 /* plot_robot - plot the robot position */
-void plot_robot(int n)
+void plot_robot(s_arena *a, int n)
 {
   int i, k;
   register int new_x, new_y;
 
-  new_x = (int) (((long)((robots[n].x+(CLICK/2)) / CLICK) * f_width) / MAX_X);
-  new_y = (int) (((long)((robots[n].y+(CLICK/2)) / CLICK) * f_height) / MAX_Y);
+  new_x = (int) (((long)((a->robots[n].x+(CLICK/2)) / CLICK) * f_width) / MAX_X(a));
+  new_y = (int) (((long)((a->robots[n].y+(CLICK/2)) / CLICK) * f_height) / MAX_Y(a));
   /* add one to x and y for playfield offset in screen, and inverse y */
   new_x++;
   new_y = f_height - new_y;
   new_y++;
 
-  if (robots[n].last_x != new_x || robots[n].last_y != new_y) {
+  if (a->robots[n].last_x != new_x || a->robots[n].last_y != new_y) {
     /* check for conflict */
     k = 1;
     for (i = 0; i < MAXROBOTS; i++) {
-      if (i == n || robots[n].status == DEAD)
+      if (i == n || a->robots[n].status == DEAD)
 	continue; /* same robot as n or inactive */
-      if (new_x == robots[i].last_x && new_y == robots[i].last_y) {
+      if (new_x == a->robots[i].last_x && new_y == a->robots[i].last_y) {
 	k = 0;
 	break;    /* conflict, robot in that position */
       }
     }
     if (k) {
-      if (robots[n].last_y >= 0) {
-        move(robots[n].last_y,robots[n].last_x);
+      if (a->robots[n].last_y >= 0) {
+        move(a->robots[n].last_y,a->robots[n].last_x);
         addch(' ');
       }
       move(new_y,new_x);
@@ -179,44 +179,44 @@ void plot_robot(int n)
       addch(n+'1');  /* ASCII dependent */
       attroff(COLOR_PAIR(n+1));
       refresh();
-      robots[n].last_x = new_x;
-      robots[n].last_y = new_y;
+      a->robots[n].last_x = new_x;
+      a->robots[n].last_y = new_y;
     }
   }
 }
 
 
 /* plot_miss - plot the missile position */
-void plot_miss(int r, int n)
+void plot_miss(s_arena *a, int r, int n)
 {
   int i, k;
   register int new_x, new_y;
 
-  new_x = (int) (((long)((missiles[r][n].cur_x+(CLICK/2)) / CLICK) 
-		  * f_width) / MAX_X);
-  new_y = (int) (((long)((missiles[r][n].cur_y+(CLICK/2)) / CLICK) 
-		  * f_height) / MAX_Y);
+  new_x = (int) (((long)((a->missiles[r][n].cur_x+(CLICK/2)) / CLICK) 
+		  * f_width) / MAX_X(a));
+  new_y = (int) (((long)((a->missiles[r][n].cur_y+(CLICK/2)) / CLICK) 
+		  * f_height) / MAX_Y(a));
   /* add one to x and y for playfield offset in screen, and inverse y */
   new_x++;
   new_y = f_height - new_y;
   new_y++;
 
-  if (missiles[r][n].last_xx != new_x || missiles[r][n].last_yy != new_y) {
+  if (a->missiles[r][n].last_xx != new_x || a->missiles[r][n].last_yy != new_y) {
     /* check for conflict */
     k = 1;
     for (i = 0; i < MAXROBOTS; i++) {
-      if (robots[i].status == DEAD)
+      if (a->robots[i].status == DEAD)
 	continue; /* inactive robot */
-      if ((new_x == robots[i].last_x && new_y == robots[i].last_y)  ||
-          (missiles[r][n].last_xx == robots[i].last_x && 
-	   missiles[r][n].last_yy == robots[i].last_y)) {
+      if ((new_x == a->robots[i].last_x && new_y == a->robots[i].last_y)  ||
+          (a->missiles[r][n].last_xx == a->robots[i].last_x && 
+	   a->missiles[r][n].last_yy == a->robots[i].last_y)) {
 	k = 0;
 	break;    /* conflict, robot in that position */
       }
     }
     if (k) {
-      if (missiles[r][n].last_yy > 0) {
-        move(missiles[r][n].last_yy,missiles[r][n].last_xx);
+      if (a->missiles[r][n].last_yy > 0) {
+        move(a->missiles[r][n].last_yy,a->missiles[r][n].last_xx);
         addch(' ');
       }
       move(new_y,new_x);
@@ -224,8 +224,8 @@ void plot_miss(int r, int n)
       addch(SHELL);
       attroff(COLOR_PAIR(MAXROBOTS + r + 1));
       refresh();
-      missiles[r][n].last_xx = new_x;
-      missiles[r][n].last_yy = new_y;
+      a->missiles[r][n].last_xx = new_x;
+      a->missiles[r][n].last_yy = new_y;
     }
   }
 }
@@ -234,42 +234,42 @@ void plot_miss(int r, int n)
 
 /* plot_exp - plot the missile exploding */
 
-void plot_exp(int r, int n)
+void plot_exp(s_arena *a, int r, int n)
 {
   int c, i, p, hold_x, hold_y, k;
   register int new_x, new_y;
 
-  if (missiles[r][n].count == EXP_COUNT) {
+  if (a->missiles[r][n].count == EXP_COUNT) {
     p = 1;  /* plot explosion */
     /* erase last missile postion */
     /* check for conflict */
     k = 1;
     for (i = 0; i < MAXROBOTS; i++) {
-      if (robots[i].status == DEAD)
+      if (a->robots[i].status == DEAD)
 	continue; /* inactive robot */
-      if (missiles[r][n].last_xx == robots[i].last_x && 
-	  missiles[r][n].last_yy == robots[i].last_y) {
+      if (a->missiles[r][n].last_xx == a->robots[i].last_x && 
+	  a->missiles[r][n].last_yy == a->robots[i].last_y) {
 	k = 0;
 	break;    /* conflict, robot in that position */
       }
     }
     if (k) {
-      if (missiles[r][n].last_yy > 0) {
-        move(missiles[r][n].last_yy,missiles[r][n].last_xx);
+      if (a->missiles[r][n].last_yy > 0) {
+        move(a->missiles[r][n].last_yy,a->missiles[r][n].last_xx);
         addch(' ');
       }
     }
   }
   else
-    if (missiles[r][n].count == 1)
+    if (a->missiles[r][n].count == 1)
       p = 0; /* last count, remove explosion */
     else
       return;  /* continue to display explosion */
 
-  hold_x = (int) (((long)((missiles[r][n].cur_x+(CLICK/2)) / CLICK) 
-		   * f_width) / MAX_X);
-  hold_y = (int) (((long)((missiles[r][n].cur_y+(CLICK/2)) / CLICK) 
-		   * f_height) / MAX_Y);
+  hold_x = (int) (((long)((a->missiles[r][n].cur_x+(CLICK/2)) / CLICK) 
+		   * f_width) / MAX_X(a));
+  hold_y = (int) (((long)((a->missiles[r][n].cur_y+(CLICK/2)) / CLICK) 
+		   * f_height) / MAX_Y(a));
 
   for (c = 0; c < 9; c++) {
     new_x = hold_x + exp_pos[c].xx;
@@ -283,9 +283,9 @@ void plot_exp(int r, int n)
 
     k = 1;
     for (i = 0; i < MAXROBOTS; i++) {
-      if (robots[i].status == DEAD) 
+      if (a->robots[i].status == DEAD) 
 	continue; 
-      if (new_x == robots[i].last_x && new_y == robots[i].last_y) {
+      if (new_x == a->robots[i].last_x && new_y == a->robots[i].last_y) {
 	k = 0;
 	break;    /* conflict */
       }
@@ -300,13 +300,13 @@ void plot_exp(int r, int n)
 
 
 /* robot_stat - update status info */
-void robot_stat(int n)
+void robot_stat(s_arena *a, int n)
 {
   int changed = 0;
   int d,i;
 
-  if (robots[n].last_damage != robots[n].damage) {
-    d=robots[n].damage*(STAT_WID-2)/100;
+  if (a->robots[n].last_damage != a->robots[n].damage) {
+    d=a->robots[n].damage*(STAT_WID-2)/100;
 
     move(5*n+2,COLS-STAT_WID+1);
     for(i=0; i < (STAT_WID-2 - d); i++) {
@@ -316,15 +316,15 @@ void robot_stat(int n)
       addch(' ');
     }
     move(5*n+3,COLS-STAT_WID+1);
-    printw("%03d",robots[n].damage);
+    printw("%03d",a->robots[n].damage);
 
-    robots[n].last_damage = robots[n].damage;
+    a->robots[n].last_damage = a->robots[n].damage;
     changed = 1;
   }
 
   move(5*n+3,COLS-STAT_WID+5);
-  printw("(%3d,",robots[n].x / CLICK);
-  printw("%3d)",robots[n].y / CLICK);
+  printw("(%3d,",a->robots[n].x / CLICK);
+  printw("%3d)",a->robots[n].y / CLICK);
 
   if (changed)
     refresh();
@@ -20,6 +20,7 @@
 #define CROBOTS_SCREEN_H_
 
 #include "config.h"
+#include "crobots.h"
 
 #if defined HAVE_NCURSESW_CURSES_H
 #  include <ncursesw/curses.h>
@@ -35,16 +36,16 @@
 #  error "SysV or X/Open-compatible Curses header file required"
 #endif
 
-void init_disp  (void);
+void init_disp  (s_arena *a);
 void end_disp   (void);
 
-void draw_field (void);
+void draw_field (s_arena *a);
 
-void plot_robot (int n);
-void plot_miss  (int r, int n);
-void plot_exp   (int r, int n);
+void plot_robot (s_arena *a, int n);
+void plot_miss  (s_arena *a, int r, int n);
+void plot_exp   (s_arena *a, int r, int n);
 
-void robot_stat (int n);
+void robot_stat (s_arena *a, int n);
 void show_cycle (long l);
 
 #endif /* CROBOTS_SCREEN_H_ */
@@ -12,6 +12,7 @@
 #define SNAPSHOT_H_
 
 #include <stdio.h>
+#include "crobots.h"
 
 /**
  * init_snapshot - Initialize snapshot output
@@ -19,7 +20,7 @@
  *
  * Call at start of each match to write header and initialize state.
  */
-void init_snapshot(FILE *fp);
+void init_snapshot(s_arena *a, FILE *fp);
 
 /**
  * output_snapshot - Write current game state to snapshot file
@@ -28,7 +29,7 @@ void init_snapshot(FILE *fp);
  * Outputs ASCII battlefield visualization and robot/missile data tables.
  * Should be called approximately every UPDATE_CYCLES (30 cycles).
  */
-void output_snapshot(long cycle);
+void output_snapshot(s_arena *a, long cycle);
 
 /**
  * close_snapshot - Finalize snapshot output
@@ -36,14 +37,14 @@ void output_snapshot(long cycle);
  * Call at end of each match to flush and close snapshot output.
  * Writes footer separators between matches.
  */
-void close_snapshot(void);
+void close_snapshot(s_arena *a);
 
 /**
  * reset_damage_tracker - Reset the damage event tracker
  *
  * Clears the damage tracker for the next snapshot period.
  */
-void reset_damage_tracker(void);
+void reset_damage_tracker(s_arena *a);
 
 #endif /* SNAPSHOT_H_ */
 
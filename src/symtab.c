@@ -0,0 +1,123 @@
+/* symtab.c - symbol tables of the compiler, names hashed to offsets
+ *
+ * Copyright (C) 2026 The CROW authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * A name gets the next offset when it is added and keeps it, so the
+ * offsets are those of the fixed size pools the compiler used before:
+ * 0, 1, 2 ... in order of declaration.  Names are found through an open
+ * addressed table of offsets, probed linearly and kept at most half
+ * full, so a lookup costs one hash and a compare or two whatever the
+ * size of the table.  Names are copied, of any length.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "symtab.h"
+
+#define SYM_SLOTS 64		/* first size of the hash table */
+
+
+/* hash - FNV-1a of a name */
+static unsigned int hash(const char *s)
+{
+  unsigned int h = 2166136261u;
+
+  while (*s) {
+    h ^= (unsigned char) *s++;
+    h *= 16777619u;
+  }
+  return (h);
+}
+
+
+/* sym_new - an empty symbol table */
+s_symtab *sym_new(void)
+{
+  s_symtab *t = malloc(sizeof(s_symtab));
+
+  t->count = 0;
+  t->room = SYM_SLOTS / 2;
+  t->name = malloc(t->room * sizeof(char *));
+  t->mask = SYM_SLOTS - 1;
+  t->slot = calloc(SYM_SLOTS, sizeof(int));
+  return (t);
+}
+
+
+/* sym_free - free a symbol table and its names */
+void sym_free(s_symtab *t)
+{
+  if (!t)
+    return;
+  sym_clear(t);
+  free(t->name);
+  free(t->slot);
+  free(t);
+}
+
+
+/* sym_clear - remove all names, the next one added gets offset 0 again */
+void sym_clear(s_symtab *t)
+{
+  int i;
+
+  for (i = 0; i < t->count; i++)
+    free(t->name[i]);
+  t->count = 0;
+  memset(t->slot, 0, (t->mask + 1) * sizeof(int));
+}
+
+
+/* sym_find - offset of a name, or -1 if not in the table */
+int sym_find(s_symtab *t, const char *s)
+{
+  unsigned int i;
+
+  for (i = hash(s) & t->mask; t->slot[i]; i = (i + 1) & t->mask) {
+    if (strcmp(t->name[t->slot[i] - 1], s) == 0)
+      return (t->slot[i] - 1);
+  }
+  return (-1);
+}
+
+
+/* sym_add - add a name not in the table yet, returns its offset */
+int sym_add(s_symtab *t, const char *s)
+{
+  unsigned int i;
+  int j;
+
+  if (t->count == t->room) {	/* double both, rehashing all names */
+    t->room *= 2;
+    t->name = realloc(t->name, t->room * sizeof(char *));
+    free(t->slot);
+    t->mask = t->mask * 2 + 1;
+    t->slot = calloc(t->mask + 1, sizeof(int));
+    for (j = 0; j < t->count; j++) {
+      for (i = hash(t->name[j]) & t->mask; t->slot[i]; i = (i + 1) & t->mask)
+	;
+      t->slot[i] = j + 1;
+    }
+  }
+
+  t->name[t->count] = strdup(s);
+  for (i = hash(s) & t->mask; t->slot[i]; i = (i + 1) & t->mask)
+    ;
+  t->slot[i] = t->count + 1;
+  return (t->count++);
+}
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: nil
+ *  c-file-style: "gnu"
+ * End:
+ */
@@ -0,0 +1,36 @@
+/* symtab.h - symbol tables of the compiler, names hashed to offsets
+ *
+ * Copyright (C) 2026 The CROW authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef CROBOTS_SYMTAB_H_
+#define CROBOTS_SYMTAB_H_
+
+typedef struct symtab {
+  char **name;			/* names by offset, in order of allocation */
+  int count;			/* names in the table, the next offset */
+  int room;			/* size of 'name' */
+  int *slot;			/* offset + 1 by hash of the name, 0 if free */
+  int mask;			/* size of 'slot' less 1, a power of 2 */
+} s_symtab;
+
+#define SYM_NAME(t,i) ((t)->name[i])
+
+s_symtab *sym_new(void);
+void      sym_free(s_symtab *t);
+void      sym_clear(s_symtab *t);
+int       sym_find(s_symtab *t, const char *s);
+int       sym_add(s_symtab *t, const char *s);
+
+#endif /* CROBOTS_SYMTAB_H_ */
+
+/**
+ * Local Variables:
+ *  indent-tabs-mode: nil
+ *  c-file-style: "gnu"
+ * End:
+ */